@@ -39,7 +39,13 @@
 
 #include "GRT/GRT.h"
 #include "calibrator.h"
+#include "capture-log.h"
+#include "fusion-stream.h"
 #include "iostream.h"
+#include "network-stream.h"
+#include "replay-stream.h"
+#include "sample-block.h"
+#include "synthetic-stream.h"
 #include "tuneable.h"
 #include "training.h"
 
@@ -0,0 +1,229 @@
+#include "block-prediction.h"
+
+#include <algorithm>
+
+// Sizes m to rows x cols and zeroes it. Its storage is reused if it's the
+// right size already.
+static void reshape(GRT::MatrixDouble& m, uint32_t rows, uint32_t cols) {
+    if (rows == 0 || cols == 0) {
+        if (m.getNumRows() != 0) { m.clear(); }
+        return;
+    }
+    if (m.getNumRows() != rows || m.getNumCols() != cols) { m.resize(rows, cols); }
+    m.setAllValues(0);
+}
+
+// Copies values into row i of m, reshaping m to fit them if need be (stages
+// only say how many values they output once they've run).
+static void setRow(GRT::MatrixDouble& m, uint32_t i, uint32_t rows,
+                   const GRT::VectorDouble& values) {
+    if (m.getNumRows() != rows || m.getNumCols() != values.size()) {
+        reshape(m, rows, values.size());
+        if (values.empty()) { return; }
+    }
+    std::copy(values.begin(), values.end(), m[i]);
+}
+
+// The histograms for each module of a pipeline.
+struct ModuleLatencies {
+    std::vector<LatencyHistogram*> pre_processing;
+    std::vector<LatencyHistogram*> features;
+    LatencyHistogram* classifier = nullptr;
+    std::vector<LatencyHistogram*> post_processing;
+};
+
+static ModuleLatencies getModuleLatencies(const GRT::GestureRecognitionPipeline& pipeline,
+                                          bool should_classify, LatencyProfile* profile) {
+    ModuleLatencies latencies;
+    for (uint32_t j = 0; j < pipeline.getNumPreProcessingModules(); j++) {
+        latencies.pre_processing.push_back(profile->get(
+            "pre-processing " + std::to_string(j + 1) + ": " +
+            pipeline.getPreProcessingModule(j)->getPreProcessingType()));
+    }
+    for (uint32_t j = 0; j < pipeline.getNumFeatureExtractionModules(); j++) {
+        latencies.features.push_back(profile->get(
+            "feature " + std::to_string(j + 1) + ": " +
+            pipeline.getFeatureExtractionModule(j)->getFeatureExtractionType()));
+    }
+    if (!should_classify) { return latencies; }
+
+    latencies.classifier = profile->get(
+        "classifier: " + pipeline.getClassifier()->getClassifierType());
+    for (uint32_t j = 0; j < pipeline.getNumPostProcessingModules(); j++) {
+        latencies.post_processing.push_back(profile->get(
+            "post-processing " + std::to_string(j + 1) + ": " +
+            pipeline.getPostProcessingModule(j)->getPostProcessingType()));
+    }
+    return latencies;
+}
+
+// Runs data through the pipeline's modules, one at a time and timing each, as
+// predict() (or, if !should_classify, preProcessData()) would. The predicted
+// label goes into *label.
+static bool predictTimed(const GRT::GestureRecognitionPipeline& pipeline,
+                         GRT::VectorDouble data, bool should_classify,
+                         const ModuleLatencies& latencies, GRT::UINT* label) {
+    for (uint32_t j = 0; j < latencies.pre_processing.size(); j++) {
+        LatencyTimer timer(latencies.pre_processing[j]);
+        GRT::PreProcessing* module = pipeline.getPreProcessingModule(j);
+        if (!module->process(data)) { return false; }
+        data = module->getProcessedData();
+    }
+    for (uint32_t j = 0; j < latencies.features.size(); j++) {
+        LatencyTimer timer(latencies.features[j]);
+        GRT::FeatureExtraction* module = pipeline.getFeatureExtractionModule(j);
+        if (!module->computeFeatures(data)) { return false; }
+        data = module->getFeatureVector();
+    }
+    if (!should_classify) { return true; }
+
+    GRT::Classifier* classifier = pipeline.getClassifier();
+    {
+        LatencyTimer timer(latencies.classifier);
+        if (!classifier->predict(data)) { return false; }
+        *label = classifier->getPredictedClassLabel();
+    }
+
+    // Post-processing modules take and give either the predicted label or the
+    // class likelihoods.
+    for (uint32_t j = 0; j < latencies.post_processing.size(); j++) {
+        LatencyTimer timer(latencies.post_processing[j]);
+        GRT::PostProcessing* module = pipeline.getPostProcessingModule(j);
+        if (module->getIsPostProcessingInputModePredictedClassLabel()) {
+            data.assign(1, *label);
+        } else {
+            data = classifier->getClassLikelihoods();
+        }
+        if (!module->process(data)) { return false; }
+        if (module->getIsPostProcessingOutputModePredictedClassLabel()) {
+            data = module->getProcessedData();
+            if (!data.empty()) { *label = (GRT::UINT) data[0]; }
+        }
+    }
+    return true;
+}
+
+uint32_t predictBlock(GRT::GestureRecognitionPipeline& pipeline,
+                      const GRT::MatrixDouble& block, BlockPrediction* prediction,
+                      uint32_t options, uint32_t begin, uint32_t end) {
+    end = std::min(end, (uint32_t) block.getNumRows());
+    begin = std::min(begin, end);
+    const uint32_t n = end - begin;
+    const uint32_t cols = block.getNumCols();
+
+    const bool should_classify = pipeline.getTrained() && !(options & kPreProcessOnly);
+    const bool should_keep_stages = options & kKeepStageOutputs;
+
+    // The classifier's labels don't change from sample to sample.
+    if (should_classify) {
+        prediction->class_labels = pipeline.getClassLabels();
+    } else {
+        prediction->class_labels.clear();
+    }
+    const uint32_t num_classes = prediction->class_labels.size();
+
+    prediction->is_valid.assign(n, false);
+    prediction->labels.assign(n, 0);
+    reshape(prediction->likelihoods, n, num_classes);
+    reshape(prediction->distances, n, num_classes);
+
+    const uint32_t num_pre_processing =
+        should_keep_stages ? pipeline.getNumPreProcessingModules() : 0;
+    const uint32_t num_features =
+        should_keep_stages ? pipeline.getNumFeatureExtractionModules() : 0;
+    prediction->pre_processed.resize(num_pre_processing);
+    prediction->features.resize(num_features);
+    for (GRT::MatrixDouble& m : prediction->pre_processed) {
+        reshape(m, n, m.getNumCols());
+    }
+    for (GRT::MatrixDouble& m : prediction->features) { reshape(m, n, m.getNumCols()); }
+
+    const bool is_timed = prediction->latency != nullptr;
+    ModuleLatencies latencies;
+    if (is_timed) {
+        latencies = getModuleLatencies(pipeline, should_classify, prediction->latency);
+    }
+
+    GRT::VectorDouble input(cols);
+    uint32_t num_valid = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        std::copy(block[begin + i], block[begin + i] + cols, input.begin());
+
+        GRT::UINT label = 0;
+        bool is_valid;
+        if (is_timed) {
+            is_valid = predictTimed(pipeline, input, should_classify, latencies, &label);
+        } else if (should_classify) {
+            is_valid = pipeline.predict(input);
+            label = pipeline.getPredictedClassLabel();
+        } else {
+            is_valid = pipeline.preProcessData(input);
+        }
+        if (!is_valid) { continue; }
+        prediction->is_valid[i] = true;
+        num_valid++;
+
+        for (uint32_t j = 0; j < num_pre_processing; j++) {
+            setRow(prediction->pre_processed[j], i, n, pipeline.getPreProcessedData(j));
+        }
+        for (uint32_t j = 0; j < num_features; j++) {
+            setRow(prediction->features[j], i, n, pipeline.getFeatureExtractionData(j));
+        }
+        if (!should_classify) { continue; }
+
+        prediction->labels[i] = label;
+        const GRT::VectorDouble likelihoods = pipeline.getClassLikelihoods();
+        const GRT::VectorDouble distances = pipeline.getClassDistances();
+        std::copy_n(likelihoods.begin(), std::min<size_t>(likelihoods.size(), num_classes),
+                    prediction->likelihoods[i]);
+        std::copy_n(distances.begin(), std::min<size_t>(distances.size(), num_classes),
+                    prediction->distances[i]);
+    }
+    return num_valid;
+}
+
+// Scales likelihoods to add up to 1.
+static void normalize(std::vector<double>* likelihoods) {
+    double sum = 0.0;
+    for (double likelihood : *likelihoods) { sum += likelihood; }
+    for (double& likelihood : *likelihoods) { likelihood /= (sum == 0.0 ? 1e-9 : sum); }
+}
+
+std::vector<double> predictSampleLikelihoods(GRT::GestureRecognitionPipeline& pipeline,
+                                             const GRT::MatrixDouble& sample,
+                                             uint32_t num_labels,
+                                             BlockPrediction* prediction) {
+    pipeline.reset();
+    predictBlock(pipeline, sample, prediction);
+
+    std::vector<double> likelihoods(num_labels + 1, 0.0);
+    const std::vector<GRT::UINT>& class_labels = prediction->class_labels;
+    for (uint32_t i = 0; i < prediction->is_valid.size(); i++) {
+        if (!prediction->is_valid[i]) { continue; }
+        for (uint32_t k = 0; k < class_labels.size(); k++) {
+            if (class_labels[k] >= likelihoods.size()) { continue; }
+            likelihoods[class_labels[k]] += prediction->likelihoods[i][k];
+        }
+    }
+    normalize(&likelihoods);
+    return likelihoods;
+}
+
+std::vector<double> predictClassifierLikelihoods(GRT::Classifier& classifier,
+                                                 const GRT::MatrixDouble& rows,
+                                                 uint32_t num_labels) {
+    classifier.reset();
+    const std::vector<GRT::UINT> class_labels = classifier.getClassLabels();
+
+    std::vector<double> likelihoods(num_labels + 1, 0.0);
+    for (uint32_t i = 0; i < rows.getNumRows(); i++) {
+        if (!classifier.predict(rows.getRowVector(i))) { continue; }
+        const GRT::VectorDouble row_likelihoods = classifier.getClassLikelihoods();
+        for (uint32_t k = 0; k < class_labels.size() && k < row_likelihoods.size(); k++) {
+            if (class_labels[k] >= likelihoods.size()) { continue; }
+            likelihoods[class_labels[k]] += row_likelihoods[k];
+        }
+    }
+    normalize(&likelihoods);
+    return likelihoods;
+}
@@ -0,0 +1,102 @@
+/** @file block-prediction.h
+ *  @brief predictBlock(), which runs a block of samples through a pipeline
+ *  and writes the results to buffers the caller owns.
+ *
+ *  @verbatim
+ *  BlockPrediction prediction;  // keep it around to reuse its buffers
+ *  predictBlock(pipeline, test_data, &prediction);
+ *  for (uint32_t i = 0; i < test_data.getNumRows(); i++) {
+ *      // prediction.labels[i], prediction.likelihoods[i][k] for the class
+ *      // prediction.class_labels[k], ...
+ *  }
+ *  @endverbatim
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <GRT/GRT.h>
+
+#include "latency-histogram.h"
+
+/**
+ @brief The results of predictBlock(). Sample i of the block has row i in
+ every matrix (and entry i in every vector).
+ */
+struct BlockPrediction {
+    /// @brief Whether the sample made it through the pipeline. If not, its
+    /// other results are 0.
+    std::vector<bool> is_valid;
+
+    /// @brief The predicted label, or 0 for none (or an untrained pipeline).
+    std::vector<GRT::UINT> labels;
+
+    /// @brief The classifier's labels, in the order of the columns of
+    /// likelihoods and distances.
+    std::vector<GRT::UINT> class_labels;
+    GRT::MatrixDouble likelihoods;
+    GRT::MatrixDouble distances;
+
+    /// @brief The output of each pre-processing and feature extraction module,
+    /// with kKeepStageOutputs.
+    std::vector<GRT::MatrixDouble> pre_processed;
+    std::vector<GRT::MatrixDouble> features;
+
+    /// @brief If set, predictBlock() times each module for each sample, in a
+    /// histogram per module (named after it, e.g. "feature 1: MFCC").
+    LatencyProfile* latency = nullptr;
+};
+
+enum BlockPredictOptions {
+    /// @brief Fill BlockPrediction::pre_processed and ::features.
+    kKeepStageOutputs = 1,
+
+    /// @brief Only run the pre-processing and feature extraction modules, even
+    /// if the pipeline is trained.
+    kPreProcessOnly = 2,
+};
+
+/**
+ @brief Runs rows [begin, end) of block through the pipeline, one after the
+ other, as if each had been passed to predict() (or, for an untrained
+ pipeline or with kPreProcessOnly, preProcessData()).
+
+ The pipeline's modules keep state from sample to sample, so samples can't
+ be run through them in parallel; what this saves is the per-sample vectors
+ of calling predict() and the getters by hand. prediction is resized to the
+ rows that were run (with row 0 for row begin) and its buffers are reused
+ from call to call.
+
+ To time the modules (see BlockPrediction::latency), it calls them one by
+ one instead of through the pipeline, which gives the same results but
+ leaves the pipeline's own getPredictedClassLabel() behind. It doesn't run
+ context modules, which ESP doesn't use.
+
+ @return the number of samples that made it through the pipeline
+ */
+uint32_t predictBlock(GRT::GestureRecognitionPipeline& pipeline,
+                      const GRT::MatrixDouble& block, BlockPrediction* prediction,
+                      uint32_t options = 0, uint32_t begin = 0,
+                      uint32_t end = std::numeric_limits<uint32_t>::max());
+
+/**
+ @brief Runs sample through the pipeline, from a reset, and sums the class
+ likelihoods of its rows. Returns them indexed by label (0 to num_labels),
+ normalized to add up to 1. prediction is scratch space.
+ */
+std::vector<double> predictSampleLikelihoods(GRT::GestureRecognitionPipeline& pipeline,
+                                             const GRT::MatrixDouble& sample,
+                                             uint32_t num_labels,
+                                             BlockPrediction* prediction);
+
+/**
+ @brief Like predictSampleLikelihoods(), for a sample's rows as they reach
+ the classifier (e.g. from SampleFeatures::getClassifierInput()): runs them
+ through classifier alone, from a reset.
+ */
+std::vector<double> predictClassifierLikelihoods(GRT::Classifier& classifier,
+                                                 const GRT::MatrixDouble& rows,
+                                                 uint32_t num_labels);
@@ -1,4 +1,5 @@
-#include "ofApp.h"
+#include "ofMain.h"
+#include "runtime.h"
 
 #include "calibrator.h"
 
@@ -29,12 +30,21 @@ CalibrateResult::CalibrateResult(Result result, string message)
 Calibrator& Calibrator::setCalibrateFunction(SimpleCalibrateFunc f) {
     simple_calibrate_func_ = f;
     calibrate_func_ = nullptr;
+    block_calibrate_func_ = nullptr;
     return *this;
 }
 
 Calibrator& Calibrator::setCalibrateFunction(CalibrateFunc f) {
     simple_calibrate_func_ = nullptr;
     calibrate_func_ = f;
+    block_calibrate_func_ = nullptr;
+    return *this;
+}
+
+Calibrator& Calibrator::setBlockCalibrateFunction(BlockCalibrateFunc f) {
+    simple_calibrate_func_ = nullptr;
+    calibrate_func_ = nullptr;
+    block_calibrate_func_ = f;
     return *this;
 }
 
@@ -57,6 +67,9 @@ Calibrator& Calibrator::addCalibrateProcess(const string& name,
 vector<double> Calibrator::calibrate(vector<double> input) {
     if (calibrate_func_ != nullptr) {
         return calibrate_func_(input);
+    } else if (block_calibrate_func_ != nullptr) {
+        block_calibrate_func_(SampleBlock(input.data(), 1, input.size()));
+        return input;
     } else {
         assert(simple_calibrate_func_ != nullptr);
         vector<double> output;
@@ -66,6 +79,33 @@ vector<double> Calibrator::calibrate(vector<double> input) {
     }
 }
 
+void Calibrator::calibrate(GRT::MatrixDouble& data) {
+    if (block_calibrate_func_ != nullptr) {
+        forEachBlock(data, block_calibrate_func_);
+    } else if (calibrate_func_ != nullptr) {
+        const uint32_t cols = data.getNumCols();
+        uint32_t num_mismatched_rows = 0;
+        for (uint32_t i = 0; i < data.getNumRows(); i++) {
+            vector<double> output = calibrate_func_(data.getRowVector(i));
+            if (output.size() != cols) { num_mismatched_rows++; }
+            std::copy(output.begin(),
+                      output.begin() + std::min<size_t>(output.size(), cols), data[i]);
+        }
+        if (num_mismatched_rows > 0) {
+            ofLog(OF_LOG_ERROR) << "Calibration function returned the wrong number of "
+                                << "values (expected " << cols << ") for "
+                                << num_mismatched_rows << " rows";
+        }
+    } else {
+        assert(simple_calibrate_func_ != nullptr);
+        for (uint32_t i = 0; i < data.getNumRows(); i++) {
+            for (uint32_t j = 0; j < data.getNumCols(); j++) {
+                data[i][j] = simple_calibrate_func_(data[i][j]);
+            }
+        }
+    }
+}
+
 bool Calibrator::isCalibrated() {
     for (const auto& cp : calibrate_processes_) {
         if (!cp.isCalibrated()) {
@@ -75,6 +115,47 @@ bool Calibrator::isCalibrated() {
     return true;
 }
 
+CalibrateResult Calibrator::load(const string& filename, uint32_t num_dimensions) {
+    GRT::TimeSeriesClassificationData data;
+    if (!data.load(filename)) {
+        return CalibrateResult(CalibrateResult::FAILURE,
+                               "Failed to load calibration data from " + filename);
+    }
+
+    if (data.getNumSamples() != calibrate_processes_.size()) {
+        return CalibrateResult(CalibrateResult::FAILURE,
+                               "Number of samples in file differs from the "
+                               "number of calibration samples.");
+    }
+
+    if (data.getNumDimensions() != num_dimensions) {
+        return CalibrateResult(CalibrateResult::FAILURE,
+                               "Number of dimensions of data in file differs "
+                               "from the number of dimensions expected.");
+    }
+
+    CalibrateResult result(CalibrateResult::SUCCESS,
+                           "Calibration data is loaded from " + filename);
+    for (uint32_t i = 0; i < data.getNumSamples(); i++) {
+        CalibrateProcess& cp = calibrate_processes_[i];
+        if (data.getClassNameForCorrespondingClassLabel(i) != cp.getName()) {
+            ofLog(OF_LOG_WARNING) << "Name of saved calibration sample " << (i + 1) << " ('"
+                                  << data.getClassNameForCorrespondingClassLabel(i)
+                                  << "') differs from current calibration sample name ('"
+                                  << cp.getName() << "')";
+        }
+        cp.clear();
+        if (cp.calibrate(data[i].getData()).getResult() == CalibrateResult::FAILURE) {
+            ofLog(OF_LOG_WARNING) << "Failed to calibrate saved "
+                                  << "calibration sample " << (i + 1) << ": "
+                                  << cp.getName();
+            result = CalibrateResult(CalibrateResult::WARNING,
+                                     "Failed to calibrate " + cp.getName());
+        }
+    }
+    return result;
+}
+
 void Calibrator::registerCalibrateProcess(const CalibrateProcess& cp) {
     registered_.insert(cp.getName());
 }
@@ -85,5 +166,5 @@ bool Calibrator::isCalibrateProcessRegistered(const CalibrateProcess& cp) {
 
 
 void useCalibrator(Calibrator &calibrator) {
-    ((ofApp *) ofGetAppPtr())->useCalibrator(calibrator);
+    getRuntime()->useCalibrator(calibrator);
 }
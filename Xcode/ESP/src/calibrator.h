@@ -4,6 +4,8 @@
 #include <set>
 #include <string>
 
+#include "sample-block.h"
+
 /**
  @brief CalibrateResult indicates if the calibration is successful or not.
 
@@ -143,25 +145,39 @@ class Calibrator {
      */
     using CalibrateFunc = std::function<vector<double>(vector<double>)>;
 
+    /**
+     @brief Transforms a block of incoming samples in place.
+
+     BlockCalibrateFunc is called once per block of live data (typically all
+     the samples that arrived since the last frame) rather than once per
+     sample, and doesn't allocate. See sample-block.h for built-in ones, e.g.
+     AffineTransform for per-dimension scaling and offsets.
+     */
+    using BlockCalibrateFunc = BlockTransformFunc;
+
     /**
      Create a Calibrator without specifying a calibration function. If you use
      this constructor, you'll need to specify the calibration function with
      setCalibrateFunction().
      */
-    Calibrator() : simple_calibrate_func_(nullptr), calibrate_func_(nullptr) {}
+    Calibrator()
+            : simple_calibrate_func_(nullptr), calibrate_func_(nullptr),
+              block_calibrate_func_(nullptr) {}
 
     /**
      Create a Calibrator with the specified SimpleCalibrateFunc. This function
      will be applied to incoming live sensor data.
      */
     Calibrator(SimpleCalibrateFunc f)
-            : simple_calibrate_func_(f), calibrate_func_(nullptr) {}
+            : simple_calibrate_func_(f), calibrate_func_(nullptr),
+              block_calibrate_func_(nullptr) {}
     /**
      Create a Calibrator with the specified CalibrateFunc. This function will
      be applied to incoming live sensor data.
      */
     Calibrator(CalibrateFunc f)
-            : simple_calibrate_func_(nullptr), calibrate_func_(f) {}
+            : simple_calibrate_func_(nullptr), calibrate_func_(f),
+              block_calibrate_func_(nullptr) {}
 
     /**
      Set the calibration function. Replaces any currently set calibration
@@ -178,6 +194,14 @@ class Calibrator {
      @return *this, to allow for chaining of Calibrator methods
      */
     Calibrator& setCalibrateFunction(SimpleCalibrateFunc f);
+
+    /**
+     Set a calibration function that transforms blocks of samples in place.
+     Replaces any currently set calibration function.
+
+     @return *this, to allow for chaining of Calibrator methods
+     */
+    Calibrator& setBlockCalibrateFunction(BlockCalibrateFunc f);
     /**
      Add a CalibrateProcess to this Calibrator. The CalibrateProcess instances
      in the active Calibrator (as set by useCalibrator()) are the ones that
@@ -215,12 +239,30 @@ class Calibrator {
      */
     vector<double> calibrate(vector<double> input);
 
+    /**
+     * Calibrate each row of `data` in place, with whichever function is set.
+     * A BlockCalibrateFunc sees all the rows at once. If a CalibrateFunc
+     * returns the wrong number of values, the ones that fit the row are
+     * kept and the mismatch is logged.
+     */
+    void calibrate(GRT::MatrixDouble& data);
+
 
     /**
      * Returns true if all calibrate processes are calibrated.
      */
     bool isCalibrated();
 
+    /**
+     * Load calibration data saved by the ESP GUI (one sample per
+     * CalibrateProcess, in order) and calibrate each process with its sample.
+     *
+     * @param num_dimensions, the number of dimensions the data must have
+     * @return FAILURE (with the reason) if the file can't be used, WARNING if
+     * some of the processes failed to calibrate, SUCCESS otherwise
+     */
+    CalibrateResult load(const string& filename, uint32_t num_dimensions);
+
   private:
     void registerCalibrateProcess(const CalibrateProcess& cp);
 
@@ -228,6 +270,7 @@ class Calibrator {
 
     SimpleCalibrateFunc simple_calibrate_func_;
     CalibrateFunc calibrate_func_;
+    BlockCalibrateFunc block_calibrate_func_;
     vector<CalibrateProcess> calibrate_processes_;
     std::set<std::string> registered_;
 };
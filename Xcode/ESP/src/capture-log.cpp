@@ -0,0 +1,420 @@
+#include "capture-log.h"
+#include "ofMain.h"
+#include "runtime.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+static const char kChunkMagic[8] = { 'E', 'S', 'P', 'C', 'A', 'P', 'T', '1' };
+static const uint32_t kChunkVersion = 1;
+static const char* kChunkPrefix = "capture-";
+static const char* kChunkSuffix = ".espcap";
+
+// How often the maintenance thread checks for chunks that have aged out.
+static const std::chrono::seconds kMaintenanceInterval(1);
+
+void useCaptureLog(const string& directory, uint64_t max_bytes,
+                   uint64_t max_age_seconds) {
+    getRuntime()->useCaptureLog(directory, max_bytes, max_age_seconds);
+}
+
+static uint64_t getUnixTimeMicros() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(
+        system_clock::now().time_since_epoch()).count();
+}
+
+CaptureLog::CaptureLog(const string& directory, uint64_t max_bytes,
+                       uint64_t max_age_seconds, uint64_t chunk_bytes)
+        : directory_(ofToDataPath(directory, true)), max_bytes_(max_bytes),
+          max_age_us_(max_age_seconds * 1000000), chunk_bytes_(chunk_bytes),
+          num_dropped_(0) {
+}
+
+CaptureLog::~CaptureLog() {
+    close();
+}
+
+vector<string> CaptureLog::listChunkFiles(const string& directory) {
+    vector<string> names;
+    DIR* dir = opendir(directory.c_str());
+    if (dir == nullptr) { return names; }
+
+    const size_t prefix = strlen(kChunkPrefix), suffix = strlen(kChunkSuffix);
+    while (struct dirent* entry = readdir(dir)) {
+        string name = entry->d_name;
+        if (name.size() > prefix + suffix &&
+            name.compare(0, prefix, kChunkPrefix) == 0 &&
+            name.compare(name.size() - suffix, suffix, kChunkSuffix) == 0) {
+            names.push_back(name);
+        }
+    }
+    closedir(dir);
+
+    // Indices are zero-padded, so lexical order is chronological order.
+    std::sort(names.begin(), names.end());
+    for (string& name : names) { name = directory + "/" + name; }
+    return names;
+}
+
+unique_ptr<CaptureLog::Chunk> CaptureLog::openChunk(const string& path, bool writable) {
+    unique_ptr<Chunk> chunk(new Chunk());
+    chunk->path = path;
+    chunk->fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (chunk->fd < 0) { return nullptr; }
+
+    struct stat st;
+    if (fstat(chunk->fd, &st) != 0 || st.st_size < (off_t) sizeof(CaptureChunkHeader)) {
+        ::close(chunk->fd);
+        return nullptr;
+    }
+    chunk->size = st.st_size;
+
+    int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* p = mmap(nullptr, chunk->size, prot, MAP_SHARED, chunk->fd, 0);
+    if (p == MAP_FAILED) {
+        ::close(chunk->fd);
+        return nullptr;
+    }
+    chunk->header = static_cast<CaptureChunkHeader*>(p);
+    chunk->records = reinterpret_cast<double*>(chunk->header + 1);
+
+    const CaptureChunkHeader& h = *chunk->header;
+    const uint64_t record_bytes = sizeof(double) * (3 + h.num_dimensions);
+    if (memcmp(h.magic, kChunkMagic, sizeof(kChunkMagic)) != 0 ||
+        h.version != kChunkVersion || h.num_records > h.capacity ||
+        sizeof(CaptureChunkHeader) + h.capacity * record_bytes > chunk->size) {
+        ofLog(OF_LOG_WARNING) << "CaptureLog: ignoring invalid chunk " << path;
+        munmap(p, chunk->size);
+        ::close(chunk->fd);
+        return nullptr;
+    }
+    return chunk;
+}
+
+void CaptureLog::closeChunk(unique_ptr<Chunk> chunk) {
+    if (chunk == nullptr) { return; }
+    munmap(chunk->header, chunk->size);
+    ::close(chunk->fd);
+}
+
+unique_ptr<CaptureLog::Chunk> CaptureLog::createChunk(uint64_t index) {
+    char name[64];
+    snprintf(name, sizeof(name), "%s%010llu%s", kChunkPrefix,
+             (unsigned long long) index, kChunkSuffix);
+    const string path = directory_ + "/" + name;
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) { return nullptr; }
+    if (ftruncate(fd, chunk_bytes_) != 0) {
+        ::close(fd);
+        unlink(path.c_str());
+        return nullptr;
+    }
+
+    void* p = mmap(nullptr, chunk_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        ::close(fd);
+        unlink(path.c_str());
+        return nullptr;
+    }
+
+    // Touch every page now, so that the appending thread never takes a page
+    // fault that has to allocate disk blocks.
+    memset(p, 0, chunk_bytes_);
+
+    unique_ptr<Chunk> chunk(new Chunk());
+    chunk->path = path;
+    chunk->fd = fd;
+    chunk->size = chunk_bytes_;
+    chunk->header = static_cast<CaptureChunkHeader*>(p);
+    chunk->records = reinterpret_cast<double*>(chunk->header + 1);
+
+    CaptureChunkHeader& h = *chunk->header;
+    memcpy(h.magic, kChunkMagic, sizeof(kChunkMagic));
+    h.version = kChunkVersion;
+    h.num_dimensions = num_dimensions_;
+    h.chunk_index = index;
+    h.capacity = (chunk_bytes_ - sizeof(CaptureChunkHeader)) /
+                 (sizeof(double) * recordSize());
+    h.created_unix_time_us = getUnixTimeMicros();
+    return chunk;
+}
+
+bool CaptureLog::open(uint32_t num_dimensions) {
+    if (isOpen()) { return false; }
+    if (chunk_bytes_ < sizeof(CaptureChunkHeader) + sizeof(double) * (3 + num_dimensions)) {
+        ofLog(OF_LOG_ERROR) << "CaptureLog: chunks are too small for one sample";
+        return false;
+    }
+
+    mkdir(directory_.c_str(), 0755);  // fails harmlessly if it exists
+
+    num_dimensions_ = num_dimensions;
+    next_chunk_index_ = 0;
+    for (const string& path : listChunkFiles(directory_)) {
+        unique_ptr<Chunk> chunk = openChunk(path, false);
+        if (chunk == nullptr) { continue; }
+        next_chunk_index_ = std::max(next_chunk_index_, chunk->header->chunk_index + 1);
+        chunks_.push_back(std::move(chunk));
+    }
+
+    unique_ptr<Chunk> first = createChunk(next_chunk_index_++);
+    if (first == nullptr) {
+        ofLog(OF_LOG_ERROR) << "CaptureLog: can't create chunks in " << directory_;
+        while (!chunks_.empty()) {
+            closeChunk(std::move(chunks_.front()));
+            chunks_.pop_front();
+        }
+        num_dimensions_ = 0;
+        return false;
+    }
+    current_ = first.get();
+    chunks_.push_back(std::move(first));
+
+    is_closing_ = false;
+    maintenance_thread_ = std::thread(&CaptureLog::runMaintenance, this);
+    return true;
+}
+
+void CaptureLog::close() {
+    if (!isOpen()) { return; }
+
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        is_closing_ = true;
+    }
+    maintenance_needed_.notify_all();
+    maintenance_thread_.join();
+
+    sealChunk(current_);
+    current_ = nullptr;
+    while (!chunks_.empty()) {
+        closeChunk(std::move(chunks_.front()));
+        chunks_.pop_front();
+    }
+    if (spare_ != nullptr) {
+        // Never written to; don't leave an empty chunk behind.
+        string path = spare_->path;
+        closeChunk(std::move(spare_));
+        unlink(path.c_str());
+    }
+    num_dimensions_ = 0;
+}
+
+void CaptureLog::sealChunk(Chunk* chunk) {
+    chunk->header->sealed_unix_time_us = getUnixTimeMicros();
+}
+
+bool CaptureLog::rotate() {
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (spare_ == nullptr) { return false; }
+        sealChunk(current_);
+        current_ = spare_.get();
+        chunks_.push_back(std::move(spare_));
+    }
+    maintenance_needed_.notify_all();
+    return true;
+}
+
+bool CaptureLog::append(const double* sample, const SampleStamp& stamp) {
+    if (current_ == nullptr) { return false; }
+
+    CaptureChunkHeader* h = current_->header;
+    if (h->num_records == h->capacity) {
+        if (!rotate()) {
+            num_dropped_++;
+            return false;
+        }
+        h = current_->header;
+    }
+
+    double* record = current_->records + h->num_records * recordSize();
+    memcpy(record, &stamp.host_time_us, sizeof(double));
+    memcpy(record + 1, &stamp.sequence, sizeof(double));
+    memcpy(record + 2, &stamp.device_time_us, sizeof(double));
+    memcpy(record + 3, sample, sizeof(double) * num_dimensions_);
+
+    if (h->num_records == 0) {
+        h->first_sequence = stamp.sequence;
+        h->first_time_us = stamp.host_time_us;
+    }
+    h->last_time_us = stamp.host_time_us;
+    h->num_records++;
+    return true;
+}
+
+uint32_t CaptureLog::append(const GRT::MatrixDouble& data,
+                            const vector<SampleStamp>& stamps) {
+    if (data.getNumCols() != num_dimensions_) { return 0; }
+
+    uint32_t appended = 0;
+    for (uint32_t i = 0; i < data.getNumRows() && i < stamps.size(); i++) {
+        if (append(data[i], stamps[i])) { appended++; }
+    }
+    return appended;
+}
+
+static void readRecord(const double* record, uint32_t num_dimensions,
+                       double* sample, SampleStamp* stamp) {
+    if (stamp != nullptr) {
+        memcpy(&stamp->host_time_us, record, sizeof(double));
+        memcpy(&stamp->sequence, record + 1, sizeof(double));
+        memcpy(&stamp->device_time_us, record + 2, sizeof(double));
+    }
+    memcpy(sample, record + 3, sizeof(double) * num_dimensions);
+}
+
+uint32_t CaptureLog::readRecent(uint64_t offset_from_end, uint32_t count,
+                                GRT::MatrixDouble& out, vector<SampleStamp>* stamps) {
+    std::lock_guard<std::mutex> guard(mutex_);
+
+    // Find the newest record to copy, then walk backwards from it.
+    vector<const double*> records;
+    records.reserve(count);
+    uint64_t skip = offset_from_end;
+    for (auto it = chunks_.rbegin(); it != chunks_.rend() && records.size() < count; ++it) {
+        const CaptureChunkHeader& h = *(*it)->header;
+        if (h.num_dimensions != num_dimensions_) { continue; }
+
+        uint64_t n = h.num_records;
+        if (skip >= n) {
+            skip -= n;
+            continue;
+        }
+        n -= skip;
+        skip = 0;
+        while (n > 0 && records.size() < count) {
+            n--;
+            records.push_back((*it)->records + n * recordSize());
+        }
+    }
+
+    const uint32_t num_records = records.size();
+    if (num_records == 0) {
+        out.clear();
+        if (stamps != nullptr) { stamps->clear(); }
+        return 0;
+    }
+
+    out.resize(num_records, num_dimensions_);
+    if (stamps != nullptr) { stamps->resize(num_records); }
+    for (uint32_t i = 0; i < num_records; i++) {
+        // records is newest first.
+        const double* record = records[num_records - 1 - i];
+        readRecord(record, num_dimensions_, out[i],
+                   stamps != nullptr ? &(*stamps)[i] : nullptr);
+    }
+    return num_records;
+}
+
+uint64_t CaptureLog::getNumRetainedSamples() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    uint64_t n = 0;
+    for (const auto& chunk : chunks_) {
+        if (chunk->header->num_dimensions == num_dimensions_) {
+            n += chunk->header->num_records;
+        }
+    }
+    return n;
+}
+
+void CaptureLog::runMaintenance() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!is_closing_) {
+        bool creation_failed = false;
+        if (spare_ == nullptr) {
+            const uint64_t index = next_chunk_index_++;
+            lock.unlock();
+            unique_ptr<Chunk> chunk = createChunk(index);
+            lock.lock();
+            if (chunk == nullptr) {
+                ofLog(OF_LOG_ERROR) << "CaptureLog: can't create the next chunk in "
+                                    << directory_;
+                creation_failed = true;
+            }
+            spare_ = std::move(chunk);
+        }
+
+        lock.unlock();
+        applyRetention();
+        lock.lock();
+
+        // Wake up when the spare chunk has been used (unless creating one
+        // just failed), or periodically to expire old chunks.
+        maintenance_needed_.wait_for(lock, kMaintenanceInterval, [this, creation_failed]() {
+            return is_closing_ || (spare_ == nullptr && !creation_failed);
+        });
+    }
+}
+
+void CaptureLog::applyRetention() {
+    vector<unique_ptr<Chunk>> expired;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        uint64_t total_bytes = spare_ != nullptr ? spare_->size : 0;
+        for (const auto& chunk : chunks_) { total_bytes += chunk->size; }
+
+        const uint64_t now = getUnixTimeMicros();
+        // The chunk being written is never expired.
+        while (chunks_.size() > 1) {
+            const CaptureChunkHeader& h = *chunks_.front()->header;
+            const uint64_t end_time = h.sealed_unix_time_us != 0 ?
+                h.sealed_unix_time_us : h.created_unix_time_us;
+            const bool too_big = max_bytes_ != 0 && total_bytes > max_bytes_;
+            const bool too_old = max_age_us_ != 0 && now > end_time + max_age_us_;
+            if (!too_big && !too_old) { break; }
+
+            total_bytes -= chunks_.front()->size;
+            expired.push_back(std::move(chunks_.front()));
+            chunks_.pop_front();
+        }
+    }
+
+    for (auto& chunk : expired) {
+        string path = chunk->path;
+        closeChunk(std::move(chunk));
+        unlink(path.c_str());
+    }
+}
+
+bool CaptureLog::readAll(const string& directory, GRT::MatrixDouble& out,
+                         vector<SampleStamp>& stamps) {
+    out.clear();
+    stamps.clear();
+
+    uint32_t num_dimensions = 0;
+    vector<double> sample;
+    for (const string& path : listChunkFiles(directory)) {
+        unique_ptr<Chunk> chunk = openChunk(path, false);
+        if (chunk == nullptr) { continue; }
+
+        const CaptureChunkHeader& h = *chunk->header;
+        if (num_dimensions == 0) { num_dimensions = h.num_dimensions; }
+        if (h.num_dimensions != num_dimensions) {
+            ofLog(OF_LOG_WARNING) << "CaptureLog: skipping " << path
+                                  << ", which has a different number of dimensions";
+            closeChunk(std::move(chunk));
+            continue;
+        }
+
+        sample.resize(num_dimensions);
+        for (uint64_t i = 0; i < h.num_records; i++) {
+            SampleStamp stamp;
+            readRecord(chunk->records + i * (3 + num_dimensions), num_dimensions,
+                       sample.data(), &stamp);
+            out.push_back(sample);
+            stamps.push_back(stamp);
+        }
+        closeChunk(std::move(chunk));
+    }
+    return out.getNumRows() > 0;
+}
@@ -0,0 +1,176 @@
+/** @file capture-log.h
+ *  @brief CaptureLog, an always-on recorder that appends every raw input
+ *  sample to memory-mapped chunk files on disk.
+ *
+ *  @verbatim
+ *  useCaptureLog("capture", 512 << 20);  // keep the last 512 MB
+ *  useCaptureLog("capture", 0, 30 * 60); // keep the last 30 minutes
+ *  @endverbatim
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GRT/GRT.h"
+#include "sample-stamp.h"
+
+/**
+ @brief Header at the start of every chunk file. Doubles as the chunk's
+ index entry: it records which samples and which span of time the chunk
+ holds. All fields are in host byte order.
+ */
+struct CaptureChunkHeader {
+    char magic[8];            // "ESPCAPT1"
+    uint32_t version;
+    uint32_t num_dimensions;
+    uint64_t chunk_index;     // position of the chunk in the log
+    uint64_t capacity;        // number of records that fit in the chunk
+    uint64_t num_records;     // number of records written so far
+    uint64_t first_sequence;  // SampleStamp::sequence of the first record
+    uint64_t first_time_us;   // SampleStamp::host_time_us of the first record
+    uint64_t last_time_us;    // SampleStamp::host_time_us of the last record
+    // Wall-clock times (microseconds since the Unix epoch) for retention by
+    // age. sealed_unix_time_us is 0 until the chunk is full or closed.
+    uint64_t created_unix_time_us;
+    uint64_t sealed_unix_time_us;
+};
+
+/**
+ @brief Appends samples and their stamps to a directory of fixed-size chunk
+ files, deleting the oldest chunks to stay within a size or age budget.
+
+ Each record is the sample's host time, sequence number and device time
+ followed by its values, all 8 bytes wide. Chunks are named
+ capture-<index>.espcap and are memory-mapped, so appending is a copy into
+ memory; the kernel writes the pages back in the background.
+
+ Exactly one thread may append. Appending never blocks: a maintenance thread
+ creates (and pre-faults) the next chunk ahead of time and deletes expired
+ ones. If the next chunk isn't ready when the current one fills up, samples
+ are dropped and counted until it is.
+ */
+class CaptureLog {
+  public:
+    /**
+     @param directory: where to keep the chunk files. Relative paths are
+     resolved against the app's data directory. Chunks left there by an
+     earlier run count towards the retention limits.
+     @param max_bytes: delete the oldest chunks once all chunks together take
+     more than this. 0 means no limit.
+     @param max_age_seconds: delete chunks whose newest sample is older than
+     this. 0 means no limit.
+     @param chunk_bytes: the size of each chunk file.
+     */
+    CaptureLog(const string& directory, uint64_t max_bytes,
+               uint64_t max_age_seconds, uint64_t chunk_bytes = 4 << 20);
+    ~CaptureLog();
+
+    /// @brief Start recording samples of `num_dimensions` values.
+    bool open(uint32_t num_dimensions);
+
+    /// @brief Flush and unmap everything. Called by the destructor.
+    void close();
+
+    bool isOpen() const { return num_dimensions_ != 0; }
+
+    /// @brief Append one sample. Returns false if it had to be dropped.
+    bool append(const double* sample, const SampleStamp& stamp);
+
+    /// @brief Append every row of `data`, stamped by `stamps`.
+    uint32_t append(const GRT::MatrixDouble& data, const vector<SampleStamp>& stamps);
+
+    /**
+     Copy up to `count` consecutive samples into `out` (and their stamps into
+     `stamps`, if given). The last sample copied is the one `offset_from_end`
+     samples before the newest; samples from earlier runs with a different
+     number of dimensions are skipped. Must be called from the appending
+     thread. Returns the number of samples copied.
+     */
+    uint32_t readRecent(uint64_t offset_from_end, uint32_t count,
+                        GRT::MatrixDouble& out, vector<SampleStamp>* stamps = nullptr);
+
+    /// @brief Number of samples currently retained (and readable).
+    uint64_t getNumRetainedSamples();
+
+    /// @brief Number of samples dropped because no chunk was ready.
+    uint64_t getNumDropped() const { return num_dropped_.load(); }
+
+    /**
+     Read every sample in the chunk files in `directory`, oldest first.
+     Used to replay a capture (see ReplayStream).
+     */
+    static bool readAll(const string& directory, GRT::MatrixDouble& out,
+                        vector<SampleStamp>& stamps);
+
+  private:
+    struct Chunk {
+        string path;
+        int fd = -1;
+        size_t size = 0;
+        CaptureChunkHeader* header = nullptr;
+        double* records = nullptr;
+    };
+
+    static unique_ptr<Chunk> openChunk(const string& path, bool writable);
+    static void closeChunk(unique_ptr<Chunk> chunk);
+
+    static vector<string> listChunkFiles(const string& directory);
+
+    unique_ptr<Chunk> createChunk(uint64_t index);
+    void sealChunk(Chunk* chunk);
+    bool rotate();
+    void runMaintenance();
+    void applyRetention();
+
+    uint32_t recordSize() const { return 3 + num_dimensions_; }
+
+    const string directory_;
+    const uint64_t max_bytes_;
+    const uint64_t max_age_us_;
+    const uint64_t chunk_bytes_;
+    uint32_t num_dimensions_ = 0;
+
+    // Every retained chunk, oldest first. The last one is being written.
+    // Guarded by mutex_, which is only held to move chunks in and out, never
+    // for file I/O.
+    std::deque<unique_ptr<Chunk>> chunks_;
+    // chunks_.back(), kept separately so that appending needn't lock.
+    Chunk* current_ = nullptr;
+    // The next chunk to write, created ahead of time by the maintenance
+    // thread.
+    unique_ptr<Chunk> spare_;
+    uint64_t next_chunk_index_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable maintenance_needed_;
+    bool is_closing_ = false;
+    std::thread maintenance_thread_;
+
+    std::atomic<uint64_t> num_dropped_;
+
+    // Disallow copy and assign
+    CaptureLog(CaptureLog&) = delete;
+    void operator=(CaptureLog) = delete;
+};
+
+/**
+ Tells the ESP system to record every sample from the input stream to disk.
+ Call from your setup() function. While the input is paused (press `p`), the
+ recorded history can be browsed with `[` and `]` and cut into training
+ samples like the live plot.
+
+ @param directory: where to keep the recording
+ @param max_bytes: disk space the recording may use; 0 means no limit
+ @param max_age_seconds: how long to keep samples; 0 means no limit
+ */
+void useCaptureLog(const string& directory, uint64_t max_bytes,
+                   uint64_t max_age_seconds = 0);
@@ -0,0 +1,115 @@
+#include "cross-validation.h"
+#include "gtest/gtest.h"
+
+#include "training-data-manager.h"
+
+TEST(CrossValidatorTest, KFoldSpreadsEachClassOverTheFolds) {
+    // Label 0 is never used for training data.
+    auto folds = CrossValidator::assignFolds({ 0, 4, 2 }, 3);
+
+    ASSERT_EQ(3, folds.size());
+    EXPECT_TRUE(folds[0].empty());
+    EXPECT_EQ((std::vector<uint32_t>{ 0, 1, 2, 0 }), folds[1]);
+    EXPECT_EQ((std::vector<uint32_t>{ 1, 2 }), folds[2]);
+}
+
+TEST(CrossValidatorTest, LeaveOneOutGivesEverySampleItsOwnFold) {
+    auto folds = CrossValidator::assignFolds(
+        { 0, 2, 3 }, CrossValidator::kLeaveOneOut);
+
+    EXPECT_EQ((std::vector<uint32_t>{ 0, 1 }), folds[1]);
+    EXPECT_EQ((std::vector<uint32_t>{ 2, 3, 4 }), folds[2]);
+}
+
+// Pairs of samples, one of each label, far from the other pairs. With K = 1,
+// a sample left out of training is predicted as its pair's label, and one
+// left in as its own.
+class CrossValidatorRunTest : public ::testing::Test {
+  protected:
+    virtual void SetUp() {
+        manager.setNumDimensions(1);
+        GRT::MatrixDouble sample(3, 1);
+        for (uint32_t i = 0; i < kNumPairs; i++) {
+            for (uint32_t label = 1; label <= 2; label++) {
+                sample.setAllValues(10.0 * i + 0.01 * label);
+                manager.addSample(label, sample);
+            }
+        }
+
+        pipeline.setClassifier(GRT::KNN(1));
+        ASSERT_TRUE(pipeline.train(manager.getAllData()));
+        cache.update(manager, FeatureCache::computeKey(pipeline));
+    }
+
+    bool start(uint32_t num_folds) {
+        return validator.start(pipeline, manager.getAllData(), 2, num_folds,
+                               manager.getVersion(), &cache);
+    }
+
+    static const uint32_t kNumPairs = 4;
+
+    TrainingDataManager manager{2};
+    GRT::GestureRecognitionPipeline pipeline;
+    FeatureCache cache;
+    CrossValidator validator{2};
+};
+
+TEST_F(CrossValidatorRunTest, ScoresEverySampleWithoutIt) {
+    ASSERT_TRUE(start(CrossValidator::kLeaveOneOut));
+    validator.wait();
+
+    CrossValidator::Result result;
+    ASSERT_TRUE(validator.takeResult(&result));
+    EXPECT_FALSE(result.is_cancelled);
+    EXPECT_EQ(2 * kNumPairs, result.num_folds);
+    EXPECT_EQ(0, result.num_failed_folds);
+    EXPECT_EQ(manager.getVersion(), result.data_version);
+    EXPECT_FALSE(validator.isBusy());
+
+    ASSERT_EQ(3, result.likelihoods.size());
+    for (uint32_t label = 1; label <= 2; label++) {
+        const uint32_t other_label = 3 - label;
+        ASSERT_EQ(kNumPairs, result.likelihoods[label].size());
+        for (uint32_t i = 0; i < kNumPairs; i++) {
+            const std::vector<double>& likelihoods = result.likelihoods[label][i];
+            ASSERT_EQ(3, likelihoods.size()) << "label " << label << ", sample " << i;
+            EXPECT_LT(likelihoods[label], likelihoods[other_label])
+                << "label " << label << ", sample " << i;
+        }
+    }
+}
+
+TEST_F(CrossValidatorRunTest, CancelledRunsSaySo) {
+    ASSERT_TRUE(start(CrossValidator::kLeaveOneOut));
+    validator.cancel();
+    validator.wait();
+
+    CrossValidator::Result result;
+    ASSERT_TRUE(validator.takeResult(&result));
+    EXPECT_TRUE(result.is_cancelled);
+    EXPECT_FALSE(validator.isBusy());
+
+    // A cancelled validator can start again.
+    EXPECT_TRUE(start(2));
+    validator.wait();
+    ASSERT_TRUE(validator.takeResult(&result));
+    EXPECT_FALSE(result.is_cancelled);
+}
+
+TEST_F(CrossValidatorRunTest, RejectsTooFewSamples) {
+    TrainingDataManager one_sample(2);
+    one_sample.setNumDimensions(1);
+    one_sample.addSample(1, manager.getSample(1, 0));
+    FeatureCache one_sample_cache;
+    one_sample_cache.update(one_sample, FeatureCache::computeKey(pipeline));
+    EXPECT_FALSE(validator.start(pipeline, one_sample.getAllData(), 2,
+                                 CrossValidator::kLeaveOneOut, one_sample.getVersion(),
+                                 &one_sample_cache));
+    EXPECT_FALSE(validator.isBusy());
+}
+
+TEST_F(CrossValidatorRunTest, RejectsAStaleCache) {
+    manager.addSample(1, manager.getSample(1, 0));
+    EXPECT_FALSE(start(2));
+    EXPECT_FALSE(validator.isBusy());
+}
@@ -0,0 +1,190 @@
+#include "cross-validation.h"
+
+#include <algorithm>
+
+#include "block-prediction.h"
+#include "incremental-trainer.h"
+#include "latency-histogram.h"
+
+CrossValidator::CrossValidator(uint32_t num_threads)
+        : num_threads_(num_threads != 0 ? num_threads :
+                       std::max(1u, std::thread::hardware_concurrency())),
+          num_running_workers_(0), next_missing_(0), next_fold_(0), num_done_folds_(0),
+          num_failed_folds_(0), should_cancel_(false) {
+}
+
+CrossValidator::~CrossValidator() {
+    cancel();
+    wait();
+}
+
+std::vector<std::vector<uint32_t>> CrossValidator::assignFolds(
+    const std::vector<uint32_t>& num_samples_per_label, uint32_t num_folds) {
+    std::vector<std::vector<uint32_t>> folds(num_samples_per_label.size());
+    uint32_t n = 0;
+    for (size_t label = 0; label < num_samples_per_label.size(); label++) {
+        for (uint32_t i = 0; i < num_samples_per_label[label]; i++) {
+            folds[label].push_back(num_folds == kLeaveOneOut ? n : n % num_folds);
+            n++;
+        }
+    }
+    return folds;
+}
+
+bool CrossValidator::start(const GRT::GestureRecognitionPipeline& pipeline,
+                           const GRT::TimeSeriesClassificationData& data,
+                           uint32_t num_labels, uint32_t num_folds,
+                           uint64_t data_version, FeatureCache* cache) {
+    if (isBusy() || cache == nullptr) { return false; }
+
+    // Check everything before changing any member, so that a start() that
+    // fails leaves the validator as it was.
+    std::vector<GRT::TimeSeriesClassificationData> class_data(num_labels + 1);
+    std::vector<uint32_t> num_samples_per_label(num_labels + 1, 0);
+    for (uint32_t label = 1; label <= num_labels; label++) {
+        class_data[label] = data.getClassData(label);
+        num_samples_per_label[label] = class_data[label].getNumSamples();
+    }
+    const uint32_t num_samples = data.getNumSamples();
+    if (num_folds == kLeaveOneOut || num_folds > num_samples) { num_folds = num_samples; }
+    if (num_folds < 2) { return false; }  // nothing to train the last fold on
+
+    FeatureCache::Snapshot features = cache->getSnapshot();
+    if (features.entries.size() != num_labels + 1) { return false; }
+    std::vector<std::pair<uint32_t, uint32_t>> missing;
+    for (uint32_t label = 1; label <= num_labels; label++) {
+        if (features.entries[label].size() != num_samples_per_label[label]) { return false; }
+        for (uint32_t i = 0; i < num_samples_per_label[label]; i++) {
+            if (features.entries[label][i] == nullptr) { missing.emplace_back(label, i); }
+        }
+    }
+
+    prototype_ = pipeline;
+    num_dimensions_ = data.getNumDimensions();
+    class_data_ = std::move(class_data);
+    folds_ = assignFolds(num_samples_per_label, num_folds);
+    cache_ = cache;
+    features_ = std::move(features);
+    missing_ = std::move(missing);
+
+    result_ = Result();
+    result_.num_folds = num_folds;
+    result_.data_version = data_version;
+    result_.likelihoods.resize(num_labels + 1);
+    for (uint32_t label = 1; label <= num_labels; label++) {
+        result_.likelihoods[label].resize(num_samples_per_label[label]);
+    }
+
+    next_missing_ = 0;
+    next_fold_ = 0;
+    num_done_folds_ = 0;
+    num_failed_folds_ = 0;
+    should_cancel_ = false;
+    start_ns_ = getMonotonicNanos();
+
+    const uint32_t num_workers = std::min(num_threads_, num_folds);
+    num_running_workers_ = num_workers;
+    num_filling_workers_ = num_workers;
+    for (uint32_t i = 0; i < num_workers; i++) {
+        workers_.emplace_back(&CrossValidator::runWorker, this);
+    }
+    return true;
+}
+
+void CrossValidator::cancel() {
+    should_cancel_ = true;
+}
+
+std::string CrossValidator::getProgress() const {
+    return "fold " + std::to_string(num_done_folds_) + " / " +
+        std::to_string(result_.num_folds);
+}
+
+bool CrossValidator::takeResult(Result* result) {
+    if (!isBusy() || num_running_workers_ != 0) { return false; }
+    wait();
+    workers_.clear();
+    features_ = FeatureCache::Snapshot();
+
+    result_.is_cancelled = should_cancel_;
+    result_.num_failed_folds = num_failed_folds_;
+    result_.seconds = (getMonotonicNanos() - start_ns_) / 1e9;
+    *result = std::move(result_);
+    result_ = Result();
+    return true;
+}
+
+void CrossValidator::wait() {
+    for (std::thread& worker : workers_) {
+        if (worker.joinable()) { worker.join(); }
+    }
+}
+
+void CrossValidator::runWorker() {
+    // One clone per worker: train() starts its model over for every fold.
+    std::unique_ptr<GRT::GestureRecognitionPipeline> pipeline;
+    {
+        std::lock_guard<std::mutex> guard(prototype_mutex_);
+        pipeline.reset(new GRT::GestureRecognitionPipeline(prototype_));
+    }
+
+    fillFeatures(*pipeline);
+    for (uint32_t fold = next_fold_++; fold < result_.num_folds && !should_cancel_;
+         fold = next_fold_++) {
+        if (!runFold(*pipeline, fold)) { num_failed_folds_++; }
+        num_done_folds_++;
+    }
+    num_running_workers_--;
+}
+
+void CrossValidator::fillFeatures(GRT::GestureRecognitionPipeline& pipeline) {
+    for (uint32_t k = next_missing_++; k < missing_.size() && !should_cancel_;
+         k = next_missing_++) {
+        const uint32_t label = missing_[k].first;
+        const uint32_t i = missing_[k].second;
+        FeatureCache::Entry entry =
+            SampleFeatures::compute(pipeline, class_data_[label][i].getData());
+        features_.entries[label][i] = entry;
+        cache_->put(features_.key, features_.data_version, label, i, entry);
+    }
+    pipeline.reset();
+
+    std::unique_lock<std::mutex> lock(fill_mutex_);
+    if (--num_filling_workers_ == 0) { fill_done_.notify_all(); }
+    fill_done_.wait(lock, [this] { return num_filling_workers_ == 0; });
+}
+
+bool CrossValidator::runFold(GRT::GestureRecognitionPipeline& pipeline, uint32_t fold) {
+    const uint32_t num_labels = class_data_.size() - 1;
+
+    // KNN and ANBC are trained on the cached rows; other classifiers (e.g.
+    // DTW) through the pipeline, on the samples themselves.
+    bool is_trained;
+    if (canTrainClassifierAlone(pipeline)) {
+        is_trained = trainClassifier(
+            *pipeline.getClassifier(), features_,
+            [&](uint32_t label, uint32_t i) { return folds_[label][i] != fold; });
+    } else {
+        GRT::TimeSeriesClassificationData training_data;
+        training_data.setNumDimensions(num_dimensions_);
+        for (uint32_t label = 1; label <= num_labels; label++) {
+            for (uint32_t i = 0; i < folds_[label].size(); i++) {
+                if (folds_[label][i] != fold) {
+                    training_data.addSample(label, class_data_[label][i].getData());
+                }
+            }
+        }
+        is_trained = pipeline.train(training_data);
+    }
+    if (!is_trained) { return false; }
+
+    for (uint32_t label = 1; label <= num_labels && !should_cancel_; label++) {
+        for (uint32_t i = 0; i < folds_[label].size(); i++) {
+            if (folds_[label][i] != fold) { continue; }
+            result_.likelihoods[label][i] = predictClassifierLikelihoods(
+                *pipeline.getClassifier(), features_.entries[label][i]->getClassifierInput(),
+                num_labels);
+        }
+    }
+    return true;
+}
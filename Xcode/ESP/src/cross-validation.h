@@ -0,0 +1,123 @@
+/** @file cross-validation.h
+ *  @brief CrossValidator, which scores each training sample with a pipeline
+ *  trained without it: leave-one-out, or k-fold for larger data sets. The
+ *  folds are trained in parallel, each on a clone of the pipeline.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GRT/GRT.h>
+
+#include "feature-cache.h"
+
+class CrossValidator {
+  public:
+    /// @brief As the number of folds: one fold per sample.
+    static const uint32_t kLeaveOneOut = 0;
+
+    struct Result {
+        bool is_cancelled = false;
+        uint32_t num_folds = 0;
+        uint32_t num_failed_folds = 0;
+
+        /// @brief likelihoods[label][index]: the class likelihoods of each
+        /// sample (see predictSampleLikelihoods()) from the pipeline trained
+        /// without its fold. Empty for samples whose fold failed to train.
+        std::vector<std::vector<std::vector<double>>> likelihoods;
+
+        /// @brief As passed to start().
+        uint64_t data_version = 0;
+
+        double seconds = 0;
+    };
+
+    /// @brief num_threads of 0 uses one per core.
+    explicit CrossValidator(uint32_t num_threads = 0);
+    ~CrossValidator();
+
+    /**
+     @brief Starts cross-validating pipeline's configuration on data (labels
+     1 to num_labels), which are copied. The samples' front-end output comes
+     from cache, which must be up to date with data and pipeline (see
+     FeatureCache::update()); the workers compute what's missing first, so
+     each sample goes through the front end once rather than once per fold.
+     Returns false, and does nothing, if a run is still going or hasn't been
+     taken yet.
+     */
+    bool start(const GRT::GestureRecognitionPipeline& pipeline,
+               const GRT::TimeSeriesClassificationData& data, uint32_t num_labels,
+               uint32_t num_folds, uint64_t data_version, FeatureCache* cache);
+
+    /// @brief Asks the run to stop after the folds being trained.
+    void cancel();
+
+    /// @brief Whether a run has been started and not yet taken.
+    bool isBusy() const { return !workers_.empty(); }
+
+    /// @brief How far the current run is, e.g. "fold 3 / 10".
+    std::string getProgress() const;
+
+    /**
+     @brief If a run has finished, moves its result into result and returns
+     true, making the validator ready for another start(). Doesn't block.
+     */
+    bool takeResult(Result* result);
+
+    /// @brief Blocks until the current run, if any, finishes.
+    void wait();
+
+    /**
+     @brief Which fold each sample is in, as [label][index], for labels with
+     the given numbers of samples (num_samples_per_label[0] is for label 0).
+     Samples are dealt out to the folds in turn, label by label, so that
+     every fold gets its share of each class.
+     */
+    static std::vector<std::vector<uint32_t>> assignFolds(
+        const std::vector<uint32_t>& num_samples_per_label, uint32_t num_folds);
+
+  private:
+    void runWorker();
+    void fillFeatures(GRT::GestureRecognitionPipeline& pipeline);
+    bool runFold(GRT::GestureRecognitionPipeline& pipeline, uint32_t fold);
+
+    const uint32_t num_threads_;
+    std::vector<std::thread> workers_;
+    std::atomic<uint32_t> num_running_workers_;
+    std::atomic<uint32_t> next_missing_;
+    std::atomic<uint32_t> next_fold_;
+    std::atomic<uint32_t> num_done_folds_;
+    std::atomic<uint32_t> num_failed_folds_;
+    std::atomic_bool should_cancel_;
+    uint64_t start_ns_ = 0;
+
+    // Set by start() and only read by the workers.
+    GRT::GestureRecognitionPipeline prototype_;
+    std::vector<GRT::TimeSeriesClassificationData> class_data_;  // by label
+    std::vector<std::vector<uint32_t>> folds_;
+    uint32_t num_dimensions_ = 0;
+    std::mutex prototype_mutex_;  // guards copying prototype_
+
+    // The workers fill in the missing entries, each its own, before any of
+    // them starts on the folds.
+    FeatureCache* cache_ = nullptr;
+    FeatureCache::Snapshot features_;
+    std::vector<std::pair<uint32_t, uint32_t>> missing_;  // (label, index)
+    std::mutex fill_mutex_;
+    std::condition_variable fill_done_;
+    uint32_t num_filling_workers_ = 0;
+
+    // Each worker writes only the entries of the samples in its folds.
+    Result result_;
+
+    // Disallow copy and assign
+    CrossValidator(CrossValidator&) = delete;
+    void operator=(CrossValidator) = delete;
+};
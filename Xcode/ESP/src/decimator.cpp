@@ -0,0 +1,84 @@
+#include "decimator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Filter length per unit of decimation factor. Longer filters have a sharper
+// transition band.
+static const uint32_t kTapsPerFactor = 16;
+
+// Cutoff as a fraction of the output Nyquist frequency, leaving room for the
+// transition band below it.
+static const double kCutoffFraction = 0.9;
+
+Decimator::Decimator()
+        : factor_(1), num_channels_(0), num_taps_(0), position_(0), countdown_(0) {
+}
+
+bool Decimator::setup(uint32_t factor, uint32_t num_channels) {
+    if (factor == 0 || num_channels == 0) { return false; }
+
+    factor_ = factor;
+    num_channels_ = num_channels;
+    num_taps_ = factor == 1 ? 1 : kTapsPerFactor * factor + 1;
+
+    // Blackman-windowed sinc, normalized to unity gain at DC.
+    taps_.resize(num_taps_);
+    const double cutoff = kCutoffFraction * 0.5 / factor;  // cycles per sample
+    const double middle = (num_taps_ - 1) / 2.0;
+    double sum = 0;
+    for (uint32_t i = 0; i < num_taps_; i++) {
+        double t = i - middle;
+        double sinc = (t == 0) ? 2 * cutoff : sin(2 * M_PI * cutoff * t) / (M_PI * t);
+        double window = (num_taps_ == 1) ? 1 :
+            0.42 - 0.5 * cos(2 * M_PI * i / (num_taps_ - 1)) +
+            0.08 * cos(4 * M_PI * i / (num_taps_ - 1));
+        taps_[i] = sinc * window;
+        sum += taps_[i];
+    }
+    for (float& tap : taps_) { tap /= sum; }
+
+    history_.resize(2 * num_taps_ * num_channels_);
+    reset();
+    return true;
+}
+
+void Decimator::reset() {
+    std::fill(history_.begin(), history_.end(), 0.0f);
+    position_ = 0;
+    countdown_ = factor_ - 1;
+}
+
+uint32_t Decimator::process(const float* in, uint32_t num_frames, float* out) {
+    if (factor_ == 1) {
+        std::memcpy(out, in, sizeof(float) * num_frames * num_channels_);
+        return num_frames;
+    }
+
+    uint32_t num_out = 0;
+    for (uint32_t n = 0; n < num_frames; n++) {
+        for (uint32_t c = 0; c < num_channels_; c++) {
+            float* h = &history_[2 * num_taps_ * c];
+            h[position_] = h[position_ + num_taps_] = in[n * num_channels_ + c];
+        }
+        position_ = (position_ + 1) % num_taps_;
+
+        if (countdown_ > 0) {
+            countdown_--;
+            continue;
+        }
+        countdown_ = factor_ - 1;
+
+        // The window [position_, position_ + num_taps_) runs oldest to
+        // newest; the filter is symmetric, so tap order doesn't matter.
+        for (uint32_t c = 0; c < num_channels_; c++) {
+            const float* window = &history_[2 * num_taps_ * c + position_];
+            float acc = 0;
+            for (uint32_t k = 0; k < num_taps_; k++) { acc += taps_[k] * window[k]; }
+            out[num_out * num_channels_ + c] = acc;
+        }
+        num_out++;
+    }
+    return num_out;
+}
@@ -0,0 +1,60 @@
+/** @file decimator.h
+ *  @brief Decimator, an anti-aliased integer-factor downsampler for
+ *  interleaved multichannel float audio.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ @brief Low-pass filters and downsamples audio by an integer factor.
+
+ The filter is a windowed-sinc FIR with its cutoff just below the new Nyquist
+ frequency. It is only evaluated at the samples that are kept (the polyphase
+ form of decimation), so the cost is proportional to the output rate.
+
+ setup() allocates; process() doesn't allocate or lock and may be called from
+ an audio thread.
+ */
+class Decimator {
+  public:
+    Decimator();
+
+    /// @brief Prepare to decimate `num_channels` interleaved channels by
+    /// `factor`. A factor of 1 passes samples through unchanged.
+    bool setup(uint32_t factor, uint32_t num_channels);
+
+    uint32_t getFactor() const { return factor_; }
+    uint32_t getNumChannels() const { return num_channels_; }
+
+    /// @brief The most output frames process() can produce from
+    /// `num_frames` input frames.
+    uint32_t getMaxOutputFrames(uint32_t num_frames) const {
+        return (num_frames + factor_ - 1) / factor_;
+    }
+
+    /// @brief Filter `num_frames` interleaved frames from `in` and write the
+    /// kept frames, interleaved, to `out`. Returns the number of frames
+    /// written. Filter state carries over between calls.
+    uint32_t process(const float* in, uint32_t num_frames, float* out);
+
+    /// @brief Forget all past input.
+    void reset();
+
+  private:
+    uint32_t factor_;
+    uint32_t num_channels_;
+    uint32_t num_taps_;
+
+    std::vector<float> taps_;
+
+    // Per channel, the last num_taps_ inputs, stored twice in a row so that
+    // the filter window is always contiguous.
+    std::vector<float> history_;
+    uint32_t position_;
+
+    // Input frames until the next output frame.
+    uint32_t countdown_;
+};
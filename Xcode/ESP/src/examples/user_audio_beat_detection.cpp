@@ -5,6 +5,8 @@
 
 //AudioStream stream(1);
 AudioFileStream stream("train1.wav", true);
+// To evaluate the pipeline over the whole file as fast as possible:
+//AudioFileStream stream("train1.wav", false, AudioFileStream::BATCH);
 GestureRecognitionPipeline pipeline;
 TcpOStream oStream("localhost", 5204);
 ASCIISerialStream oStream2(0, 9600, 3);
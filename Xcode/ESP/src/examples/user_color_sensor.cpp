@@ -3,18 +3,6 @@
  */
 #include <ESP.h>
 
-// Normalize by dividing each dimension by the total magnitude.
-// Also add the magnitude as an additional feature.
-vector<double> normalize(vector<double> input) {
-    double magnitude = 0.0;
-
-    for (int i = 0; i < input.size(); i++) magnitude += (input[i] * input[i]);
-    magnitude = sqrt(magnitude);
-    for (int i = 0; i < input.size(); i++) input[i] /= magnitude;
-
-    return input;
-}
-
 ASCIISerialStream stream(0, 9600, 3);
 GestureRecognitionPipeline pipeline;
 TcpOStream oStream("localhost", 5204, 3, "l", "r", " ");
@@ -25,7 +13,8 @@ bool send_repeated_predictions = false;
 int timeout = 100;
 
 void setup() {
-    stream.useNormalizer(normalize);
+    // Normalize by dividing each dimension by the total magnitude.
+    stream.useBlockNormalizer(VectorNormalization());
     stream.setLabelsForAllDimensions({"red", "green", "blue"});
     useInputStream(stream);
     useOutputStream(oStream);
@@ -0,0 +1,75 @@
+#include "feature-cache.h"
+#include "gtest/gtest.h"
+
+static const uint64_t kKey = 42;
+
+class FeatureCacheTest : public ::testing::Test {
+  protected:
+    virtual void SetUp() {
+        manager.setNumDimensions(1);
+        GRT::MatrixDouble sample(1, 1);
+        for (uint32_t i = 0; i < 3; i++) {
+            sample[0][0] = i;
+            manager.addSample(1, sample);
+        }
+        manager.addSample(2, sample);
+
+        cache.update(manager, kKey);
+        for (uint32_t label = 1; label <= 2; label++) {
+            for (uint32_t i = 0; i < manager.getNumSampleForLabel(label); i++) {
+                put(label, i);
+            }
+        }
+    }
+
+    // Puts an entry for (label, index) whose output is the sample's value.
+    FeatureCache::Entry put(uint32_t label, uint32_t index) {
+        std::shared_ptr<SampleFeatures> entry(new SampleFeatures());
+        entry->outputs = manager.getSample(label, index);
+        cache.put(kKey, manager.getVersion(), label, index, entry);
+        return entry;
+    }
+
+    TrainingDataManager manager{2};
+    FeatureCache cache;
+};
+
+TEST_F(FeatureCacheTest, KeepsEntriesWhileNothingChanges) {
+    cache.update(manager, kKey);
+    EXPECT_EQ(0, cache.getSnapshot().getNumMissing());
+}
+
+TEST_F(FeatureCacheTest, DropsOnlyEditedSamples) {
+    FeatureCache::Entry last = cache.get(1, 2);
+    manager.trimSample(1, 0, 0, 1);
+    manager.deleteSample(1, 1);
+    cache.update(manager, kKey);
+
+    EXPECT_EQ(nullptr, cache.get(1, 0));
+    EXPECT_EQ(last, cache.get(1, 1));  // moved up with its sample
+    EXPECT_NE(nullptr, cache.get(2, 0));
+    EXPECT_EQ(1, cache.getSnapshot().getNumMissing());
+}
+
+TEST_F(FeatureCacheTest, RelabeledSamplesKeepTheirEntries) {
+    FeatureCache::Entry entry = cache.get(1, 0);
+    manager.relabelSample(1, 0, 2);
+    cache.update(manager, kKey);
+
+    EXPECT_EQ(entry, cache.get(2, 1));
+    EXPECT_EQ(0, cache.getSnapshot().getNumMissing());
+}
+
+TEST_F(FeatureCacheTest, DropsEverythingWhenTheKeyChanges) {
+    cache.update(manager, kKey + 1);
+    EXPECT_EQ(4, cache.getSnapshot().getNumMissing());
+}
+
+TEST_F(FeatureCacheTest, IgnoresEntriesComputedForAnOldVersion) {
+    const uint64_t version = manager.getVersion();
+    manager.addSample(2, manager.getSample(1, 0));
+    cache.update(manager, kKey);
+
+    cache.put(kKey, version, 2, 1, std::make_shared<SampleFeatures>());
+    EXPECT_EQ(nullptr, cache.get(2, 1));
+}
@@ -0,0 +1,237 @@
+#include "feature-cache.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Long enough for the windows of the front ends ESP's examples use (e.g. a
+// 512-point FFT) to fill up a few times over.
+static const uint32_t kProbeLength = 2048;
+
+GRT::MatrixDouble SampleFeatures::getClassifierInput() const {
+    GRT::MatrixDouble rows;
+    for (uint32_t i = 0; i < is_ready.size(); i++) {
+        if (is_ready[i]) { rows.push_back(outputs.getRowVector(i)); }
+    }
+    return rows;
+}
+
+// The last module's output for the row just run through pipeline.
+static GRT::VectorDouble getFrontEndOutput(const GRT::GestureRecognitionPipeline& pipeline,
+                                           const GRT::VectorDouble& input, bool* is_ready) {
+    const uint32_t num_pre_processing = pipeline.getNumPreProcessingModules();
+    const uint32_t num_features = pipeline.getNumFeatureExtractionModules();
+    *is_ready = true;
+    if (num_features > 0) {
+        *is_ready =
+            pipeline.getFeatureExtractionModule(num_features - 1)->getFeatureDataReady();
+        return pipeline.getFeatureExtractionData();
+    }
+    if (num_pre_processing > 0) { return pipeline.getPreProcessedData(); }
+    return input;
+}
+
+std::shared_ptr<const SampleFeatures> SampleFeatures::compute(
+    GRT::GestureRecognitionPipeline& pipeline, const GRT::MatrixDouble& sample) {
+    std::shared_ptr<SampleFeatures> features(new SampleFeatures());
+    const uint32_t n = sample.getNumRows();
+    features->is_valid.assign(n, false);
+    features->is_ready.assign(n, false);
+
+    pipeline.reset();
+    for (uint32_t i = 0; i < n; i++) {
+        GRT::VectorDouble input = sample.getRowVector(i);
+        if (!pipeline.preProcessData(input)) { continue; }
+
+        bool is_ready;
+        const GRT::VectorDouble output = getFrontEndOutput(pipeline, input, &is_ready);
+        if (features->outputs.getNumRows() == 0 && !output.empty()) {
+            features->outputs.resize(n, output.size());
+            features->outputs.setAllValues(0);
+        }
+        if (output.size() != features->outputs.getNumCols()) { continue; }
+        std::copy(output.begin(), output.end(), features->outputs[i]);
+        features->is_valid[i] = true;
+        features->is_ready[i] = is_ready;
+    }
+    return features;
+}
+
+uint32_t FeatureCache::Snapshot::getNumMissing() const {
+    uint32_t n = 0;
+    for (const auto& label_entries : entries) {
+        for (const Entry& entry : label_entries) {
+            if (entry == nullptr) { n++; }
+        }
+    }
+    return n;
+}
+
+// FNV-1a.
+static void hashBytes(uint64_t* hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        *hash ^= bytes[i];
+        *hash *= 1099511628211ull;
+    }
+}
+
+static void hashString(uint64_t* hash, const std::string& s) {
+    hashBytes(hash, s.data(), s.size() + 1);
+}
+
+template <typename T>
+static void hashValue(uint64_t* hash, T value) {
+    hashBytes(hash, &value, sizeof(value));
+}
+
+uint64_t FeatureCache::computeKey(const GRT::GestureRecognitionPipeline& pipeline) {
+    uint64_t hash = 14695981039346656037ull;
+
+    // A pipeline of just the front end: copying the classifier would copy
+    // its model for nothing.
+    GRT::GestureRecognitionPipeline front_end;
+    uint32_t num_dimensions = 0;
+    for (uint32_t i = 0; i < pipeline.getNumPreProcessingModules(); i++) {
+        const GRT::PreProcessing* module = pipeline.getPreProcessingModule(i);
+        if (i == 0) { num_dimensions = module->getNumInputDimensions(); }
+        hashString(&hash, module->getPreProcessingType());
+        hashValue(&hash, module->getNumInputDimensions());
+        hashValue(&hash, module->getNumOutputDimensions());
+        front_end.addPreProcessingModule(*module);
+    }
+    for (uint32_t i = 0; i < pipeline.getNumFeatureExtractionModules(); i++) {
+        const GRT::FeatureExtraction* module = pipeline.getFeatureExtractionModule(i);
+        if (num_dimensions == 0) { num_dimensions = module->getNumInputDimensions(); }
+        hashString(&hash, module->getFeatureExtractionType());
+        hashValue(&hash, module->getNumInputDimensions());
+        hashValue(&hash, module->getNumOutputDimensions());
+        front_end.addFeatureExtractionModule(*module);
+    }
+    if (num_dimensions == 0) { return hash; }  // no modules: rows go straight through
+
+    // Noise, swept from 1e-3 to 1e3 so that thresholds anywhere in between
+    // are crossed. xorshift64* keeps it the same from run to run.
+    uint64_t noise = 88172645463325252ull;
+    GRT::VectorDouble input(num_dimensions);
+    front_end.reset();
+    for (uint32_t i = 0; i < kProbeLength; i++) {
+        const double amplitude = pow(10, -3 + 6.0 * i / kProbeLength);
+        for (double& value : input) {
+            noise ^= noise >> 12;
+            noise ^= noise << 25;
+            noise ^= noise >> 27;
+            const uint64_t r = noise * 2685821657736338717ull;
+            value = amplitude * ((r >> 11) * (2.0 / 9007199254740992.0) - 1.0);
+        }
+
+        const bool is_valid = front_end.preProcessData(input);
+        hashValue(&hash, is_valid);
+        if (!is_valid) { continue; }
+        bool is_ready;
+        for (double value : getFrontEndOutput(front_end, input, &is_ready)) {
+            hashValue(&hash, value);
+        }
+        hashValue(&hash, is_ready);
+    }
+    return hash;
+}
+
+bool FeatureCache::applyChanges(const std::vector<TrainingDataManager::Change>& changes) {
+    typedef TrainingDataManager::Change Change;
+    for (const Change& change : changes) {
+        if (change.type == Change::RESET || change.label >= entries_.size()) {
+            return false;
+        }
+        std::vector<Entry>& entries = entries_[change.label];
+
+        switch (change.type) {
+            case Change::ADD:
+                if (change.index != entries.size()) { return false; }
+                entries.push_back(nullptr);
+                break;
+            case Change::REMOVE:
+                if (change.index >= entries.size()) { return false; }
+                entries.erase(entries.begin() + change.index);
+                break;
+            case Change::RELABEL: {
+                // The front end doesn't see labels: the entry moves as it is.
+                if (change.index >= entries.size() ||
+                    change.new_label >= entries_.size()) {
+                    return false;
+                }
+                Entry entry = entries[change.index];
+                entries.erase(entries.begin() + change.index);
+                entries_[change.new_label].push_back(entry);
+                break;
+            }
+            case Change::MODIFY:
+                if (change.index >= entries.size()) { return false; }
+                entries[change.index] = nullptr;
+                break;
+            case Change::RESET:
+                return false;
+        }
+    }
+    return true;
+}
+
+void FeatureCache::update(TrainingDataManager& data, uint64_t key) {
+    std::vector<TrainingDataManager::Change> changes;
+    const uint32_t num_labels = data.getNumLabels();
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    bool is_current = is_valid_ && key == key_ && entries_.size() == num_labels + 1 &&
+        data.getChangesSince(data_version_, &changes) && applyChanges(changes);
+    for (uint32_t label = 1; label <= num_labels && is_current; label++) {
+        is_current = entries_[label].size() == data.getNumSampleForLabel(label);
+    }
+    if (!is_current) {
+        entries_.assign(num_labels + 1, std::vector<Entry>());
+        for (uint32_t label = 1; label <= num_labels; label++) {
+            entries_[label].resize(data.getNumSampleForLabel(label));
+        }
+    }
+    is_valid_ = true;
+    key_ = key;
+    data_version_ = data.getVersion();
+}
+
+FeatureCache::Snapshot FeatureCache::getSnapshot() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    Snapshot snapshot;
+    snapshot.key = key_;
+    snapshot.data_version = data_version_;
+    snapshot.entries = entries_;
+    return snapshot;
+}
+
+FeatureCache::Entry FeatureCache::get(uint32_t label, uint32_t index) const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (label >= entries_.size() || index >= entries_[label].size()) { return nullptr; }
+    return entries_[label][index];
+}
+
+void FeatureCache::put(uint64_t key, uint64_t data_version, uint32_t label,
+                       uint32_t index, Entry entry) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (!is_valid_ || key != key_ || data_version != data_version_) { return; }
+    if (label >= entries_.size() || index >= entries_[label].size()) { return; }
+    entries_[label][index] = entry;
+}
+
+void FeatureCache::fill(Snapshot* snapshot, GRT::GestureRecognitionPipeline& pipeline,
+                        const std::vector<GRT::TimeSeriesClassificationData>& class_data,
+                        const std::function<bool(uint32_t num_done)>& should_stop) {
+    uint32_t num_done = 0;
+    for (uint32_t label = 0; label < snapshot->entries.size(); label++) {
+        std::vector<Entry>& entries = snapshot->entries[label];
+        for (uint32_t i = 0; i < entries.size(); i++) {
+            if (entries[i] != nullptr) { continue; }
+            if (should_stop && should_stop(num_done)) { return; }
+            entries[i] = SampleFeatures::compute(pipeline, class_data[label][i].getData());
+            put(snapshot->key, snapshot->data_version, label, i, entries[i]);
+            num_done++;
+        }
+    }
+    pipeline.reset();
+}
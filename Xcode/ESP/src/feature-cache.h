@@ -0,0 +1,112 @@
+/** @file feature-cache.h
+ *  @brief FeatureCache, which keeps each training sample's output from the
+ *  pipeline's pre-processing and feature extraction modules (its "front
+ *  end"), so that training, scoring and the feature view don't run every
+ *  sample through them again each time.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <GRT/GRT.h>
+
+#include "training-data-manager.h"
+
+/**
+ @brief What one training sample comes out of the front end as.
+ */
+struct SampleFeatures {
+    /// @brief The last module's output for each row of the sample (the row
+    /// itself if there are no modules). Rows that didn't make it through are
+    /// all 0.
+    GRT::MatrixDouble outputs;
+
+    /// @brief Whether each row made it through the modules.
+    std::vector<bool> is_valid;
+
+    /// @brief Whether the classifier gets each row: it made it through and
+    /// the features were ready (e.g. not while a window fills up).
+    std::vector<bool> is_ready;
+
+    /// @brief The rows the pipeline would pass to its classifier.
+    GRT::MatrixDouble getClassifierInput() const;
+
+    /// @brief Runs sample through pipeline's front end, from a reset.
+    static std::shared_ptr<const SampleFeatures> compute(
+        GRT::GestureRecognitionPipeline& pipeline, const GRT::MatrixDouble& sample);
+};
+
+/**
+ @brief Holds a SampleFeatures for each training sample, by label and index,
+ for one front end (see computeKey()). The entries of samples that are edited
+ are dropped (see update()) and computed again by whoever next needs them.
+
+ Entries are immutable once computed, so a Snapshot can be handed to other
+ threads while the cache moves on.
+ */
+class FeatureCache {
+  public:
+    typedef std::shared_ptr<const SampleFeatures> Entry;
+
+    /// @brief The entries at one version of the training data, by
+    /// [label][index]; nullptr where they haven't been computed.
+    struct Snapshot {
+        uint64_t key = 0;
+        uint64_t data_version = 0;
+        std::vector<std::vector<Entry>> entries;
+
+        uint32_t getNumMissing() const;
+    };
+
+    /**
+     @brief Identifies what pipeline's front end does: the modules' types
+     and sizes, and what they make of a fixed probe signal. Neither GRT's
+     modules nor ESP's save all of their settings, so those can't be compared
+     directly; a setting that changes nothing the probe shows is missed.
+     */
+    static uint64_t computeKey(const GRT::GestureRecognitionPipeline& pipeline);
+
+    /**
+     @brief Brings the cache up to date with data: drops the entries of
+     samples added or changed since the last call (all of them if those
+     changes are no longer known), and all of them if key has changed.
+     */
+    void update(TrainingDataManager& data, uint64_t key);
+
+    Snapshot getSnapshot() const;
+
+    /// @brief The entry for (label, index), which may be nullptr.
+    Entry get(uint32_t label, uint32_t index) const;
+
+    /**
+     @brief Stores the entry for (label, index), computed for the given key
+     and version of the data. Ignored if the cache has moved on since.
+     */
+    void put(uint64_t key, uint64_t data_version, uint32_t label, uint32_t index,
+             Entry entry);
+
+    /**
+     @brief Computes snapshot's missing entries with pipeline from their
+     samples in class_data (by label, as of the snapshot's version), stores
+     them in the snapshot and puts them in the cache. Stops early if
+     should_stop returns true.
+     */
+    void fill(Snapshot* snapshot, GRT::GestureRecognitionPipeline& pipeline,
+              const std::vector<GRT::TimeSeriesClassificationData>& class_data,
+              const std::function<bool(uint32_t num_done)>& should_stop = nullptr);
+
+  private:
+    // Applies changes to entries_; returns false if they don't fit.
+    bool applyChanges(const std::vector<TrainingDataManager::Change>& changes);
+
+    mutable std::mutex mutex_;
+    bool is_valid_ = false;
+    uint64_t key_ = 0;
+    uint64_t data_version_ = 0;
+    std::vector<std::vector<Entry>> entries_;
+};
@@ -0,0 +1,168 @@
+#include "fusion-stream.h"
+
+#include <chrono>
+
+FusionStream::FusionStream(double output_rate, Interpolation interpolation,
+                           uint32_t latency_budget_ms)
+        : output_rate_(output_rate), interpolation_(interpolation),
+          latency_budget_us_(latency_budget_ms * 1000ull),
+          is_running_(false), num_late_outputs_(0) {
+}
+
+FusionStream::~FusionStream() {
+    stop();
+}
+
+void FusionStream::addStream(IStream& stream) {
+    if (has_started_) {
+        ofLog(OF_LOG_ERROR) << "FusionStream: can't add a stream after starting";
+        return;
+    }
+
+    unique_ptr<Input> input(new Input());
+    input->stream = &stream;
+    input->num_dimensions = stream.getNumOutputDimensions();
+
+    Input* raw = input.get();
+    stream.onDataReadyEvent([this, raw](const GRT::MatrixDouble& data,
+                                        const SampleStamp& stamp) {
+        onInputData(raw, data, stamp);
+    });
+
+    // Label the fused dimensions after the inputs' labels, where they have
+    // them.
+    vector<string> labels = stream.getLabels();
+    labels.resize(input->num_dimensions);
+    istream_labels_.resize(getNumInputDimensions());
+    istream_labels_.insert(istream_labels_.end(), labels.begin(), labels.end());
+
+    inputs_.push_back(std::move(input));
+}
+
+int FusionStream::getNumInputDimensions() {
+    int n = 0;
+    for (const auto& input : inputs_) { n += input->num_dimensions; }
+    return n;
+}
+
+bool FusionStream::start() {
+    if (has_started_) { return true; }
+    if (inputs_.empty() || output_rate_ <= 0) {
+        ofLog(OF_LOG_ERROR) << "FusionStream: no input streams or no output rate";
+        return false;
+    }
+
+    for (auto& input : inputs_) {
+        std::lock_guard<std::mutex> guard(input->mutex);
+        input->times.clear();
+        input->values.clear();
+        input->last_delivery_us = 0;
+    }
+    for (size_t i = 0; i < inputs_.size(); i++) {
+        if (!inputs_[i]->stream->start()) {
+            ofLog(OF_LOG_ERROR) << "FusionStream: input stream " << i << " failed to start";
+            for (size_t j = 0; j < i; j++) { inputs_[j]->stream->stop(); }
+            return false;
+        }
+    }
+
+    has_started_ = true;
+    is_running_ = true;
+    thread_.reset(new std::thread(&FusionStream::run, this));
+    return true;
+}
+
+void FusionStream::stop() {
+    if (!has_started_) { return; }
+    for (auto& input : inputs_) { input->stream->stop(); }
+    is_running_ = false;
+    if (thread_ != nullptr && thread_->joinable()) { thread_->join(); }
+    has_started_ = false;
+}
+
+void FusionStream::onInputData(Input* input, const GRT::MatrixDouble& data,
+                               const SampleStamp& stamp) {
+    const uint32_t n = data.getNumRows();
+    if (n == 0 || data.getNumCols() != input->num_dimensions) { return; }
+
+    std::lock_guard<std::mutex> guard(input->mutex);
+
+    // Spread the rows over the time since the previous delivery, so that a
+    // block of audio doesn't collapse onto one instant.
+    const uint64_t end = stamp.host_time_us;
+    const uint64_t begin = (input->last_delivery_us != 0 && input->last_delivery_us < end) ?
+        input->last_delivery_us : end;
+    input->last_delivery_us = end;
+
+    for (uint32_t i = 0; i < n; i++) {
+        input->times.push_back(begin + (end - begin) * (i + 1) / n);
+        input->values.insert(input->values.end(), data[i], data[i] + input->num_dimensions);
+    }
+}
+
+bool FusionStream::interpolate(Input* input, uint64_t t, double* out, bool* late) {
+    std::lock_guard<std::mutex> guard(input->mutex);
+    std::deque<uint64_t>& times = input->times;
+    std::deque<double>& values = input->values;
+    const uint32_t dims = input->num_dimensions;
+    if (times.empty()) { return false; }
+
+    // Drop samples that later (larger) t can no longer need: keep the last
+    // one at or before t.
+    while (times.size() > 1 && times[1] <= t) {
+        times.pop_front();
+        values.erase(values.begin(), values.begin() + dims);
+    }
+
+    if (times[0] >= t || times.size() == 1 || interpolation_ == HOLD) {
+        // t is before the first sample, after the last one (the input is
+        // late) or we're holding: the first sample is the one to use.
+        if (times[0] < t && times.size() == 1) { *late = true; }
+        std::copy(values.begin(), values.begin() + dims, out);
+        return true;
+    }
+
+    // times[0] <= t < times[1]
+    const uint64_t t0 = times[0], t1 = times[1];
+    if (interpolation_ == NEAREST) {
+        size_t i = (t - t0 <= t1 - t) ? 0 : 1;
+        std::copy(values.begin() + i * dims, values.begin() + (i + 1) * dims, out);
+    } else {
+        const double w = (double) (t - t0) / (t1 - t0);
+        for (uint32_t d = 0; d < dims; d++) {
+            out[d] = (1 - w) * values[d] + w * values[dims + d];
+        }
+    }
+    return true;
+}
+
+void FusionStream::run() {
+    typedef std::chrono::steady_clock Clock;
+    const std::chrono::duration<double> period(1.0 / output_rate_);
+    const auto start_time = Clock::now();
+    const uint64_t start_us = getMonotonicMicros();
+
+    GRT::MatrixDouble sample(1, getNumInputDimensions());
+    for (uint64_t k = 1; is_running_; k++) {
+        std::this_thread::sleep_until(
+            start_time + std::chrono::duration_cast<Clock::duration>(k * period));
+
+        const uint64_t now_us = start_us + (uint64_t) (k * period.count() * 1e6);
+        if (now_us < latency_budget_us_) { continue; }
+        const uint64_t t = now_us - latency_budget_us_;
+
+        bool ready = true, late = false;
+        double* out = sample[0];
+        for (auto& input : inputs_) {
+            if (!interpolate(input.get(), t, out, &late)) {
+                ready = false;  // wait until every input has produced something
+                break;
+            }
+            out += input->num_dimensions;
+        }
+        if (!ready) { continue; }
+        if (late) { num_late_outputs_++; }
+
+        normalizeAndEmit(sample, t, SampleStamp::kNoDeviceTime);
+    }
+}
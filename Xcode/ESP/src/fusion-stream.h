@@ -0,0 +1,111 @@
+/** @file fusion-stream.h
+ *  @brief FusionStream, an input stream that merges several input streams
+ *  into one, aligning their samples in time.
+ *
+ *  @verbatim
+ *  ASCIISerialStream imu(0, 115200, 6);
+ *  AudioStream mic(100);
+ *  FusionStream fusion(100);  // 100 Hz output
+ *
+ *  void setup() {
+ *      fusion.addStream(imu);
+ *      fusion.addStream(mic);
+ *      useInputStream(fusion);
+ *  }
+ *  @endverbatim
+ */
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "istream.h"
+
+/**
+ @brief Input stream that joins the samples of several input streams, which
+ may run at different rates, into one sample per output period.
+
+ Each output sample is the concatenation of every input's value at the same
+ point in time, interpolated from the samples around that point. Because an
+ input's samples arrive some time after they were captured, outputs are
+ computed for a point `latency budget` in the past; inputs that still have no
+ sample past that point (because they are slower or more delayed than the
+ budget allows) contribute their latest value instead, and the output is
+ counted as late.
+
+ Times are the inputs' host capture times (see SampleStamp). Rows that an
+ input delivers together are spread evenly over the time since its previous
+ delivery.
+ */
+class FusionStream : public IStream {
+  public:
+    enum Interpolation {
+        HOLD,     // the latest value at or before the output time
+        NEAREST,  // the value closest in time to the output time
+        LINEAR,   // linear interpolation between the two values around it
+    };
+
+    /**
+     Create a FusionStream instance.
+
+     @param output_rate: output samples per second.
+     @param interpolation: how to compute inputs' values between samples.
+     @param latency_budget_ms: how long to wait for late input samples before
+     computing an output sample.
+     */
+    FusionStream(double output_rate, Interpolation interpolation = LINEAR,
+                 uint32_t latency_budget_ms = 50);
+    ~FusionStream();
+
+    /// @brief Add an input stream. Call before the stream starts (e.g. in
+    /// setup()); FusionStream starts and stops its inputs itself.
+    void addStream(IStream& stream);
+
+    virtual bool start() final;
+    virtual void stop() final;
+    virtual int getNumInputDimensions() final;
+
+    /// @brief Number of output samples for which some input had to use its
+    /// latest value because nothing newer had arrived in time.
+    uint64_t getNumLateOutputs() const { return num_late_outputs_.load(); }
+
+  private:
+    struct Input {
+        IStream* stream;
+        uint32_t num_dimensions;
+
+        // Samples not yet needed for interpolation are trimmed. values holds
+        // num_dimensions values per entry in times.
+        std::mutex mutex;
+        std::deque<uint64_t> times;
+        std::deque<double> values;
+        uint64_t last_delivery_us = 0;
+    };
+
+    void onInputData(Input* input, const GRT::MatrixDouble& data,
+                     const SampleStamp& stamp);
+
+    // Write `input`'s value at time t to `out`. Returns false if the input
+    // has no samples yet; sets *late if none is at or after t.
+    bool interpolate(Input* input, uint64_t t, double* out, bool* late);
+
+    void run();
+
+    const double output_rate_;
+    const Interpolation interpolation_;
+    const uint64_t latency_budget_us_;
+
+    vector<unique_ptr<Input>> inputs_;
+    std::atomic<bool> is_running_;
+    unique_ptr<std::thread> thread_;
+    std::atomic<uint64_t> num_late_outputs_;
+
+    // Disallow copy and assign
+    FusionStream(FusionStream&) = delete;
+    void operator=(FusionStream) = delete;
+};
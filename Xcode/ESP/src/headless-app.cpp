@@ -0,0 +1,223 @@
+#include "headless-app.h"
+
+#include <csignal>
+
+#include "user.h"
+
+// The names the GUI saves a session under (see ofApp::saveAll()).
+static const char* const kPipelineFilename = "Pipeline.grt";
+static const char* const kCalibrationDataFilename = "CalibrationData.grt";
+
+// Nothing waits on the processing thread but the input stream, so the queue
+// only needs to absorb scheduling hiccups.
+static const uint32_t kInputQueueSamples = 1 << 12;
+
+// How long the processing thread waits for input before checking whether it
+// should stop.
+static const uint32_t kProcessingIdleTimeoutMicros = 10 * 1000;
+
+// update() only checks for signals and reports status, so it needn't run
+// often.
+static const int kUpdateRate = 4;  // Hz
+static const uint64_t kStatusIntervalMillis = 60 * 1000;
+
+static std::atomic<bool> should_stop(false);
+
+static void onStopSignal(int) {
+    should_stop = true;
+}
+
+HeadlessApp::HeadlessApp(const string& session_directory)
+        : session_directory_(session_directory.empty() ? "." : session_directory),
+          is_processing_(false), num_predictions_(0) {
+}
+
+void HeadlessApp::useCalibrator(Calibrator& calibrator) {
+    calibrator_ = &calibrator;
+}
+
+void HeadlessApp::usePipeline(GRT::GestureRecognitionPipeline& pipeline) {
+    pipeline_ = &pipeline;
+}
+
+void HeadlessApp::useIStream(IStream& stream) {
+    if (!setup_finished_) istream_ = &stream;
+}
+
+void HeadlessApp::useOStream(OStream& stream) {
+    if (!setup_finished_) ostreams_.push_back(&stream);
+}
+
+void HeadlessApp::useOStream(OStreamVector& stream) {
+    if (!setup_finished_) ostreamvectors_.push_back(&stream);
+}
+
+void HeadlessApp::useCaptureLog(const string& directory, uint64_t max_bytes,
+                                uint64_t max_age_seconds) {
+    if (!setup_finished_) {
+        capture_log_.reset(new CaptureLog(directory, max_bytes, max_age_seconds));
+    }
+}
+
+bool HeadlessApp::loadSession() {
+    const string dir = session_directory_ + "/";
+
+    if (calibrator_ != nullptr && !calibrator_->getCalibrateProcesses().empty()) {
+        CalibrateResult result = calibrator_->load(
+            dir + kCalibrationDataFilename, istream_->getNumOutputDimensions());
+        if (result.getResult() == CalibrateResult::FAILURE) {
+            ofLog(OF_LOG_ERROR) << result.getMessage();
+            return false;
+        }
+        if (!calibrator_->isCalibrated()) {
+            ofLog(OF_LOG_ERROR) << "Calibration data from " << dir
+                                << " doesn't calibrate every calibration sample";
+            return false;
+        }
+    }
+
+    if (!pipeline_->load(dir + kPipelineFilename)) {
+        ofLog(OF_LOG_ERROR) << "Failed to load pipeline from " << dir + kPipelineFilename;
+        return false;
+    }
+    if (pipeline_->getIsClassifierSet() && !pipeline_->getTrained()) {
+        ofLog(OF_LOG_ERROR) << "The pipeline in " << dir << " isn't trained";
+        return false;
+    }
+    ofLog() << "ESP session is loaded from " << dir;
+    return true;
+}
+
+void HeadlessApp::setup() {
+    ::setup(); setup_finished_ = true;
+
+    if (istream_ == nullptr || pipeline_ == nullptr) {
+        ofLog(OF_LOG_FATAL_ERROR) << "setup() must call useInputStream() and usePipeline()";
+        ofExit(1);
+        return;
+    }
+    if (!loadSession()) {
+        ofExit(1);
+        return;
+    }
+
+    for (OStream *ostream : ostreams_) {
+        if (!(ostream->start())) {
+            ofLog(OF_LOG_ERROR) << "failed to connect to ostream";
+        }
+    }
+    for (OStreamVector *ostream : ostreamvectors_) {
+        if (!(ostream->start())) {
+            ofLog(OF_LOG_ERROR) << "failed to connect to ostream";
+        }
+    }
+
+    uint32_t num_input_dimensions = istream_->getNumOutputDimensions();
+    input_queue_.setup(num_input_dimensions, kInputQueueSamples);
+    input_queue_.setOverflowPolicy(istream_->getOverloadPolicy(),
+                                   istream_->getOverloadFactor());
+    if (capture_log_ != nullptr && !capture_log_->open(num_input_dimensions)) {
+        capture_log_.reset();
+    }
+    istream_->onDataReadyEvent(this, &HeadlessApp::onDataIn);
+
+    is_processing_ = true;
+    processing_thread_ = std::thread(&HeadlessApp::processInput, this);
+
+    if (!istream_->start()) {
+        ofLog(OF_LOG_FATAL_ERROR) << "Failed to start the input stream";
+        ofExit(1);
+        return;
+    }
+
+    signal(SIGINT, onStopSignal);
+    signal(SIGTERM, onStopSignal);
+    ofSetFrameRate(kUpdateRate);
+}
+
+void HeadlessApp::update() {
+    if (should_stop) {
+        should_stop = false;
+        ofExit(0);
+        return;
+    }
+
+    if (input_queue_.getNumOverflows() != last_reported_overflows_) {
+        last_reported_overflows_ = input_queue_.getNumOverflows();
+        ofLog(OF_LOG_WARNING) << "Input queue full " << last_reported_overflows_
+                              << " times (" << input_queue_.getNumDropped()
+                              << " samples dropped)";
+    }
+
+    static uint64_t last_status_time = 0;
+    if (ofGetElapsedTimeMillis() - last_status_time >= kStatusIntervalMillis) {
+        last_status_time = ofGetElapsedTimeMillis();
+        ofLog() << num_predictions_ << " predictions so far";
+    }
+}
+
+void HeadlessApp::exit() {
+    // A producer blocked on a full queue would otherwise never return.
+    input_queue_.close();
+    is_processing_ = false;
+    if (processing_thread_.joinable()) {
+        processing_thread_.join();
+    }
+    if (istream_ != nullptr) { istream_->stop(); }
+    if (capture_log_ != nullptr) { capture_log_->close(); }
+}
+
+void HeadlessApp::onDataIn(const GRT::MatrixDouble& input, const SampleStamp& stamp) {
+    input_queue_.push(input, stamp);
+}
+
+void HeadlessApp::processInput() {
+    while (is_processing_) {
+        if (!input_queue_.waitForData(kProcessingIdleTimeoutMicros)) { continue; }
+
+        input_queue_.drain(input_data_, input_stamps_);
+        if (capture_log_ != nullptr) {
+            capture_log_->append(input_data_, input_stamps_);
+        }
+
+        const GRT::MatrixDouble* inputs = &input_data_;
+        if (calibrator_ != nullptr) {
+            calibrated_data_ = input_data_;
+            calibrator_->calibrate(calibrated_data_);
+            inputs = &calibrated_data_;
+        }
+
+        // Only a signal processing pipeline needs its stages' outputs.
+        const bool is_signal_pipeline = !pipeline_->getIsClassifierSet();
+        predictBlock(*pipeline_, *inputs, &prediction_,
+                     is_signal_pipeline ? kKeepStageOutputs : 0);
+
+        for (uint32_t i = 0; i < inputs->getNumRows(); i++) {
+            if (!prediction_.is_valid[i]) { continue; }
+            const SampleStamp& stamp = input_stamps_[i];
+
+            if (pipeline_->getTrained()) {
+                num_predictions_++;
+                int label = prediction_.labels[i];
+                if (label != 0) {
+                    for (OStream *ostream : ostreams_)
+                        ostream->onReceiveStamped(label, stamp);
+                    for (OStream *ostream : ostreamvectors_)
+                        ostream->onReceiveStamped(label, stamp);
+                }
+            } else if (is_signal_pipeline && !ostreamvectors_.empty()) {
+                // Send the output of the last stage to the OStreamVector
+                // instances.
+                vector<double> data = inputs->getRowVector(i);
+                if (!prediction_.features.empty()) {
+                    data = prediction_.features.back().getRowVector(i);
+                } else if (!prediction_.pre_processed.empty()) {
+                    data = prediction_.pre_processed.back().getRowVector(i);
+                }
+                for (OStreamVector *stream : ostreamvectors_) {
+                    stream->onReceiveStamped(data, stamp);
+                }
+            }
+        }
+    }
+}
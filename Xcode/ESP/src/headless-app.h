@@ -0,0 +1,87 @@
+/** @file headless-app.h
+ *  @brief HeadlessApp, which runs a saved ESP session without a window.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ofMain.h"
+
+#include "block-prediction.h"
+#include "calibrator.h"
+#include "capture-log.h"
+#include "istream.h"
+#include "ostream.h"
+#include "runtime.h"
+#include "sample-queue.h"
+
+/**
+ @brief Runs the same user code as the GUI (the `setup()` in a user_*.cpp),
+ but without a window, GUI or plots.
+
+ On startup, it loads the pipeline (Pipeline.grt) and, if a calibrator is in
+ use, the calibration data (CalibrationData.grt) from a directory saved by
+ the GUI. It then runs live input through them and sends predictions to the
+ output streams. Training data and tuneable parameters aren't used. It's
+ started with `ESP --headless <directory>` (see main.cpp) and stops on
+ SIGINT or SIGTERM.
+ */
+class HeadlessApp : public ofBaseApp, public Runtime {
+  public:
+    explicit HeadlessApp(const string& session_directory);
+
+    void setup() final;
+    void update() final;
+    void exit() final;
+
+    // Runtime
+    void useCalibrator(Calibrator& calibrator) final;
+    void usePipeline(GRT::GestureRecognitionPipeline& pipeline) final;
+    void useIStream(IStream& stream) final;
+    void useOStream(OStream& stream) final;
+    void useOStream(OStreamVector& stream) final;
+    void useTrainingSampleChecker(TrainingSampleChecker checker) final {}
+    void useTrainingDataAdvice(string advice) final {}
+    void useCaptureLog(const string& directory, uint64_t max_bytes,
+                       uint64_t max_age_seconds) final;
+
+    void registerTuneable(Tuneable* t) final {}
+    void reloadPipelineModules() final {}
+
+  private:
+    bool loadSession();
+    void onDataIn(const GRT::MatrixDouble& in, const SampleStamp& stamp);
+    void processInput();
+
+    const string session_directory_;
+    bool setup_finished_ = false;
+
+    Calibrator* calibrator_ = nullptr;
+    IStream* istream_ = nullptr;
+    GRT::GestureRecognitionPipeline* pipeline_ = nullptr;
+    vector<OStream*> ostreams_;
+    vector<OStreamVector*> ostreamvectors_;
+    unique_ptr<CaptureLog> capture_log_;
+
+    // Samples are pushed by the istream_ thread and run through the pipeline
+    // by processing_thread_, which is the only user of everything below.
+    SampleQueue input_queue_;
+    std::thread processing_thread_;
+    std::atomic<bool> is_processing_;
+    GRT::MatrixDouble input_data_;
+    vector<SampleStamp> input_stamps_;
+    GRT::MatrixDouble calibrated_data_;
+    BlockPrediction prediction_;
+
+    std::atomic<uint64_t> num_predictions_;
+    uint64_t last_reported_overflows_ = 0;
+
+    // Disallow copy and assign
+    HeadlessApp(HeadlessApp&) = delete;
+    void operator=(HeadlessApp) = delete;
+};
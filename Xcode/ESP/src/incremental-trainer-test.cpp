@@ -0,0 +1,134 @@
+#include "incremental-trainer.h"
+#include "gtest/gtest.h"
+
+// An entry whose only row is value.
+static FeatureCache::Entry makeEntry(double value) {
+    std::shared_ptr<SampleFeatures> entry(new SampleFeatures());
+    entry->outputs.resize(1, 1);
+    entry->outputs[0][0] = value;
+    entry->is_valid.assign(1, true);
+    entry->is_ready.assign(1, true);
+    return entry;
+}
+
+class IncrementalTrainerTest : public ::testing::Test {
+  protected:
+    virtual void SetUp() {
+        features.key = 42;
+        features.entries.resize(3);
+        for (double value : { 0.0, 0.1, 0.2, 0.3 }) {
+            features.entries[1].push_back(makeEntry(value));
+        }
+        for (double value : { 1.0, 1.1, 1.2, 1.3 }) {
+            features.entries[2].push_back(makeEntry(value));
+        }
+    }
+
+    static uint32_t predict(GRT::Classifier& classifier, double value) {
+        classifier.predict(GRT::VectorDouble(1, value));
+        return classifier.getPredictedClassLabel();
+    }
+
+    FeatureCache::Snapshot features;
+    IncrementalTrainer trainer;
+};
+
+TEST_F(IncrementalTrainerTest, TrainsFromScratchFirst) {
+    GRT::KNN knn(1);
+    bool is_updated = true;
+    EXPECT_TRUE(trainer.train(knn, features, &is_updated));
+    EXPECT_FALSE(is_updated);
+    EXPECT_EQ(1, predict(knn, 0.6));
+}
+
+TEST_F(IncrementalTrainerTest, AddsSamplesToKNN) {
+    GRT::KNN knn(1);
+    bool is_updated;
+    ASSERT_TRUE(trainer.train(knn, features, &is_updated));
+
+    features.entries[2].push_back(makeEntry(0.6));
+    EXPECT_TRUE(trainer.train(knn, features, &is_updated));
+    EXPECT_TRUE(is_updated);
+    EXPECT_EQ(2, predict(knn, 0.6));
+}
+
+TEST_F(IncrementalTrainerTest, RemovesSamplesFromKNN) {
+    GRT::KNN knn(1);
+    bool is_updated;
+    ASSERT_TRUE(trainer.train(knn, features, &is_updated));
+
+    features.entries[1].resize(2);  // leaves 0.0 and 0.1
+    EXPECT_TRUE(trainer.train(knn, features, &is_updated));
+    EXPECT_TRUE(is_updated);
+    EXPECT_EQ(2, predict(knn, 0.6));
+}
+
+TEST_F(IncrementalTrainerTest, RelabelsSamplesInKNN) {
+    GRT::KNN knn(1);
+    bool is_updated;
+    ASSERT_TRUE(trainer.train(knn, features, &is_updated));
+
+    FeatureCache::Entry entry = features.entries[1].back();
+    features.entries[1].pop_back();
+    features.entries[2].push_back(entry);
+    EXPECT_TRUE(trainer.train(knn, features, &is_updated));
+    EXPECT_TRUE(is_updated);
+    EXPECT_EQ(2, predict(knn, 0.3));
+}
+
+TEST_F(IncrementalTrainerTest, UpdatedANBCMatchesOneTrainedFromScratch) {
+    GRT::ANBC anbc;
+    bool is_updated;
+    ASSERT_TRUE(trainer.train(anbc, features, &is_updated));
+
+    features.entries[1].push_back(makeEntry(0.5));
+    EXPECT_TRUE(trainer.train(anbc, features, &is_updated));
+    EXPECT_TRUE(is_updated);
+
+    GRT::ANBC expected;
+    ASSERT_TRUE(trainClassifier(expected, features));
+    for (double value : { 0.2, 0.5, 0.7, 1.1 }) {
+        anbc.predict(GRT::VectorDouble(1, value));
+        expected.predict(GRT::VectorDouble(1, value));
+        const GRT::VectorDouble likelihoods = anbc.getClassLikelihoods();
+        const GRT::VectorDouble expected_likelihoods = expected.getClassLikelihoods();
+        ASSERT_EQ(expected_likelihoods.size(), likelihoods.size());
+        for (size_t k = 0; k < likelihoods.size(); k++) {
+            EXPECT_NEAR(expected_likelihoods[k], likelihoods[k], 1e-9);
+        }
+    }
+}
+
+TEST_F(IncrementalTrainerTest, NewClassTrainsFromScratch) {
+    GRT::KNN knn(1);
+    bool is_updated;
+    ASSERT_TRUE(trainer.train(knn, features, &is_updated));
+
+    features.entries.resize(4);
+    features.entries[3].push_back(makeEntry(2.0));
+    EXPECT_TRUE(trainer.train(knn, features, &is_updated));
+    EXPECT_FALSE(is_updated);
+    EXPECT_EQ(3, predict(knn, 1.9));
+}
+
+TEST_F(IncrementalTrainerTest, LargeEditsTrainFromScratch) {
+    GRT::KNN knn(1);
+    bool is_updated;
+    ASSERT_TRUE(trainer.train(knn, features, &is_updated));
+
+    for (uint32_t i = 0; i < 3; i++) { features.entries[1][i] = makeEntry(0.4 + i); }
+    EXPECT_TRUE(trainer.train(knn, features, &is_updated));
+    EXPECT_FALSE(is_updated);
+}
+
+TEST_F(IncrementalTrainerTest, InvalidateTrainsFromScratch) {
+    GRT::KNN knn(1);
+    bool is_updated;
+    ASSERT_TRUE(trainer.train(knn, features, &is_updated));
+
+    trainer.invalidate();
+    features.entries[2].push_back(makeEntry(0.6));
+    EXPECT_TRUE(trainer.train(knn, features, &is_updated));
+    EXPECT_FALSE(is_updated);
+    EXPECT_EQ(2, predict(knn, 0.6));
+}
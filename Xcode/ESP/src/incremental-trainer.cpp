@@ -0,0 +1,218 @@
+#include "incremental-trainer.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+bool canTrainClassifierAlone(const GRT::GestureRecognitionPipeline& pipeline) {
+    const GRT::Classifier* classifier = pipeline.getClassifier();
+    return dynamic_cast<const GRT::KNN*>(classifier) != nullptr ||
+        dynamic_cast<const GRT::ANBC*>(classifier) != nullptr;
+}
+
+bool trainClassifier(GRT::Classifier& classifier, const FeatureCache::Snapshot& features,
+                     const std::function<bool(uint32_t label, uint32_t index)>& include) {
+    const auto& entries = features.entries;
+
+    uint32_t num_dimensions = 0;
+    for (uint32_t label = 0; label < entries.size(); label++) {
+        for (const FeatureCache::Entry& entry : entries[label]) {
+            if (entry == nullptr) { return false; }
+            num_dimensions = std::max(num_dimensions, entry->outputs.getNumCols());
+        }
+    }
+
+    GRT::ClassificationData data;
+    data.setNumDimensions(num_dimensions);
+    for (uint32_t label = 0; label < entries.size(); label++) {
+        for (uint32_t i = 0; i < entries[label].size(); i++) {
+            if (include && !include(label, i)) { continue; }
+            const SampleFeatures& sample = *entries[label][i];
+            for (uint32_t j = 0; j < sample.is_ready.size(); j++) {
+                if (sample.is_ready[j]) { data.addSample(label, sample.outputs.getRowVector(j)); }
+            }
+        }
+    }
+    return classifier.train(data);
+}
+
+typedef std::vector<std::pair<uint32_t, FeatureCache::Entry>> LabeledEntries;
+
+// GRT keeps the trained state of its classifiers protected. A pointer to
+// member formed through a class derived from the classifier reaches it on
+// any instance; these are never instantiated.
+struct KNNAccess : public GRT::KNN {
+    // Removes the rows of removed from knn's points and adds those of added.
+    static bool update(GRT::KNN& knn, const LabeledEntries& removed,
+                       const LabeledEntries& added) {
+        // Scaling, null rejection thresholds and the best K all depend on
+        // every point.
+        if (knn.getScalingEnabled() || knn.getNullRejectionEnabled() ||
+            knn.*(&KNNAccess::searchForBestKValue)) {
+            return false;
+        }
+        auto& points = knn.*(&KNNAccess::trainingData);
+
+        for (const auto& sample : removed) {
+            const SampleFeatures& features = *sample.second;
+            for (uint32_t j = 0; j < features.is_ready.size(); j++) {
+                if (!features.is_ready[j]) { continue; }
+                const GRT::VectorDouble row = features.outputs.getRowVector(j);
+                bool is_found = false;
+                uint32_t i = points.getNumSamples();
+                while (i-- > 0) {
+                    if (points[i].getClassLabel() == sample.first &&
+                        points[i].getSample() == row) {
+                        is_found = true;
+                        break;
+                    }
+                }
+                if (!is_found || !points.removeSample(i)) { return false; }
+            }
+        }
+
+        for (const auto& sample : added) {
+            const SampleFeatures& features = *sample.second;
+            for (uint32_t j = 0; j < features.is_ready.size(); j++) {
+                if (!features.is_ready[j]) { continue; }
+                if (!points.addSample(sample.first, features.outputs.getRowVector(j))) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+struct ANBCAccess : public GRT::ANBC {
+    // Fits the models of labels again on their rows in features.
+    static bool update(GRT::ANBC& anbc, const FeatureCache::Snapshot& features,
+                       const std::vector<uint32_t>& labels) {
+        // The scaling ranges span every class.
+        if (anbc.getScalingEnabled()) { return false; }
+        auto& models = anbc.*(&ANBCAccess::models);
+        auto& thresholds = anbc.*(&ANBCAccess::nullRejectionThresholds);
+        const std::vector<GRT::UINT> class_labels = anbc.getClassLabels();
+
+        for (uint32_t label : labels) {
+            const size_t k = std::find(class_labels.begin(), class_labels.end(), label) -
+                class_labels.begin();
+            if (k >= class_labels.size() || k >= models.size() || k >= thresholds.size()) {
+                return false;
+            }
+
+            GRT::MatrixDouble rows;
+            for (const FeatureCache::Entry& entry : features.entries[label]) {
+                for (uint32_t j = 0; j < entry->is_ready.size(); j++) {
+                    if (entry->is_ready[j]) { rows.push_back(entry->outputs.getRowVector(j)); }
+                }
+            }
+            if (rows.getNumRows() < 2) { return false; }  // no variance to fit
+
+            // As ANBC::train() does for each class, with the weights and
+            // null rejection coefficient it was trained with.
+            GRT::VectorDouble weights = models[k].weights;
+            if (!models[k].train(label, rows, weights)) { return false; }
+            thresholds[k] = models[k].threshold;
+        }
+        return true;
+    }
+};
+
+static bool hasReadyRow(const std::vector<FeatureCache::Entry>& entries) {
+    for (const FeatureCache::Entry& entry : entries) {
+        for (bool is_ready : entry->is_ready) {
+            if (is_ready) { return true; }
+        }
+    }
+    return false;
+}
+
+// Brings classifier, trained on the samples of removed and others, up to
+// date with features, which has added instead of removed.
+static bool updateClassifier(GRT::Classifier& classifier,
+                             const FeatureCache::Snapshot& features,
+                             const LabeledEntries& removed, const LabeledEntries& added) {
+    // The classes can't change: a new or emptied class changes the shape of
+    // everything the classifier outputs.
+    const std::vector<GRT::UINT> class_labels = classifier.getClassLabels();
+    std::vector<uint32_t> labels;
+    for (const auto& sample : added) {
+        if (std::find(class_labels.begin(), class_labels.end(), sample.first) ==
+            class_labels.end()) {
+            return false;
+        }
+        labels.push_back(sample.first);
+    }
+    for (const auto& sample : removed) { labels.push_back(sample.first); }
+    std::sort(labels.begin(), labels.end());
+    labels.erase(std::unique(labels.begin(), labels.end()), labels.end());
+    for (uint32_t label : labels) {
+        if (!hasReadyRow(features.entries[label])) { return false; }
+    }
+
+    if (GRT::KNN* knn = dynamic_cast<GRT::KNN*>(&classifier)) {
+        return KNNAccess::update(*knn, removed, added);
+    }
+    if (GRT::ANBC* anbc = dynamic_cast<GRT::ANBC*>(&classifier)) {
+        return ANBCAccess::update(*anbc, features, labels);
+    }
+    return false;
+}
+
+bool IncrementalTrainer::computeDelta(const FeatureCache::Snapshot& features,
+                                      Delta* delta) const {
+    if (!is_valid_ || features.key != trained_.key ||
+        features.entries.size() != trained_.entries.size()) {
+        return false;
+    }
+
+    // Entries are immutable and shared between snapshots: an edited sample
+    // has a new one.
+    std::unordered_map<const SampleFeatures*, std::pair<uint32_t, FeatureCache::Entry>> gone;
+    for (uint32_t label = 0; label < trained_.entries.size(); label++) {
+        for (const FeatureCache::Entry& entry : trained_.entries[label]) {
+            gone[entry.get()] = std::make_pair(label, entry);
+        }
+    }
+    uint32_t num_samples = 0;
+    for (uint32_t label = 0; label < features.entries.size(); label++) {
+        for (const FeatureCache::Entry& entry : features.entries[label]) {
+            num_samples++;
+            auto it = gone.find(entry.get());
+            if (it != gone.end() && it->second.first == label) {
+                gone.erase(it);
+            } else {
+                // New, changed or relabelled (which leaves it in gone, as
+                // removed from its old label).
+                delta->added.emplace_back(label, entry);
+            }
+        }
+    }
+    for (const auto& sample : gone) { delta->removed.push_back(sample.second); }
+
+    // Past this, fitting from scratch is about as quick.
+    return (delta->added.size() + delta->removed.size()) * 2 <= num_samples;
+}
+
+bool IncrementalTrainer::train(GRT::Classifier& classifier,
+                               const FeatureCache::Snapshot& features, bool* is_updated) {
+    *is_updated = false;
+    Delta delta;
+    if (classifier.getTrained() && computeDelta(features, &delta)) {
+        *is_updated = updateClassifier(classifier, features, delta.removed, delta.added);
+    }
+    // A failed update may have left the classifier half changed; training
+    // starts it over.
+    if (!*is_updated && !trainClassifier(classifier, features)) {
+        invalidate();
+        return false;
+    }
+    is_valid_ = true;
+    trained_ = features;
+    return true;
+}
+
+void IncrementalTrainer::invalidate() {
+    is_valid_ = false;
+    trained_ = FeatureCache::Snapshot();
+}
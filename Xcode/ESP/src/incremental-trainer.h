@@ -0,0 +1,79 @@
+/** @file incremental-trainer.h
+ *  @brief Training a pipeline's classifier on its own, from the front-end
+ *  outputs a FeatureCache keeps, so that retraining after an edit to the
+ *  training data only runs the edited samples through the pre-processing
+ *  and feature extraction modules; and IncrementalTrainer, which brings a
+ *  trained KNN or ANBC up to date with such edits without fitting it again.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <GRT/GRT.h>
+
+#include "feature-cache.h"
+
+/**
+ @brief Whether pipeline's classifier can be trained on its own: KNN and
+ ANBC, which are fitted to rows rather than whole time series. Other
+ classifiers (e.g. DTW) are trained through the pipeline.
+ */
+bool canTrainClassifierAlone(const GRT::GestureRecognitionPipeline& pipeline);
+
+/**
+ @brief Trains classifier on the classifier input of features' entries,
+ which must all be there; only those for which include returns true, if
+ it's given.
+ */
+bool trainClassifier(GRT::Classifier& classifier, const FeatureCache::Snapshot& features,
+                     const std::function<bool(uint32_t label, uint32_t index)>& include = nullptr);
+
+/**
+ @brief Trains a classifier on a FeatureCache::Snapshot, and then keeps it
+ up to date with the edits in later snapshots: only the rows of the samples
+ added, removed, relabelled or changed since are touched.
+
+ - KNN (without scaling, null rejection or a search for K): the rows are
+   added to, or removed from, the points it keeps.
+ - ANBC (without scaling): the Gaussian models of the classes that changed
+   are fitted again, with their null rejection thresholds. The other
+   classes' models are kept.
+
+ Anything else, including edits that add or empty a class, or that touch
+ most of the samples, trains the classifier from scratch.
+ */
+class IncrementalTrainer {
+  public:
+    /**
+     @brief Trains classifier on features' entries, which must all be
+     there. The classifier must be the one trained at the last call (or a
+     copy of it), or invalidate() must have been called since.
+
+     @param is_updated set to whether the classifier was updated in place
+     @return whether the classifier is trained
+     */
+    bool train(GRT::Classifier& classifier, const FeatureCache::Snapshot& features,
+               bool* is_updated);
+
+    /// @brief Makes the next train() start from scratch.
+    void invalidate();
+
+  private:
+    struct Delta {
+        // (label, entry) of the samples gone since the last training, and
+        // of those that are new.
+        std::vector<std::pair<uint32_t, FeatureCache::Entry>> removed;
+        std::vector<std::pair<uint32_t, FeatureCache::Entry>> added;
+    };
+
+    // Works out what changed between trained_ and features. Returns false
+    // if it's too much to be worth updating for.
+    bool computeDelta(const FeatureCache::Snapshot& features, Delta* delta) const;
+
+    bool is_valid_ = false;
+    // What the classifier was last trained on.
+    FeatureCache::Snapshot trained_;
+};
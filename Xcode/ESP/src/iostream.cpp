@@ -1,22 +1,28 @@
-#include "ofApp.h"
+#include "runtime.h"
 #include "iostream.h"
 
+#include <clocale>  // localeconv
+#include <cstdlib>  // strtod
+#include <cstring>  // memchr
+
 void useStream(IOStream &stream) {
-    ((ofApp *) ofGetAppPtr())->useIStream(stream);
-    ((ofApp *) ofGetAppPtr())->useOStream(stream);
+    getRuntime()->useIStream(stream);
+    getRuntime()->useOStream(stream);
 }
 
 void useStream(IOStreamVector &stream) {
-    ((ofApp *) ofGetAppPtr())->useIStream(stream);
-    ((ofApp *) ofGetAppPtr())->useOStream(stream);
+    getRuntime()->useIStream(stream);
+    getRuntime()->useOStream(stream);
 }
 
 ASCIISerialStream::ASCIISerialStream(uint32_t port, uint32_t baud, uint32_t dim)
-        : serial_(new ofSerial()), port_(port), baud_(baud), numDimensions_(dim) {
+        : serial_(new PollableSerial()), port_(port), baud_(baud), numDimensions_(dim),
+          sample_(1, dim), num_parsed_lines_(0), num_malformed_lines_(0) {
 }
 
 ASCIISerialStream::ASCIISerialStream(uint32_t baud, uint32_t dim)
-        : serial_(new ofSerial()), port_(-1), baud_(baud), numDimensions_(dim) {
+        : serial_(new PollableSerial()), port_(-1), baud_(baud), numDimensions_(dim),
+          sample_(1, dim), num_parsed_lines_(0), num_malformed_lines_(0) {
 }
 
 bool ASCIISerialStream::start() {
@@ -27,7 +33,14 @@ bool ASCIISerialStream::start() {
 
     if (!has_started_) {
         if (!serial_->setup(port_, baud_)) return false;
-        reading_thread_.reset(new std::thread(&ASCIISerialStream::readSerial, this));
+        partial_line_length_ = 0;
+        partial_line_overflowed_ = false;
+        using namespace std::placeholders;
+        if (!SerialReactor::instance().add(
+                serial_.get(), std::bind(&ASCIISerialStream::onSerialData, this, _1, _2))) {
+            serial_->close();
+            return false;
+        }
         has_started_ = true;
     }
 
@@ -35,10 +48,11 @@ bool ASCIISerialStream::start() {
 }
 
 void ASCIISerialStream::stop() {
-    has_started_ = false;
-    if (reading_thread_ != nullptr && reading_thread_->joinable()) {
-        reading_thread_->join();
+    if (has_started_) {
+        SerialReactor::instance().remove(serial_.get());
+        serial_->close();
     }
+    has_started_ = false;
 }
 
 void ASCIISerialStream::onReceive(uint32_t label) {
@@ -59,40 +73,97 @@ int ASCIISerialStream::getNumInputDimensions() {
     return numDimensions_;
 }
 
-void ASCIISerialStream::readSerial() {
-    // TODO(benzh) This readSerial is running in a different thread
-    // and performing a busy polling (100% CPU usage). Should be
-    // optimized.
-    int sleep_time = 10;
-    ofLog() << "Serial port will be read every " << sleep_time << " ms";
-    while (has_started_) {
-        string s;
-
-        do {
-            while (serial_->available() < 1) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time));
+void ASCIISerialStream::onSerialData(const unsigned char* bytes, size_t size) {
+    const char* data = reinterpret_cast<const char*>(bytes);
+    const char* end = data + size;
+
+    noteBytesArrived();
+    while (data < end) {
+        if (partial_line_length_ == 0 && !partial_line_overflowed_) { markSampleStart(); }
+        const char* newline = static_cast<const char*>(memchr(data, '\n', end - data));
+        const size_t length = (newline != nullptr ? newline : end) - data;
+
+        // Buffer the start of a line whose end hasn't arrived yet (or the
+        // rest of one that began in an earlier read).
+        if (newline == nullptr || partial_line_length_ > 0 || partial_line_overflowed_) {
+            if (partial_line_length_ + length > kMaxLineLength_) {
+                partial_line_overflowed_ = true;
+            } else {
+                memcpy(partial_line_ + partial_line_length_, data, length);
+                partial_line_length_ += length;
             }
-            s += serial_->readByte();
-        } while(s[s.length() - 1] != '\n');
+            if (newline == nullptr) { break; }
 
-        //ofLog() << "read: '" << s << "'" << endl;
+            if (partial_line_overflowed_) {
+                num_malformed_lines_++;
+            } else {
+                partial_line_[partial_line_length_] = '\n';
+                parseLine(partial_line_, partial_line_ + partial_line_length_);
+            }
+            partial_line_length_ = 0;
+            partial_line_overflowed_ = false;
+        } else if (length > kMaxLineLength_) {
+            num_malformed_lines_++;
+        } else {
+            parseLine(data, newline);
+        }
 
-        if (data_ready_callback_ != nullptr) {
-            istringstream iss(s);
-            vector<double> data;
-            double d;
+        data = newline + 1;
+    }
+}
 
-            while (iss >> d) data.push_back(d);
+static bool isNumberChar(char c) {
+    return (c >= '0' && c <= '9') || c == '.' || c == '+' || c == '-' || c == 'e' || c == 'E';
+}
 
-            if (data.size() > 0) {
-                data = normalize(data);
+// Parse the number at the start of [p, end) into *value, with '.' as the
+// decimal point whatever the C locale says. The number is copied out first,
+// so strtod() only ever sees digits, signs, exponents and the point (in
+// particular no leading whitespace, which it would skip, newlines
+// included). Returns where the number ends, or p if there isn't one.
+static const char* parseNumber(const char* p, const char* end, double* value) {
+    char number[64];
+    const char decimal_point = *localeconv()->decimal_point;
+    size_t n = 0;
+    for (const char* q = p; q < end && isNumberChar(*q); q++) {
+        if (n + 1 == sizeof(number)) { return p; }
+        number[n++] = (*q == '.') ? decimal_point : *q;
+    }
+    if (n == 0) { return p; }
+    number[n] = '\0';
 
-                GRT::MatrixDouble matrix;
-                matrix.push_back(data);
+    char* number_end;
+    *value = strtod(number, &number_end);
+    return number_end == number + n ? p + n : p;
+}
 
-                data_ready_callback_(matrix);
-            }
+void ASCIISerialStream::parseLine(const char* begin, const char* end) {
+    double* row = sample_[0];
+    uint32_t n = 0;
+    const char* p = begin;
+
+    while (true) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == ',')) p++;
+        if (p == end) break;
+
+        // Anything but a number between the separators makes the line
+        // malformed.
+        double d;
+        const char* number_end = parseNumber(p, end, &d);
+        if (number_end == p || n == numDimensions_) {
+            num_malformed_lines_++;
+            return;
         }
+        row[n++] = d;
+        p = number_end;
     }
-}
 
+    if (n == 0) return;  // blank line, e.g. a "\r\n" keep-alive
+    if (n != numDimensions_) {
+        num_malformed_lines_++;
+        return;
+    }
+    num_parsed_lines_++;
+
+    normalizeAndEmit(sample_);
+}
@@ -3,6 +3,8 @@
 #include "istream.h"
 #include "ostream.h"
 
+#include <atomic>
+
 class IOStream : public IStream, public OStream {};
 class IOStreamVector : public IStream, public OStreamVector {};
 
@@ -10,9 +12,11 @@ class IOStreamVector : public IStream, public OStreamVector {};
  @brief Input stream for reading ASCII data from a (USB) serial port.
 
  Data should be formatted as ASCII text, in newline-terminated lines. Each line
- consists of whitespace-separated numbers, e.g.
+ consists of whitespace- or comma-separated numbers, e.g.
  @verbatim 123 45 678 90 @endverbatim
- The numbers in each line of text are turned into a single data sample.
+ The numbers in each line of text are turned into a single data sample. Lines
+ that don't hold exactly numDimensions numbers are dropped and counted (see
+ getNumMalformedLines()).
 
  To use an ASCIISerialStream in your application, pass it to useStream() in
  your setup() function.
@@ -48,6 +52,13 @@ class ASCIISerialStream : public IOStreamVector {
     virtual void onReceive(uint32_t label);
     virtual void onReceive(vector<double> data);
 
+    /// @brief Number of lines successfully turned into samples.
+    uint64_t getNumParsedLines() const { return num_parsed_lines_.load(); }
+
+    /// @brief Number of lines discarded because they didn't hold exactly
+    /// numDimensions numbers, or were longer than kMaxLineLength_.
+    uint64_t getNumMalformedLines() const { return num_malformed_lines_.load(); }
+
     vector<string> getSerialDeviceList() {
         serial_->listDevices();
         vector<string> retval;
@@ -64,24 +75,37 @@ class ASCIISerialStream : public IOStreamVector {
                && "Should only reach here if ASCIISerialStream hasn't started");
 
         port_ = port;
-        if (!serial_->setup(port_, baud_)) {
-            return false;
-        }
-
-        reading_thread_.reset(new std::thread(&ASCIISerialStream::readSerial, this));
-        has_started_ = true;
-        return true;
+        return start();
     }
 
   private:
-    unique_ptr<ofSerial> serial_;
+    unique_ptr<PollableSerial> serial_;
     uint32_t port_;
     uint32_t baud_;
     uint32_t numDimensions_;
 
-    // A separate reading thread to read data from Serial.
-    unique_ptr<std::thread> reading_thread_;
-    void readSerial();
+    // Lines longer than this are counted as malformed and discarded.
+    static const size_t kMaxLineLength_ = 1024;
+
+    // A line that was split across two reads is assembled here; complete
+    // lines are parsed straight out of the read buffer. One extra byte holds
+    // the terminating newline.
+    char partial_line_[kMaxLineLength_ + 1];
+    size_t partial_line_length_ = 0;
+    bool partial_line_overflowed_ = false;
+
+    // Reused for every sample, so parsing a line allocates nothing (unless a
+    // vector normalizer is in use).
+    GRT::MatrixDouble sample_;
+
+    std::atomic<uint64_t> num_parsed_lines_;
+    std::atomic<uint64_t> num_malformed_lines_;
+
+    // Called by SerialReactor whenever bytes arrive.
+    void onSerialData(const unsigned char* data, size_t size);
+
+    // Parse [begin, end), where *end is the line's '\n'.
+    void parseLine(const char* begin, const char* end);
 };
 
 /**
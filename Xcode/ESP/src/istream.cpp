@@ -1,22 +1,26 @@
 #include "istream.h"
-#include "ofApp.h"
+#include "runtime.h"
 
 #include <chrono>         // std::chrono::milliseconds
+#include <cstring>        // std::memcpy
 #include <thread>         // std::this_thread::sleep_for
 
 void useInputStream(IStream &stream) {
-    ((ofApp *) ofGetAppPtr())->useIStream(stream);
+    getRuntime()->useIStream(stream);
 }
 
 void usePipeline(GRT::GestureRecognitionPipeline &pipeline) {
-    ((ofApp *) ofGetAppPtr())->usePipeline(pipeline);
+    getRuntime()->usePipeline(pipeline);
 }
 
-IStream::IStream() : data_ready_callback_(nullptr) {}
+IStream::IStream() : data_ready_callback_(nullptr), normalizer_latency_(nullptr) {}
 
 vector<double> IStream::normalize(vector<double> input) {
     if (vectorNormalizer_ != nullptr) {
         return vectorNormalizer_(input);
+    } else if (blockNormalizer_ != nullptr) {
+        blockNormalizer_(SampleBlock(input.data(), 1, input.size()));
+        return input;
     } else if (normalizer_ != nullptr) {
         vector<double> output;
         std::transform(input.begin(), input.end(), back_inserter(output), normalizer_);
@@ -26,6 +30,57 @@ vector<double> IStream::normalize(vector<double> input) {
     }
 }
 
+void IStream::emitData(const GRT::MatrixDouble& data, int64_t device_time_us) {
+    emitData(data, getMonotonicMicros(), device_time_us);
+}
+
+void IStream::normalizeAndEmit(GRT::MatrixDouble& data, int64_t device_time_us) {
+    normalizeAndEmit(data, getMonotonicMicros(), device_time_us);
+}
+
+void IStream::normalizeAndEmit(GRT::MatrixDouble& data, uint64_t host_time_us,
+                               int64_t device_time_us) {
+    if (vectorNormalizer_ != nullptr) {
+        GRT::MatrixDouble normalized;
+        {
+            LatencyTimer timer(normalizer_latency_, data.getNumRows());
+            for (uint32_t i = 0; i < data.getNumRows(); i++) {
+                normalized.push_back(vectorNormalizer_(data.getRowVector(i)));
+            }
+        }
+        emitData(normalized, host_time_us, device_time_us);
+        return;
+    }
+
+    if (blockNormalizer_ != nullptr) {
+        LatencyTimer timer(normalizer_latency_, data.getNumRows());
+        forEachBlock(data, blockNormalizer_);
+    } else if (normalizer_ != nullptr) {
+        LatencyTimer timer(normalizer_latency_, data.getNumRows());
+        for (uint32_t i = 0; i < data.getNumRows(); i++) {
+            for (uint32_t j = 0; j < data.getNumCols(); j++) {
+                data[i][j] = normalizer_(data[i][j]);
+            }
+        }
+    }
+    emitData(data, host_time_us, device_time_us);
+}
+
+void IStream::emitData(const GRT::MatrixDouble& data, uint64_t host_time_us,
+                       int64_t device_time_us) {
+    SampleStamp stamp;
+    stamp.host_time_us = host_time_us;
+    stamp.sequence = next_sequence_;
+    stamp.device_time_us = device_time_us;
+    stamp.arrival_time_us = sample_start_us_;
+    sample_start_us_ = 0;
+    next_sequence_ += data.getNumRows();
+
+    if (data_ready_callback_ != nullptr) {
+        data_ready_callback_(data, stamp);
+    }
+}
+
 void IStream::setLabelsForAllDimensions(const vector<string> labels) {
     istream_labels_ = labels;
 }
@@ -40,19 +95,46 @@ const vector<string>& IStream::getLabels() const {
     return istream_labels_;
 }
 
-AudioStream::AudioStream(uint32_t downsample_rate)
-        : downsample_rate_(downsample_rate),
-          sound_stream_(new ofSoundStream()) {
-    setup_successful_ = sound_stream_->setup(this, 0, 2,
+// Number of buffers in AudioStream's pool, i.e. how far (in buffers of
+// kOfSoundStream_BufferSize frames) processing may fall behind the callback.
+const uint32_t kAudioPoolSize = 32;
+
+// How long the processing thread sleeps when there is nothing to process.
+// Much shorter than one buffer (~5.8 ms).
+const std::chrono::microseconds kAudioPollInterval(1000);
+
+AudioStream::AudioStream(uint32_t downsample_rate, uint32_t num_channels)
+        : downsample_rate_(std::max<uint32_t>(downsample_rate, 1)),
+          num_channels_(std::max<uint32_t>(num_channels, 1)),
+          sound_stream_(new ofSoundStream()),
+          pool_(kAudioPoolSize), pool_head_(0), pool_tail_(0),
+          num_overruns_(0), is_processing_(false) {
+    for (AudioBuffer& buffer : pool_) {
+        buffer.samples.resize(kOfSoundStream_BufferSize * num_channels_);
+    }
+    decimator_.setup(downsample_rate_, num_channels_);
+    decimated_.resize(decimator_.getMaxOutputFrames(kOfSoundStream_BufferSize) *
+                      num_channels_);
+
+    // Built-in microphones are usually stereo, so open at least two channels.
+    setup_successful_ = sound_stream_->setup(this, 0, std::max<uint32_t>(num_channels_, 2),
                                              kOfSoundStream_SamplingRate,
                                              kOfSoundStream_BufferSize,
                                              kOfSoundStream_nBuffers);
     sound_stream_->stop();
 }
 
+AudioStream::~AudioStream() {
+    stop();
+}
+
 bool AudioStream::start() {
     if (!setup_successful_) return false;
     if (!has_started_) {
+        pool_head_ = pool_tail_.load();
+        decimator_.reset();
+        is_processing_ = true;
+        processing_thread_.reset(new std::thread(&AudioStream::processBuffers, this));
         sound_stream_->start();
         has_started_ = true;
     }
@@ -62,67 +144,161 @@ bool AudioStream::start() {
 void AudioStream::stop() {
     if (has_started_) {
         sound_stream_->stop();
+        is_processing_ = false;
+        if (processing_thread_ != nullptr && processing_thread_->joinable()) {
+            processing_thread_->join();
+        }
         has_started_ = false;
     }
 }
 
 int AudioStream::getNumInputDimensions() {
-    return 1; // set by the call to sound_stream->setup() above
+    return num_channels_;
 }
 
 void AudioStream::audioIn(float* input, int buffer_size, int nChannel) {
-    // set nChannelOut as 1 to load only a single channel (left).
-    int nChannelOut = 1;
-    GRT::MatrixDouble data(buffer_size / nChannel / downsample_rate_, nChannelOut);
+    // Runs on the audio thread: no allocation, locks or waiting here.
+    if (buffer_size < 0 || nChannel < 0) { return; }
+    const uint32_t num_frames = static_cast<uint32_t>(buffer_size);
+    const uint32_t num_input_channels = static_cast<uint32_t>(nChannel);
+
+    const uint64_t tail = pool_tail_.load(std::memory_order_relaxed);
+    if (tail - pool_head_.load(std::memory_order_acquire) == kAudioPoolSize ||
+        num_frames > kOfSoundStream_BufferSize) {
+        num_overruns_++;
+        return;
+    }
+
+    AudioBuffer& buffer = pool_[tail % kAudioPoolSize];
+    buffer.host_time_us = getMonotonicMicros();
+    buffer.num_frames = num_frames;
+    float* out = buffer.samples.data();
+    for (uint32_t i = 0; i < num_frames; i++) {
+        for (uint32_t c = 0; c < num_channels_; c++) {
+            *out++ = (c < num_input_channels) ? input[i * num_input_channels + c] : 0.0f;
+        }
+    }
+    pool_tail_.store(tail + 1, std::memory_order_release);
+}
 
-    for (int i = 0; i < buffer_size / nChannel / downsample_rate_; i++)
-        for (int j = 0; j < nChannelOut; j++)
-            data[i][j] = input[i * nChannel * downsample_rate_ + j];
+void AudioStream::processBuffers() {
+    while (is_processing_) {
+        const uint64_t head = pool_head_.load(std::memory_order_relaxed);
+        if (head == pool_tail_.load(std::memory_order_acquire)) {
+            std::this_thread::sleep_for(kAudioPollInterval);
+            continue;
+        }
 
-    if (data_ready_callback_ != nullptr) {
-        data_ready_callback_(data);
+        const AudioBuffer& buffer = pool_[head % kAudioPoolSize];
+        uint32_t n = decimator_.process(buffer.samples.data(), buffer.num_frames,
+                                        decimated_.data());
+        const uint64_t host_time_us = buffer.host_time_us;
+        pool_head_.store(head + 1, std::memory_order_release);
+
+        if (n == 0) continue;
+        if (block_.getNumRows() != n) block_.resize(n, num_channels_);
+        for (uint32_t i = 0; i < n; i++) {
+            for (uint32_t c = 0; c < num_channels_; c++) {
+                block_[i][c] = decimated_[i * num_channels_ + c];
+            }
+        }
+        normalizeAndEmit(block_, host_time_us, SampleStamp::kNoDeviceTime);
     }
 }
 
-AudioFileStream::AudioFileStream(char *file, bool loop) {
-    player_.load(file);
-    player_.setLoop(loop);
+// AudioFileStream analyses non-overlapping frames of this many samples.
+const uint32_t kAudioFileFrameSize = 1024;
+
+// Spectra per emitData() call in BATCH mode.
+const uint32_t kAudioFileBatchSize = 64;
+
+AudioFileStream::AudioFileStream(char *file, bool loop, PlaybackMode mode)
+        : filename_(file), loop_(loop), mode_(mode), is_finished_(false) {
+    fft_.setup(kAudioFileFrameSize);
+    frame_.resize(kAudioFileFrameSize);
+    if (mode_ == PACED) {
+        player_.load(file);
+        player_.setLoop(loop);
+    }
 }
 
 bool AudioFileStream::start() {
     if (!has_started_) {
-        player_.play();
-        update_thread_.reset(new std::thread(&AudioFileStream::readSpectrum, this));
+        if (!reader_.open(ofToDataPath(filename_))) return false;
+        is_finished_ = false;
         has_started_ = true;
+        if (mode_ == PACED) player_.play();
+        update_thread_.reset(new std::thread(&AudioFileStream::computeSpectra, this));
     }
     
     return true;
 }
 
 void AudioFileStream::stop() {
-    player_.stop();
+    if (mode_ == PACED) player_.stop();
     has_started_ = false;
     if (update_thread_ != nullptr && update_thread_->joinable()) {
         update_thread_->join();
     }
 }
 
-void AudioFileStream::readSpectrum() {
+bool AudioFileStream::readFrame() {
+    uint32_t n = reader_.read(frame_.data(), kAudioFileFrameSize);
+    if (n < kAudioFileFrameSize && loop_ && reader_.rewind()) {
+        // A partial frame at the end of the file is dropped, so that every
+        // pass over the file yields the same frames.
+        n = reader_.read(frame_.data(), kAudioFileFrameSize);
+    }
+    return n == kAudioFileFrameSize;
+}
+
+void AudioFileStream::computeSpectra() {
+    const uint32_t num_bins = getNumInputDimensions();
+    const uint32_t batch_size = (mode_ == BATCH) ? kAudioFileBatchSize : 1;
+    GRT::MatrixDouble spectra(batch_size, num_bins);
+
+    // In PACED mode, frame i is due i frames after the start.
+    const auto start_time = std::chrono::steady_clock::now();
+    const std::chrono::duration<double> frame_period(
+        (double) kAudioFileFrameSize / reader_.getSampleRate());
+    uint64_t num_frames = 0;
+
     while (has_started_) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000 / (44100 / 1024)));
-        float *spectrum = ofSoundGetSpectrum(512);
-        VectorDouble data(spectrum, spectrum + 512);
-        MatrixDouble out; out.push_back(data);
-        if (data_ready_callback_ != nullptr) data_ready_callback_(out);
+        uint32_t n = 0;
+        while (n < batch_size && readFrame()) {
+            fft_.computeMagnitudes(frame_.data(), spectra[n]);
+            n++;
+        }
+        if (n == 0) break;
+
+        if (mode_ == PACED) {
+            std::this_thread::sleep_until(start_time +
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    (num_frames + 1) * frame_period));
+        }
+        num_frames += n;
+
+        if (n < batch_size) {
+            // The last, partial batch.
+            GRT::MatrixDouble last(n, num_bins);
+            for (uint32_t i = 0; i < n; i++)
+                std::copy(spectra[i], spectra[i] + num_bins, last[i]);
+            normalizeAndEmit(last);
+            break;
+        }
+        normalizeAndEmit(spectra);
     }
+
+    // Still started here means the loop ended at the end of the file.
+    is_finished_ = has_started_;
 }
 
 int AudioFileStream::getNumInputDimensions() {
-    return 512;
+    return kAudioFileFrameSize / 2;
 }
 
 BaseSerialStream::BaseSerialStream(uint32_t port, uint32_t baud, int dimensions)
-        : port_(port), baud_(baud), dimensions_(dimensions), serial_(new ofSerial()) {
+        : port_(port), baud_(baud), dimensions_(dimensions), serial_(new PollableSerial()) {
     // Print all devices for convenience.
     // serial_->listDevices();
 }
@@ -135,7 +311,12 @@ bool BaseSerialStream::start() {
 
     if (!has_started_) {
         if (!serial_->setup(port_, baud_)) return false;
-        reading_thread_.reset(new std::thread(&BaseSerialStream::readSerial, this));
+        using namespace std::placeholders;
+        if (!SerialReactor::instance().add(
+                serial_.get(), std::bind(&BaseSerialStream::onSerialData, this, _1, _2))) {
+            serial_->close();
+            return false;
+        }
         has_started_ = true;
     }
 
@@ -143,86 +324,90 @@ bool BaseSerialStream::start() {
 }
 
 void BaseSerialStream::stop() {
-    has_started_ = false;
-    if (reading_thread_ != nullptr && reading_thread_->joinable()) {
-        reading_thread_->join();
+    if (has_started_) {
+        SerialReactor::instance().remove(serial_.get());
+        serial_->close();
     }
+    has_started_ = false;
 }
 
 int BaseSerialStream::getNumInputDimensions() {
     return dimensions_;
 }
 
-void BaseSerialStream::readSerial() {
-    // TODO(benzh) This readSerial is running in a different thread
-    // and performing a busy polling (100% CPU usage). Should be
-    // optimized.
-    int sleep_time = 1000 / (baud_ / 10); // sleep about long enough to receive a byte
-    ofLog() << "Serial port will be read every " << sleep_time << " ms";
-    while (has_started_) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time));
-        const int kBufSize = 32;
-        unsigned char buf[kBufSize];
-        while (serial_->available() > 0) {
-            int result = serial_->readBytes(buf, kBufSize);
-            
-            if ( result == OF_SERIAL_ERROR ) {
-                ofLog( OF_LOG_ERROR, "unrecoverable error reading from serial" );
-                break;
-            } else if ( result != OF_SERIAL_NO_DATA ) {
-                buffer_.insert(buffer_.end(), buf, buf + result);
-            }
-        }
-        
-        parseSerial(buffer_);
-    }
-}
-
-void BinaryIntArraySerialStream::parseSerial(vector<unsigned char> &buffer) {
-    auto start = std::find(buffer.begin(), buffer.end(), 0); // look for packet start
-    if (start != buffer.end()) {
-        buffer.erase(buffer.begin(), start); // advance to start of packet
-        if (buffer.size() >= 3) { // 0, LSB(n), MSB(n)
-            unsigned char checksum = 0;
-            int LSB = buffer[1]; checksum += LSB;
-            int MSB = buffer[2]; checksum += MSB;
-            int n = ((MSB & 0x7F) << 7) | (LSB & 0x7F);
-            if (buffer.size() >= 4 + 2 * n) {
-                vector<double> vals;
-                //std::cout << "Got array of " << n << " bytes: " << buffer.size();
-                for (int j = 3; j < (3 + 2 * n);) {
-                    LSB = buffer[j++]; checksum += LSB;
-                    MSB = buffer[j++]; checksum += MSB;
-                    int val = ((MSB & 0x7F) << 7) | (LSB & 0x7F);
-                    //std::cout << val << " ";
-                    vals.push_back(val);
+void BaseSerialStream::onSerialData(const unsigned char* data, size_t size) {
+    noteBytesArrived();
+    parseSerial(data, size);
+}
+
+void BinaryIntArraySerialStream::resync() {
+    // Drop the current packet and discard everything up to the next 0 byte.
+    // The bytes already consumed aren't rescanned.
+    num_resyncs_++;
+    skipping_ = true;
+    state_ = WAIT_FOR_START;
+}
+
+void BinaryIntArraySerialStream::parseSerial(const unsigned char* data, size_t size) {
+    const int dimensions = getNumInputDimensions();
+    if (sample_.getNumCols() != static_cast<uint32_t>(dimensions)) sample_.resize(1, dimensions);
+
+    for (const unsigned char* end = data + size; data < end; data++) {
+        const unsigned char b = *data;
+        switch (state_) {
+            case WAIT_FOR_START:
+                if (b == 0) {
+                    markSampleStart();
+                    skipping_ = false;
+                    checksum_ = 0;
+                    state_ = LENGTH_LSB;
+                } else if (!skipping_) {
+                    // Bytes between packets mean we've lost the framing.
+                    skipping_ = true;
+                    num_resyncs_++;
                 }
-                //std::cout << "(" << (checksum | 0x80) << " <> " << buffer[3 + 2 * n] << ")" << std::endl;
-                if ((checksum | 0x80) != buffer[3 + 2 * n]) {
-                    ofLog(OF_LOG_WARNING) << "Invalid checksum, discarding serial packet.";
-                } else if (n != getNumInputDimensions()) {
-                    ofLog(OF_LOG_WARNING) << "Serial packet contains " << n <<
-                        " dimensions. Expected " << getNumInputDimensions();
+                break;
+            case LENGTH_LSB:
+                checksum_ += b;
+                lsb_ = b;
+                state_ = LENGTH_MSB;
+                break;
+            case LENGTH_MSB:
+                checksum_ += b;
+                length_ = ((b & 0x7F) << 7) | (lsb_ & 0x7F);
+                num_values_ = 0;
+                if (length_ != dimensions) {
+                    resync();
                 } else {
-                    GRT::MatrixDouble data(1, n);
-                    for (int i = 0; i < getNumInputDimensions(); i++) {
-                        int b = vals[i];
-                        data[0][i] = (normalizer_ != nullptr) ? normalizer_(b) : b;
-                    }
-                    if (data_ready_callback_ != nullptr) {
-                        data_ready_callback_(data);
-                    }
-                    
+                    state_ = (length_ > 0) ? VALUE_LSB : CHECKSUM;
                 }
-                
-                buffer.erase(buffer.begin(), buffer.begin() + (4 + 2 * n));
-            }
+                break;
+            case VALUE_LSB:
+                checksum_ += b;
+                lsb_ = b;
+                state_ = VALUE_MSB;
+                break;
+            case VALUE_MSB:
+                checksum_ += b;
+                sample_[0][num_values_++] = ((b & 0x7F) << 7) | (lsb_ & 0x7F);
+                state_ = (num_values_ < length_) ? VALUE_LSB : CHECKSUM;
+                break;
+            case CHECKSUM:
+                if ((checksum_ | 0x80) != b) {
+                    num_checksum_errors_++;
+                    resync();
+                    break;
+                }
+                num_packets_++;
+                state_ = WAIT_FOR_START;
+                normalizeAndEmit(sample_);
+                break;
         }
     }
 }
 
 SerialStream::SerialStream(uint32_t port, uint32_t baud = 115200)
-        : port_(port), baud_(baud), serial_(new ofSerial()) {
+        : port_(port), baud_(baud), serial_(new PollableSerial()) {
     // Print all devices for convenience.
     // serial_->listDevices();
 }
@@ -235,7 +420,13 @@ bool SerialStream::start() {
 
     if (!has_started_) {
         if (!serial_->setup(port_, baud_)) return false;
-        reading_thread_.reset(new std::thread(&SerialStream::readSerial, this));
+        num_bytes_ = 0;
+        using namespace std::placeholders;
+        if (!SerialReactor::instance().add(
+                serial_.get(), std::bind(&SerialStream::onSerialData, this, _1, _2))) {
+            serial_->close();
+            return false;
+        }
         has_started_ = true;
     }
 
@@ -243,71 +434,74 @@ bool SerialStream::start() {
 }
 
 void SerialStream::stop() {
-    has_started_ = false;
-    if (reading_thread_ != nullptr && reading_thread_->joinable()) {
-        reading_thread_->join();
+    if (has_started_) {
+        SerialReactor::instance().remove(serial_.get());
+        serial_->close();
     }
+    has_started_ = false;
 }
 
 int SerialStream::getNumInputDimensions() {
     return 1;
 }
 
-void SerialStream::readSerial() {
-    // TODO(benzh) This readSerial is running in a different thread
-    // and performing a busy polling (100% CPU usage). Should be
-    // optimized.
-    int sleep_time = kBufferSize_ * 1000 / (baud_ / 10);
-    ofLog() << "Serial port will be read every " << sleep_time << " ms";
-    while (has_started_) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time));
-
-        int local_buffer_size = kBufferSize_;
-        int bytesRequired = kBufferSize_;
-        unsigned char bytes[bytesRequired];
-        int bytesRemaining = bytesRequired;
-        while (bytesRemaining > 0) {
-            // check for data
-            if (serial_->available() > 0) {
-                // try to read - note offset into the bytes[] array, this is so
-                // that we don't overwrite the bytes we already have
-                int bytesArrayOffset = bytesRequired - bytesRemaining;
-                int result = serial_->readBytes(&bytes[bytesArrayOffset],
-                                                bytesRemaining);
-
-                // check for error code
-                if (result == OF_SERIAL_ERROR) {
-                    // something bad happened
-                    ofLog(OF_LOG_ERROR) << "Error reading from serial";
-                    break;
-                } else if (result == OF_SERIAL_NO_DATA) {
-                    // nothing was read, try again
-                } else {
-                    // we read some data!
-                    bytesRemaining -= result;
-                }
-            }
-        }
-        GRT::MatrixDouble data(local_buffer_size, 1);
-        for (int i = 0; i < local_buffer_size; i++) {
-            int b = bytes[i];
-            data[i][0] = (normalizer_ != nullptr) ? normalizer_(b) : b;
-        }
-        if (data_ready_callback_ != nullptr) {
-            data_ready_callback_(data);
+void SerialStream::onSerialData(const unsigned char* data, size_t size) {
+    // Bytes are delivered in blocks of kBufferSize_, one byte per sample.
+    noteBytesArrived();
+    while (size > 0) {
+        if (num_bytes_ == 0) { markSampleStart(); }
+        uint32_t n = std::min<size_t>(size, kBufferSize_ - num_bytes_);
+        std::memcpy(bytes_ + num_bytes_, data, n);
+        num_bytes_ += n;
+        data += n;
+        size -= n;
+
+        if (num_bytes_ < kBufferSize_) { break; }
+        num_bytes_ = 0;
+
+        GRT::MatrixDouble block(kBufferSize_, 1);
+        for (uint32_t i = 0; i < kBufferSize_; i++) {
+            block[i][0] = bytes_[i];
         }
+        normalizeAndEmit(block);
     }
 }
 
-FirmataStream::FirmataStream(uint32_t port) : port_(port) {
-    ofSerial serial;
-    serial.listDevices();
+// Firmata protocol bytes.
+static const unsigned char kFirmataAnalogMessage = 0xE0;  // | pin, LSB, MSB
+static const unsigned char kFirmataReportAnalog = 0xC0;   // | pin, on/off
+static const unsigned char kFirmataReportVersion = 0xF9;  // major, minor
+static const unsigned char kFirmataStartSysex = 0xF0;
+static const unsigned char kFirmataEndSysex = 0xF7;
+static const unsigned char kFirmataSamplingInterval = 0x7A;
+
+// How long a board gets to answer REPORT_VERSION before it's configured
+// anyway. Boards that reset when the port opens take about 2 s to boot.
+static const std::chrono::milliseconds kFirmataVersionTimeout(5000);
+static const std::chrono::milliseconds kFirmataVersionPollInterval(10);
+
+FirmataStream::FirmataStream(uint32_t port, uint32_t baud)
+        : port_(port), baud_(baud), sampling_interval_ms_(10),
+          serial_(new PollableSerial()), num_samples_(0), num_incomplete_cycles_(0) {
+}
+
+FirmataStream::~FirmataStream() {
+    stop();
 }
 
 void FirmataStream::useAnalogPin(int i) {
+    if (i < 0 || i > 15) {
+        ofLog(OF_LOG_ERROR) << "FirmataStream: analog pin " << i << " out of range";
+        return;
+    }
     pins_.push_back(i);
 };
 
+void FirmataStream::setSamplingInterval(uint32_t ms) {
+    // The interval is sent as two 7-bit bytes.
+    sampling_interval_ms_ = std::max(1u, std::min(ms, 0x3FFFu));
+}
+
 bool FirmataStream::start() {
     if (port_ == -1) {
         ofLog(OF_LOG_ERROR) << "USB Port has not been properly set";
@@ -319,13 +513,31 @@ bool FirmataStream::start() {
         return false;
     }
 
-
     if (!has_started_) {
-        ofSerial serial;
-        configured_arduino_ = false;
-        if (!arduino_.connect(serial.getDeviceList()[port_].getDevicePath()))
+        values_.assign(pins_.size(), 0);
+        sample_.resize(1, pins_.size());
+        all_pins_ = 0;
+        for (int pin : pins_) all_pins_ |= 1u << pin;
+        reported_pins_ = 0;
+        command_ = 0;
+        message_length_ = 0;
+        in_sysex_ = false;
+        is_configured_ = false;
+
+        if (!serial_->setup(port_, baud_)) return false;
+        using namespace std::placeholders;
+        if (!SerialReactor::instance().add(
+                serial_.get(), std::bind(&FirmataStream::onSerialData, this, _1, _2))) {
+            serial_->close();
             return false;
-        update_thread_.reset(new std::thread(&FirmataStream::update, this));
+        }
+
+        // Most boards reset when the port opens and announce their version
+        // once booted; ask anyway for those that don't. Either answer
+        // triggers configure(); if neither comes, waitForVersion() calls it.
+        serial_->writeByte(kFirmataReportVersion);
+        is_waiting_for_version_ = true;
+        version_thread_.reset(new std::thread(&FirmataStream::waitForVersion, this));
         has_started_ = true;
     }
 
@@ -333,36 +545,108 @@ bool FirmataStream::start() {
 }
 
 void FirmataStream::stop() {
-    has_started_ = false;
-    if (update_thread_ != nullptr && update_thread_->joinable()) {
-        update_thread_->join();
+    if (has_started_) {
+        is_waiting_for_version_ = false;
+        if (version_thread_ != nullptr && version_thread_->joinable()) {
+            version_thread_->join();
+        }
+        SerialReactor::instance().remove(serial_.get());
+        setPinReporting(false);
+        serial_->close();
     }
+    has_started_ = false;
 }
 
 int FirmataStream::getNumInputDimensions() {
     return pins_.size();
 }
 
-void FirmataStream::update() {
-    int sleep_time = 10;
-    ofLog() << "Serial port will be read every " << sleep_time << " ms";
-    while (has_started_) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time));
-        arduino_.update();
-
-        if (configured_arduino_) {
-            vector<double> data(pins_.size());
-            for (int i = 0; pins_.size(); i++)
-                data[i] = arduino_.getAnalog(pins_[i]);
-            data = normalize(data);
-            GRT::MatrixDouble matrix;
-            matrix.push_back(data);
-            if (data_ready_callback_ != nullptr) data_ready_callback_(matrix);
-        } else if (arduino_.isInitialized()) {
-            ofLog() << "Configuring Arduino.";
-            for (int i = 0; i < pins_.size(); i++)
-                arduino_.sendAnalogPinReporting(pins_[i], ARD_ON);
-            configured_arduino_ = true;
+void FirmataStream::waitForVersion() {
+    const auto deadline = std::chrono::steady_clock::now() + kFirmataVersionTimeout;
+    while (is_waiting_for_version_ && !is_configured_) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            ofLog(OF_LOG_WARNING) << "Firmata board didn't report its version within "
+                                  << kFirmataVersionTimeout.count()
+                                  << " ms, configuring it anyway.";
+            configure();
+            return;
         }
+        std::this_thread::sleep_for(kFirmataVersionPollInterval);
     }
 }
+
+void FirmataStream::configure() {
+    std::lock_guard<std::mutex> guard(configure_mutex_);
+    is_configured_ = true;
+    unsigned char interval[] = {
+        kFirmataStartSysex, kFirmataSamplingInterval,
+        (unsigned char) (sampling_interval_ms_ & 0x7F),
+        (unsigned char) ((sampling_interval_ms_ >> 7) & 0x7F),
+        kFirmataEndSysex,
+    };
+    serial_->writeBytes(interval, sizeof(interval));
+    setPinReporting(true);
+}
+
+void FirmataStream::setPinReporting(bool on) {
+    for (int pin : pins_) {
+        unsigned char report[] = {
+            (unsigned char) (kFirmataReportAnalog | pin), (unsigned char) on };
+        serial_->writeBytes(report, sizeof(report));
+    }
+}
+
+void FirmataStream::onSerialData(const unsigned char* data, size_t size) {
+    noteBytesArrived();
+    for (const unsigned char* end = data + size; data < end; data++) {
+        const unsigned char b = *data;
+        if (b & 0x80) {
+            // A new message; whatever was in progress is abandoned.
+            in_sysex_ = (b == kFirmataStartSysex);
+            command_ = (b == kFirmataStartSysex || b == kFirmataEndSysex) ? 0 : b;
+            message_length_ = 0;
+            continue;
+        }
+
+        // Sysex replies (e.g. the firmware name) and messages we don't
+        // decode are skipped.
+        if (in_sysex_ || command_ == 0) continue;
+
+        message_[message_length_++] = b;
+        if (message_length_ < 2) continue;
+
+        if ((command_ & 0xF0) == kFirmataAnalogMessage) {
+            onAnalogMessage(command_ & 0x0F, message_[0] | (message_[1] << 7));
+        } else if (command_ == kFirmataReportVersion) {
+            ofLog() << "Firmata " << (int) message_[0] << "." << (int) message_[1]
+                    << " detected, configuring Arduino.";
+            configure();
+        }
+        command_ = 0;
+        message_length_ = 0;
+    }
+}
+
+void FirmataStream::onAnalogMessage(int pin, int value) {
+    const uint32_t bit = 1u << pin;
+    if ((all_pins_ & bit) == 0) return;
+
+    // The board reports the enabled pins in turn every sampling interval. A
+    // pin reporting twice means the cycle lost a report; start over.
+    if (reported_pins_ & bit) {
+        num_incomplete_cycles_++;
+        reported_pins_ = 0;
+    }
+    if (reported_pins_ == 0) { markSampleStart(); }
+    reported_pins_ |= bit;
+
+    for (uint32_t i = 0; i < pins_.size(); i++) {
+        if (pins_[i] == pin) values_[i] = value;
+    }
+    if (reported_pins_ != all_pins_) return;
+    reported_pins_ = 0;
+    num_samples_++;
+
+    std::copy(values_.begin(), values_.end(), sample_[0]);
+    normalizeAndEmit(sample_);
+}
@@ -10,10 +10,21 @@
 #pragma once
 
 #include "GRT/GRT.h"
+#include "decimator.h"
+#include "latency-histogram.h"
 #include "ofMain.h"
+#include "real-fft.h"
+#include "sample-block.h"
+#include "sample-queue.h"
+#include "sample-stamp.h"
+#include "serial-reactor.h"
 #include "stream.h"
+#include "wav-reader.h"
 
+#include <atomic>
 #include <cstdint>
+#include <mutex>
+#include <thread>
 
 // See more documentation:
 // http://openframeworks.cc/documentation/sound/ofSoundStream/#show_setup
@@ -52,6 +63,7 @@ class IStream : public virtual Stream {
     void useNormalizer(normalizeFunc f) {
         normalizer_ = f;
         vectorNormalizer_ = nullptr;
+        blockNormalizer_ = nullptr;
     }
 
     // Supply a normalization function: vector<double> -> vector<double>
@@ -59,18 +71,34 @@ class IStream : public virtual Stream {
     void useNormalizer(vectorNormalizeFunc f) {
         normalizer_ = nullptr;
         vectorNormalizer_ = f;
+        blockNormalizer_ = nullptr;
     }
 
-    typedef std::function<void(GRT::MatrixDouble)> onDataReadyCallback;
+    // Supply a normalization function that transforms a block of incoming
+    // samples in place, such as AffineTransform or VectorNormalization (see
+    // sample-block.h). It's called once per block rather than once per value
+    // or sample, and allocates nothing. It can't change the number of
+    // dimensions.
+    void useBlockNormalizer(BlockTransformFunc f) {
+        normalizer_ = nullptr;
+        vectorNormalizer_ = nullptr;
+        blockNormalizer_ = f;
+    }
+
+    // Called with one or more samples (one per row) and the stamp of the
+    // first one. The rows were captured together: they share its times and
+    // have consecutive sequence numbers.
+    typedef std::function<void(const GRT::MatrixDouble&, const SampleStamp&)>
+        onDataReadyCallback;
 
     void onDataReadyEvent(onDataReadyCallback callback) {
         data_ready_callback_ = callback;
     }
 
-    template<typename T1, typename arg, class T>
-    void onDataReadyEvent(T1* owner, void (T::*listenerMethod)(arg)) {
+    template<typename T1, typename arg1, typename arg2, class T>
+    void onDataReadyEvent(T1* owner, void (T::*listenerMethod)(arg1, arg2)) {
         using namespace std::placeholders;
-        data_ready_callback_ = std::bind(listenerMethod, owner, _1);
+        data_ready_callback_ = std::bind(listenerMethod, owner, _1, _2);
     }
 
     // Set labels on all input dimension. This function takes either a vector of
@@ -80,48 +108,167 @@ class IStream : public virtual Stream {
 
     const vector<string>& getLabels() const;
 
+    // Choose what happens to this stream's samples when the app can't keep
+    // up with them: wait, drop some, or reduce the rate (see
+    // SampleQueue::OverflowPolicy; `factor` is for DECIMATE and COALESCE).
+    // Call from setup(). Defaults to BLOCK. For streams joined by a
+    // FusionStream, set it on the FusionStream.
+    void setOverloadPolicy(SampleQueue::OverflowPolicy policy, uint32_t factor = 2) {
+        overload_policy_ = policy;
+        overload_factor_ = factor;
+    }
+    SampleQueue::OverflowPolicy getOverloadPolicy() const { return overload_policy_; }
+    uint32_t getOverloadFactor() const { return overload_factor_; }
+
+    // Time the normalizer into `histogram` (per sample), or stop timing it if
+    // it's nullptr. Can be called while the stream is running.
+    void setNormalizerLatency(LatencyHistogram* histogram) {
+        normalizer_latency_ = histogram;
+    }
+
   protected:
     vector<string> istream_labels_;
     onDataReadyCallback data_ready_callback_;
     normalizeFunc normalizer_;
     vectorNormalizeFunc vectorNormalizer_;
+    BlockTransformFunc blockNormalizer_;
+    std::atomic<LatencyHistogram*> normalizer_latency_;
 
     vector<double> normalize(vector<double>);
+
+    // Stamp `data` (one sample per row) with the current time and the next
+    // sequence numbers, and pass it to the data ready callback. Streams with
+    // a device clock pass the device's capture time of the samples.
+    void emitData(const GRT::MatrixDouble& data,
+                  int64_t device_time_us = SampleStamp::kNoDeviceTime);
+
+    // As above, for streams that note the capture time themselves.
+    void emitData(const GRT::MatrixDouble& data, uint64_t host_time_us,
+                  int64_t device_time_us);
+
+    // For streams that put samples together from bytes read in pieces: call
+    // noteBytesArrived() whenever a read returns and markSampleStart() at the
+    // first byte of each sample. The next emitData() stamps its samples with
+    // the time that byte arrived (see SampleStamp::arrival_time_us).
+    void noteBytesArrived() { read_time_us_ = getMonotonicMicros(); }
+    void markSampleStart() { sample_start_us_ = read_time_us_; }
+
+    // Run `data` through the normalizer, if any, then emit it as above. The
+    // normalization happens in place unless it's a vector normalizer (which
+    // may change the number of dimensions).
+    void normalizeAndEmit(GRT::MatrixDouble& data,
+                          int64_t device_time_us = SampleStamp::kNoDeviceTime);
+    void normalizeAndEmit(GRT::MatrixDouble& data, uint64_t host_time_us,
+                          int64_t device_time_us);
+
+  private:
+    uint64_t next_sequence_ = 0;
+    uint64_t read_time_us_ = 0;
+    uint64_t sample_start_us_ = 0;
+    SampleQueue::OverflowPolicy overload_policy_ = SampleQueue::BLOCK;
+    uint32_t overload_factor_ = 2;
 };
 
 /**
  @brief Input stream for reading audio from the computer's microphone.
+
+ The audio callback only copies each buffer into a preallocated pool; it
+ never allocates, locks or waits. A separate thread filters and downsamples
+ the buffers and passes them on, one sample per frame and one dimension per
+ channel.
  */
 class AudioStream : public ofBaseApp, public IStream {
   public:
-    AudioStream(uint32_t downsample_rate = 1);
+    /**
+     Create an AudioStream instance.
+
+     @param downsample_rate: the factor by which to reduce the 44.1 kHz
+     sampling rate. The audio is low-pass filtered first, so frequencies above
+     the new Nyquist frequency don't alias.
+     @param num_channels: the number of input channels to capture.
+     */
+    AudioStream(uint32_t downsample_rate = 1, uint32_t num_channels = 1);
+    ~AudioStream();
     void audioIn(float *input, int buffer_size, int nChannel);
     virtual bool start() final;
     virtual void stop() final;
     virtual int getNumInputDimensions() final;
+
+    /// @brief Number of buffers dropped because the pool was full, i.e. the
+    /// processing thread fell behind.
+    uint64_t getNumOverruns() const { return num_overruns_.load(); }
+
   private:
+    void processBuffers();
+
     uint32_t downsample_rate_;
+    uint32_t num_channels_;
     unique_ptr<ofSoundStream> sound_stream_;
     bool setup_successful_;
+
+    // A ring of buffers filled by audioIn() and emptied by processBuffers().
+    // Each holds up to kOfSoundStream_BufferSize frames of num_channels_
+    // interleaved samples.
+    struct AudioBuffer {
+        vector<float> samples;
+        uint32_t num_frames;
+        uint64_t host_time_us;
+    };
+    vector<AudioBuffer> pool_;
+    std::atomic<uint64_t> pool_head_;
+    std::atomic<uint64_t> pool_tail_;
+    std::atomic<uint64_t> num_overruns_;
+
+    // Used only by the processing thread.
+    Decimator decimator_;
+    vector<float> decimated_;
+    GRT::MatrixDouble block_;
+    std::atomic<bool> is_processing_;
+    unique_ptr<std::thread> processing_thread_;
 };
 
 /**
  @brief Input stream for getting the FFT spectrum of an audio file as it plays.
  
- This class plays an audio file and supplies its 1024-sample / 512-bin FFT
- spectrum as input to the current pipeline. The spectrum is supplied every
- ~23 milliseconds (i.e. 441000 KHz / 1024 = ~43 Hz).
+ This class decodes a WAV file and supplies its 1024-sample / 512-bin FFT
+ spectrum as input to the current pipeline, one spectrum per 1024 samples
+ (~43 Hz for a 44.1 kHz file). The spectra are computed by the stream itself
+ from consecutive, non-overlapping frames, so every frame is used exactly
+ once and a given file always produces bit-identical data.
+
+ In PACED mode, the file is also played aloud and spectra are supplied at the
+ file's own rate. In BATCH mode nothing is played and spectra are supplied as
+ fast as the pipeline accepts them, e.g. to evaluate a pipeline over hours of
+ recordings.
  */
 class AudioFileStream : public IStream {
   public:
-    AudioFileStream(char *file, bool loop = false);
+    enum PlaybackMode { PACED, BATCH };
+
+    AudioFileStream(char *file, bool loop = false, PlaybackMode mode = PACED);
     virtual bool start() final;
     virtual void stop() final;
     virtual int getNumInputDimensions() final;
+
+    /// @brief Whether the whole file has been processed (never, when looping).
+    bool isFinished() const { return is_finished_.load(); }
+
   private:
-    void readSpectrum();
-  
+    void computeSpectra();
+
+    // Read the next frame into frame_, going back to the start of the file
+    // when looping. Returns false at the end of the file.
+    bool readFrame();
+
+    string filename_;
+    bool loop_;
+    PlaybackMode mode_;
+
     ofSoundPlayer player_;
+    WavReader reader_;
+    RealFFT fft_;
+    vector<float> frame_;
+    std::atomic<bool> is_finished_;
     unique_ptr<std::thread> update_thread_;
 };
 
@@ -132,19 +279,19 @@ class BaseSerialStream : public IStream {
     virtual void stop() final;
     virtual int getNumInputDimensions() final;
   protected:
-    virtual void parseSerial(vector<unsigned char> &buffer) = 0;
+    // Called on the serial reactor thread with each chunk of bytes read from
+    // the port. Chunks don't respect packet boundaries, so subclasses must
+    // carry partial packets over from one call to the next.
+    virtual void parseSerial(const unsigned char* data, size_t size) = 0;
   private:
     uint32_t port_ = -1;
     uint32_t baud_;
     int dimensions_;
 
-    vector<unsigned char> buffer_;
-
-    unique_ptr<ofSerial> serial_;
+    unique_ptr<PollableSerial> serial_;
 
-    // A separate reading thread to read data from Serial.
-    unique_ptr<std::thread> reading_thread_;
-    void readSerial();
+    // Called by SerialReactor whenever bytes arrive.
+    void onSerialData(const unsigned char* data, size_t size);
 };
 
 class SerialStream : public IStream {
@@ -157,37 +304,99 @@ class SerialStream : public IStream {
     uint32_t port_ = -1;
     uint32_t baud_;
     // Serial buffer size
-    uint32_t kBufferSize_ = 64;
+    static const uint32_t kBufferSize_ = 64;
 
-    unique_ptr<ofSerial> serial_;
+    // Bytes collected so far towards the next kBufferSize_ sample block.
+    unsigned char bytes_[kBufferSize_];
+    uint32_t num_bytes_ = 0;
 
-    // A separate reading thread to read data from Serial.
-    unique_ptr<std::thread> reading_thread_;
-    void readSerial();
+    unique_ptr<PollableSerial> serial_;
+
+    // Called by SerialReactor whenever bytes arrive.
+    void onSerialData(const unsigned char* data, size_t size);
 };
 
+/**
+ @brief Input stream for reading arrays of integers sent in binary packets
+ over a (USB) serial port, e.g. by the Touche board.
+
+ Each packet is a 0 byte, the array length n as two 7-bit bytes (LSB first),
+ n values as two 7-bit bytes each (LSB first) and finally a checksum byte: the
+ sum of the length and value bytes, with its high bit set.
+
+ Packets are decoded byte by byte as they arrive, so no backlog builds up.
+ Packets with a bad checksum or the wrong length are dropped and counted.
+ */
 class BinaryIntArraySerialStream : public BaseSerialStream {
   public:
     using BaseSerialStream::BaseSerialStream; // inherit constructors
+
+    /// @brief Number of packets decoded and passed on.
+    uint64_t getNumPackets() const { return num_packets_.load(); }
+
+    /// @brief Number of packets dropped because their checksum was wrong.
+    uint64_t getNumChecksumErrors() const { return num_checksum_errors_.load(); }
+
+    /// @brief Number of times the decoder lost track of packet boundaries
+    /// (bad checksum or length, or stray bytes between packets) and had to
+    /// hunt for the next packet start.
+    uint64_t getNumResyncs() const { return num_resyncs_.load(); }
+
   private:
-    virtual void parseSerial(vector<unsigned char> &buffer);
+    virtual void parseSerial(const unsigned char* data, size_t size);
+    void resync();
+
+    enum DecoderState {
+        WAIT_FOR_START,
+        LENGTH_LSB,
+        LENGTH_MSB,
+        VALUE_LSB,
+        VALUE_MSB,
+        CHECKSUM,
+    };
+
+    DecoderState state_ = WAIT_FOR_START;
+    bool skipping_ = false;  // discarding bytes while looking for a start
+    unsigned char checksum_ = 0;
+    unsigned char lsb_ = 0;
+    int length_ = 0;
+    int num_values_ = 0;
+
+    // Values are decoded straight into this row, which is reused for every
+    // packet.
+    GRT::MatrixDouble sample_;
+
+    std::atomic<uint64_t> num_packets_{0};
+    std::atomic<uint64_t> num_checksum_errors_{0};
+    std::atomic<uint64_t> num_resyncs_{0};
 };
 
 /**
  @brief Input stream for reading analog data from an Arduino running Firmata.
 
+ The stream speaks the Firmata protocol itself on a port watched by the
+ SerialReactor, so pin reports are parsed as soon as they arrive. It emits
+ one sample each time every configured pin has reported, i.e. once per
+ sampling interval of the board.
+
+ The pins are configured once the board reports its Firmata version. Boards
+ that don't report it within a few seconds are configured anyway, with a
+ warning.
+
  To use an FirmataStream in your application, pass it to useInputStream() in
  your setup() function.
  */
 class FirmataStream : public IStream {
   public:
     /**
-     Create a FirmataStream instance. Assumes the Arduino is communicating at
-     57600 baud.
+     Create a FirmataStream instance. StandardFirmata communicates at 57600
+     baud.
 
      @param port: the index of the (USB) serial port to use.
+     @param baud: the baud rate of the Firmata firmware.
      */
-    FirmataStream(uint32_t port);
+    FirmataStream(uint32_t port, uint32_t baud = 57600);
+    ~FirmataStream();
     virtual bool start() final;
     virtual void stop() final;
     virtual int getNumInputDimensions() final;
@@ -199,19 +408,66 @@ class FirmataStream : public IStream {
      call to useAnalogPin() will appear first in the data provided by the
      FirmataStream).
 
-     @param i: an analog pin to read from
+     @param i: an analog pin to read from, 0 to 15
      */
     void useAnalogPin(int i);
+
+    /**
+     Set how often the board reports the analog pins (Firmata's
+     SAMPLING_INTERVAL), in milliseconds. Defaults to 10 ms; StandardFirmata
+     accepts intervals down to 1 ms, though at 57600 baud each pin report
+     takes about 0.5 ms to send. Call before start().
+     */
+    void setSamplingInterval(uint32_t ms);
+
+    uint64_t getNumSamples() const { return num_samples_.load(); }
+
+    /// @brief Number of report cycles that were cut short because a pin
+    /// reported again before all pins had (e.g. after a lost byte).
+    uint64_t getNumIncompleteCycles() const { return num_incomplete_cycles_.load(); }
+
   private:
     uint32_t port_;
+    uint32_t baud_;
+    uint32_t sampling_interval_ms_;
 
     vector<int> pins_;
 
-    bool configured_arduino_;
-
-    ofArduino arduino_;
-    unique_ptr<std::thread> update_thread_;
-    void update();
+    unique_ptr<PollableSerial> serial_;
+
+    // Parser state. Firmata messages start with a byte that has its high bit
+    // set, followed by 7-bit data bytes.
+    unsigned char command_ = 0;
+    unsigned char message_[2];
+    uint32_t message_length_ = 0;
+    bool in_sysex_ = false;
+
+    // Bit i is set once analog pin i has reported in the current cycle.
+    uint32_t reported_pins_ = 0;
+    uint32_t all_pins_ = 0;
+    vector<double> values_;  // latest reading of each of pins_
+    GRT::MatrixDouble sample_;
+
+    std::atomic<uint64_t> num_samples_;
+    std::atomic<uint64_t> num_incomplete_cycles_;
+
+    // configure() runs when the board reports its version, on the reactor
+    // thread, or on version_thread_ if it doesn't report it in time.
+    std::atomic<bool> is_configured_{false};
+    std::atomic<bool> is_waiting_for_version_{false};
+    unique_ptr<std::thread> version_thread_;
+    std::mutex configure_mutex_;
+
+    // Called by SerialReactor whenever bytes arrive.
+    void onSerialData(const unsigned char* data, size_t size);
+    void onAnalogMessage(int pin, int value);
+
+    // Configure the board if it hasn't reported its version by the timeout.
+    void waitForVersion();
+
+    // Set the sampling interval and turn on reporting of our pins.
+    void configure();
+    void setPinReporting(bool on);
 };
 
 /**
@@ -0,0 +1,67 @@
+#include "latency-histogram.h"
+#include "gtest/gtest.h"
+
+TEST(LatencyHistogramTest, EmptyHistogramReportsZero) {
+    LatencyHistogram histogram;
+    EXPECT_EQ(0, histogram.getCount());
+    EXPECT_EQ(0, histogram.getPercentile(50));
+    EXPECT_EQ(0, histogram.getMax());
+}
+
+TEST(LatencyHistogramTest, SmallValuesAreExact) {
+    LatencyHistogram histogram;
+    for (uint64_t v = 1; v <= 20; v++) { histogram.record(v); }
+
+    EXPECT_EQ(20, histogram.getCount());
+    EXPECT_EQ(10, histogram.getPercentile(50));
+    EXPECT_EQ(20, histogram.getPercentile(100));
+    EXPECT_EQ(20, histogram.getMax());
+}
+
+TEST(LatencyHistogramTest, PercentilesAreWithinBucketPrecision) {
+    LatencyHistogram histogram;
+    // 1..10000 us, in nanoseconds.
+    for (uint64_t v = 1; v <= 10000; v++) { histogram.record(v * 1000); }
+
+    const double tolerance = 1.0 / LatencyHistogram::kSubBuckets;
+    EXPECT_NEAR(5000e3, histogram.getPercentile(50), 5000e3 * tolerance);
+    EXPECT_NEAR(9900e3, histogram.getPercentile(99), 9900e3 * tolerance);
+    EXPECT_GE(histogram.getPercentile(99), 9900e3);
+    EXPECT_EQ(10000000, histogram.getMax());
+    EXPECT_EQ(10000000, histogram.getPercentile(100));
+}
+
+TEST(LatencyHistogramTest, RecordsCountsAndResets) {
+    LatencyHistogram histogram;
+    histogram.record(100, 99);
+    histogram.record(1000000);
+
+    EXPECT_EQ(100, histogram.getCount());
+    // Rounded up to the end of 100's bucket.
+    EXPECT_GE(histogram.getPercentile(99), 100);
+    EXPECT_LT(histogram.getPercentile(99), 100 + 100 / LatencyHistogram::kSubBuckets);
+    EXPECT_EQ(1000000, histogram.getMax());
+
+    histogram.reset();
+    EXPECT_EQ(0, histogram.getCount());
+    EXPECT_EQ(0, histogram.getMax());
+}
+
+TEST(LatencyHistogramTest, HandlesTheLargestValues) {
+    LatencyHistogram histogram;
+    histogram.record(UINT64_MAX);
+    EXPECT_EQ(UINT64_MAX, histogram.getPercentile(50));
+}
+
+TEST(LatencyProfileTest, GetReturnsTheSameHistogramByName) {
+    LatencyProfile profile;
+    LatencyHistogram* a = profile.get("a");
+    EXPECT_EQ(a, profile.get("a"));
+    EXPECT_NE(a, profile.get("b"));
+
+    a->record(2000);
+    std::string table = profile.toString();
+    EXPECT_NE(std::string::npos, table.find("a "));
+    EXPECT_NE(std::string::npos, table.find("2.0"));
+    EXPECT_LT(table.find("a "), table.find("b "));
+}
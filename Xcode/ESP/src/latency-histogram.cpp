@@ -0,0 +1,100 @@
+#include "latency-histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+uint32_t LatencyHistogram::getBucket(uint64_t nanos) {
+    if (nanos < 2 * kSubBuckets) { return nanos; }
+
+    // Keep the leading one and the kSubBucketBits bits after it: nanos >>
+    // shift is in [kSubBuckets, 2 * kSubBuckets).
+    const uint32_t shift = 63 - __builtin_clzll(nanos) - kSubBucketBits;
+    return shift * kSubBuckets + (nanos >> shift);
+}
+
+uint64_t LatencyHistogram::getBucketMax(uint32_t bucket) {
+    if (bucket < 2 * kSubBuckets) { return bucket; }
+    const uint32_t shift = bucket / kSubBuckets - 1;
+    const uint64_t top = bucket - shift * kSubBuckets;
+    return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t nanos, uint64_t count) {
+    buckets_[getBucket(nanos)].fetch_add(count, std::memory_order_relaxed);
+    count_.fetch_add(count, std::memory_order_relaxed);
+
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while (nanos > max &&
+           !max_.compare_exchange_weak(max, nanos, std::memory_order_relaxed)) {}
+}
+
+uint64_t LatencyHistogram::getPercentile(double percentile) const {
+    const uint64_t count = getCount();
+    if (count == 0) { return 0; }
+
+    const uint64_t rank = std::max<uint64_t>(
+        1, (uint64_t) std::ceil(count * std::min(percentile, 100.0) / 100));
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < kNumBuckets; i++) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) { return std::min(getBucketMax(i), getMax()); }
+    }
+    return getMax();
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : buckets_) { bucket.store(0, std::memory_order_relaxed); }
+    count_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+LatencyHistogram* LatencyProfile::get(const std::string& name) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (auto& histogram : histograms_) {
+        if (histogram.first == name) { return histogram.second.get(); }
+    }
+    histograms_.emplace_back(name, std::unique_ptr<LatencyHistogram>(new LatencyHistogram()));
+    return histograms_.back().second.get();
+}
+
+void LatencyProfile::reset() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (auto& histogram : histograms_) { histogram.second->reset(); }
+}
+
+std::string LatencyProfile::toString() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+
+    size_t width = 5;
+    for (const auto& histogram : histograms_) {
+        width = std::max(width, std::min<size_t>(histogram.first.size(), 128));
+    }
+
+    // Microseconds, to a tenth.
+    char line[256];
+    snprintf(line, sizeof(line), "%-*s %10s %10s %10s %10s\n",
+             (int) width, "stage", "samples", "p50 (us)", "p99 (us)", "max (us)");
+    std::string table = line;
+    for (const auto& histogram : histograms_) {
+        const LatencyHistogram& h = *histogram.second;
+        snprintf(line, sizeof(line), "%-*s %10llu %10.1f %10.1f %10.1f\n",
+                 (int) width, histogram.first.substr(0, 128).c_str(),
+                 (unsigned long long) h.getCount(), h.getPercentile(50) / 1e3,
+                 h.getPercentile(99) / 1e3, h.getMax() / 1e3);
+        table += line;
+    }
+    return table;
+}
+
+bool LatencyProfile::save(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file) { return false; }
+    file << toString();
+    return file.good();
+}
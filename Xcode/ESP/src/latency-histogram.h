@@ -0,0 +1,125 @@
+/** @file latency-histogram.h
+ *  @brief LatencyHistogram and LatencyProfile, which record how long each
+ *  stage of live processing takes per sample.
+ *
+ *  @verbatim
+ *  LatencyProfile profile;
+ *  LatencyHistogram* send = profile.get("OStream 1");
+ *  {
+ *      LatencyTimer timer(send);
+ *      ostream->onReceiveStamped(label, stamp);
+ *  }
+ *  ofLog() << profile.toString();  // p50, p99 and max of every stage
+ *  @endverbatim
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// @brief Nanoseconds since an arbitrary fixed point, from a clock that never
+/// goes backwards.
+inline uint64_t getMonotonicNanos() {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(
+        steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ @brief A histogram of durations in nanoseconds, in the style of
+ HdrHistogram. Each power of two is split into kSubBuckets buckets, so
+ percentiles are within 1 / kSubBuckets (about 6%) of the true value, in
+ fixed memory.
+
+ One thread can record into it while others read it; readers see each count
+ as of some recent moment, though not all of them at once.
+ */
+class LatencyHistogram {
+  public:
+    static const uint32_t kSubBucketBits = 4;
+    static const uint32_t kSubBuckets = 1 << kSubBucketBits;
+
+    LatencyHistogram();
+
+    /// @brief Adds `count` samples that each took `nanos`.
+    void record(uint64_t nanos, uint64_t count = 1);
+
+    uint64_t getCount() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t getMax() const { return max_.load(std::memory_order_relaxed); }
+
+    /// @brief The duration that `percentile` percent of samples took at most
+    /// (rounded up to its bucket), or 0 if there are none.
+    uint64_t getPercentile(double percentile) const;
+
+    void reset();
+
+  private:
+    static uint32_t getBucket(uint64_t nanos);
+    static uint64_t getBucketMax(uint32_t bucket);
+
+    // Values below 2 * kSubBuckets get a bucket each; above that, each power
+    // of two up to 2^63 gets kSubBuckets of them.
+    static const uint32_t kNumBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+    std::atomic<uint64_t> buckets_[kNumBuckets];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> max_;
+
+    // Disallow copy and assign
+    LatencyHistogram(LatencyHistogram&) = delete;
+    void operator=(LatencyHistogram) = delete;
+};
+
+/**
+ @brief Records how long a scope took into a histogram, if there is one.
+ With `count`, the time is shared between that many samples (e.g. for a call
+ that processed a block of them).
+ */
+class LatencyTimer {
+  public:
+    explicit LatencyTimer(LatencyHistogram* histogram, uint64_t count = 1)
+            : histogram_(histogram), count_(count),
+              start_(histogram != nullptr ? getMonotonicNanos() : 0) {}
+
+    ~LatencyTimer() {
+        if (histogram_ != nullptr && count_ > 0) {
+            histogram_->record((getMonotonicNanos() - start_) / count_, count_);
+        }
+    }
+
+  private:
+    LatencyHistogram* histogram_;
+    uint64_t count_;
+    uint64_t start_;
+};
+
+/**
+ @brief A set of named LatencyHistograms, one per stage, kept in the order
+ they were first asked for.
+ */
+class LatencyProfile {
+  public:
+    /// @brief The histogram called `name`, which is added if need be. It
+    /// lives as long as the profile.
+    LatencyHistogram* get(const std::string& name);
+
+    /// @brief Empties every histogram (but keeps them).
+    void reset();
+
+    /// @brief A table of the count, p50, p99 and max of every histogram.
+    std::string toString() const;
+
+    /// @brief Writes toString() to `filename`.
+    bool save(const std::string& filename) const;
+
+  private:
+    mutable std::mutex mutex_;
+    std::vector<std::pair<std::string, std::unique_ptr<LatencyHistogram>>> histograms_;
+};
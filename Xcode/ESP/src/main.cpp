@@ -1,8 +1,17 @@
 #include "ofMain.h"
+#include "ofAppNoWindow.h"
+#include "headless-app.h"
 #include "ofApp.h"
 
-int main() {
-    ofSetupOpenGL(1024, 768, OF_WINDOW);
+int main(int argc, char* argv[]) {
+    // `ESP --headless [session directory]` runs a saved session without a
+    // window (see HeadlessApp).
+    const bool is_headless = argc >= 2 && string(argv[1]) == "--headless";
+    if (is_headless) {
+        ofSetupOpenGL(std::make_shared<ofAppNoWindow>(), 1024, 768, OF_WINDOW);
+    } else {
+        ofSetupOpenGL(1024, 768, OF_WINDOW);
+    }
 
 #ifdef __APPLE__
     ofSetDataPathRoot("../Resources/data/");
@@ -10,6 +19,11 @@ int main() {
     ofSetDataPathRoot(".");
 #endif
 
+    if (is_headless) {
+        ofRunApp(new HeadlessApp(argc >= 3 ? argv[2] : "."));
+        return 0;
+    }
+
     ofxDatGui::setAssetPath("./");
 
     // this kicks off the running of my app
@@ -0,0 +1,140 @@
+#include "network-receiver.h"
+#include "gtest/gtest.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+
+#include "sample-stamp.h"
+
+static const uint32_t kSampleDim = 2;
+
+// Encode a frame of `num_samples` samples whose values are their sequence
+// numbers.
+static std::vector<unsigned char> makeFrame(uint32_t sender, uint64_t first,
+                                            uint32_t num_samples) {
+    NetworkFrameHeader header;
+    header.magic = NetworkFrameHeader::kMagic;
+    header.version = NetworkFrameHeader::kVersion;
+    header.num_dimensions = kSampleDim;
+    header.sender_id = sender;
+    header.num_samples = num_samples;
+    header.first_sequence = first;
+    header.device_time_us = SampleStamp::kNoDeviceTime;
+
+    std::vector<unsigned char> frame(sizeof(header));
+    memcpy(frame.data(), &header, sizeof(header));
+    for (uint32_t i = 0; i < num_samples; i++) {
+        for (uint32_t j = 0; j < kSampleDim; j++) {
+            double value = first + i;
+            const unsigned char* p = (const unsigned char*) &value;
+            frame.insert(frame.end(), p, p + sizeof(value));
+        }
+    }
+    return frame;
+}
+
+class NetworkReceiverTest : public ::testing::Test {
+  protected:
+    void start(NetworkReceiver::Protocol protocol) {
+        receiver.reset(new NetworkReceiver(
+            protocol, 0, kSampleDim, [this](GRT::MatrixDouble& data, int64_t) {
+                std::lock_guard<std::mutex> guard(mutex);
+                for (uint32_t i = 0; i < data.getNumRows(); i++) {
+                    received.push_back(data[i][1]);
+                }
+                received_cv.notify_all();
+            }));
+        ASSERT_TRUE(receiver->start()) << receiver->getError();
+
+        client = socket(AF_INET, protocol == NetworkReceiver::UDP ? SOCK_DGRAM : SOCK_STREAM, 0);
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(receiver->getPort());
+        ASSERT_EQ(0, connect(client, (struct sockaddr*) &address, sizeof(address)));
+    }
+
+    virtual void TearDown() {
+        if (client >= 0) { close(client); }
+        if (receiver != nullptr) { receiver->stop(); }
+    }
+
+    void send(const std::vector<unsigned char>& bytes) {
+        ASSERT_EQ((ssize_t) bytes.size(), ::send(client, bytes.data(), bytes.size(), 0));
+    }
+
+    // Wait until `count` values have been received.
+    bool waitFor(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return received_cv.wait_for(lock, std::chrono::seconds(2),
+                                    [&]() { return received.size() >= count; });
+    }
+
+    std::unique_ptr<NetworkReceiver> receiver;
+    int client = -1;
+    std::mutex mutex;
+    std::condition_variable received_cv;
+    std::vector<double> received;
+};
+
+TEST_F(NetworkReceiverTest, UdpDatagramCarriesABatch) {
+    start(NetworkReceiver::UDP);
+    send(makeFrame(1, 0, 5));
+    ASSERT_TRUE(waitFor(5));
+    for (uint32_t i = 0; i < 5; i++) { ASSERT_EQ(i, received[i]); }
+    ASSERT_EQ(1, receiver->getNumFrames());
+}
+
+TEST_F(NetworkReceiverTest, TracksSequencesPerSender) {
+    start(NetworkReceiver::UDP);
+    send(makeFrame(1, 0, 2));
+    send(makeFrame(2, 100, 2));
+    send(makeFrame(1, 5, 1));  // sender 1 lost 3 samples
+    send(makeFrame(1, 3, 1));  // late; dropped
+    send(makeFrame(1, 6, 1));
+    ASSERT_TRUE(waitFor(6));
+
+    ASSERT_EQ(3, receiver->getNumLostSamples());
+    std::vector<NetworkReceiver::SenderStats> stats = receiver->getSenderStats();
+    ASSERT_EQ(2, stats.size());
+    ASSERT_EQ(1, stats[0].sender_id);
+    ASSERT_EQ(3, stats[0].num_frames);
+    ASSERT_EQ(4, stats[0].num_samples);
+    ASSERT_EQ(3, stats[0].num_lost_samples);
+    ASSERT_EQ(1, stats[0].num_out_of_order_frames);
+    ASSERT_EQ(0, stats[1].num_lost_samples);
+}
+
+TEST_F(NetworkReceiverTest, RejectsMalformedDatagrams) {
+    start(NetworkReceiver::UDP);
+    std::vector<unsigned char> truncated = makeFrame(1, 0, 3);
+    truncated.resize(truncated.size() - 1);
+    send(truncated);
+    send(makeFrame(1, 0, 1));
+    ASSERT_TRUE(waitFor(1));
+    ASSERT_EQ(1, receiver->getNumMalformedFrames());
+    ASSERT_EQ(1, received.size());
+}
+
+TEST_F(NetworkReceiverTest, TcpFramesSplitAcrossWrites) {
+    start(NetworkReceiver::TCP);
+    std::vector<unsigned char> bytes = makeFrame(7, 0, 3);
+    std::vector<unsigned char> second = makeFrame(7, 3, 2);
+    bytes.insert(bytes.end(), second.begin(), second.end());
+
+    // Send in awkward pieces: mid-header, mid-value, across frames.
+    const size_t cuts[] = { 0, 10, 45, 90, bytes.size() };
+    for (int i = 0; i + 1 < 5; i++) {
+        send(std::vector<unsigned char>(bytes.begin() + cuts[i], bytes.begin() + cuts[i + 1]));
+    }
+    ASSERT_TRUE(waitFor(5));
+    for (uint32_t i = 0; i < 5; i++) { ASSERT_EQ(i, received[i]); }
+    ASSERT_EQ(0, receiver->getNumLostSamples());
+}
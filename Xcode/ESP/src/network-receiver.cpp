@@ -0,0 +1,230 @@
+#include "network-receiver.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+NetworkReceiver::NetworkReceiver(Protocol protocol, uint16_t port, uint32_t num_dimensions,
+                                 FrameCallback on_frame)
+        : protocol_(protocol), port_(port), num_dimensions_(num_dimensions),
+          on_frame_(on_frame), is_running_(false), num_frames_(0),
+          num_malformed_frames_(0), num_lost_samples_(0) {
+}
+
+NetworkReceiver::~NetworkReceiver() {
+    stop();
+}
+
+bool NetworkReceiver::start() {
+    if (thread_ != nullptr) { return true; }
+
+    socket_ = socket(AF_INET, protocol_ == UDP ? SOCK_DGRAM : SOCK_STREAM, 0);
+    if (socket_ < 0) {
+        error_ = std::string("can't create socket: ") + strerror(errno);
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port_);
+    socklen_t length = sizeof(address);
+    if (bind(socket_, (struct sockaddr*) &address, sizeof(address)) != 0 ||
+        (protocol_ == TCP && listen(socket_, 8) != 0) ||
+        getsockname(socket_, (struct sockaddr*) &address, &length) != 0 ||
+        pipe(wake_pipe_) != 0) {
+        error_ = "can't listen on port " + std::to_string(port_) + ": " + strerror(errno);
+        close(socket_);
+        socket_ = -1;
+        return false;
+    }
+    port_ = ntohs(address.sin_port);
+    fcntl(wake_pipe_[1], F_SETFL, O_NONBLOCK);
+
+    datagram_.resize(kMaxFrameBytes);
+    {
+        std::lock_guard<std::mutex> guard(senders_mutex_);
+        senders_.clear();
+    }
+
+    error_.clear();
+    is_running_ = true;
+    thread_.reset(new std::thread(&NetworkReceiver::run, this));
+    return true;
+}
+
+void NetworkReceiver::stop() {
+    if (thread_ == nullptr) { return; }
+
+    is_running_ = false;
+    wake();
+    if (thread_->joinable()) { thread_->join(); }
+    thread_.reset();
+
+    for (Connection& connection : connections_) { close(connection.fd); }
+    connections_.clear();
+    close(socket_);
+    close(wake_pipe_[0]);
+    close(wake_pipe_[1]);
+    socket_ = wake_pipe_[0] = wake_pipe_[1] = -1;
+}
+
+void NetworkReceiver::wake() {
+    unsigned char b = 0;
+    ssize_t ignored = write(wake_pipe_[1], &b, 1);
+    (void) ignored;
+}
+
+std::vector<NetworkReceiver::SenderStats> NetworkReceiver::getSenderStats() {
+    std::lock_guard<std::mutex> guard(senders_mutex_);
+    std::vector<SenderStats> stats;
+    for (const auto& sender : senders_) { stats.push_back(sender.second.stats); }
+    return stats;
+}
+
+void NetworkReceiver::run() {
+    std::vector<struct pollfd> fds;
+    while (is_running_) {
+        // The wake pipe, the socket, then one entry per TCP connection.
+        fds.clear();
+        fds.push_back({ wake_pipe_[0], POLLIN, 0 });
+        fds.push_back({ socket_, POLLIN, 0 });
+        for (const Connection& connection : connections_) {
+            fds.push_back({ connection.fd, POLLIN, 0 });
+        }
+
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) { continue; }
+            is_running_ = false;  // see isRunning()
+            return;
+        }
+        if (fds[0].revents != 0) { continue; }  // woken up to stop
+
+        if (fds[1].revents & POLLIN) {
+            if (protocol_ == TCP) {
+                acceptConnection();
+            } else {
+                ssize_t n = recv(socket_, datagram_.data(), datagram_.size(), 0);
+                if (n >= (ssize_t) sizeof(NetworkFrameHeader)) {
+                    decodeFrame(datagram_.data(), n);
+                } else if (n >= 0) {
+                    num_malformed_frames_++;
+                }
+            }
+        }
+
+        // Connections accepted above aren't in fds yet; only look at the
+        // ones that were polled, closing from the back so indices hold.
+        for (size_t i = fds.size() - 2; i-- > 0; ) {
+            if (fds[i + 2].revents == 0) { continue; }
+            if (!readConnection(connections_[i])) {
+                close(connections_[i].fd);
+                connections_.erase(connections_.begin() + i);
+            }
+        }
+    }
+}
+
+void NetworkReceiver::acceptConnection() {
+    int fd = accept(socket_, nullptr, nullptr);
+    if (fd < 0) { return; }
+
+    Connection connection;
+    connection.fd = fd;
+    connection.buffer.resize(kMaxFrameBytes);
+    connection.size = 0;
+    connections_.push_back(std::move(connection));
+}
+
+bool NetworkReceiver::readConnection(Connection& connection) {
+    ssize_t n = recv(connection.fd, connection.buffer.data() + connection.size,
+                     connection.buffer.size() - connection.size, 0);
+    if (n <= 0) { return n < 0 && errno == EINTR; }
+    connection.size += n;
+
+    // Decode every complete frame, then move the partial one to the front.
+    const unsigned char* data = connection.buffer.data();
+    uint32_t offset = 0;
+    while (connection.size - offset >= sizeof(NetworkFrameHeader)) {
+        NetworkFrameHeader header;
+        memcpy(&header, data + offset, sizeof(header));
+        const uint32_t frame_size = getFrameSize(header);
+        if (frame_size == 0) {
+            // No way to find the next frame on a stream; give up on it.
+            num_malformed_frames_++;
+            return false;
+        }
+        if (connection.size - offset < frame_size) { break; }
+        decodeFrame(data + offset, frame_size);
+        offset += frame_size;
+    }
+    memmove(connection.buffer.data(), data + offset, connection.size - offset);
+    connection.size -= offset;
+    return true;
+}
+
+uint32_t NetworkReceiver::getFrameSize(const NetworkFrameHeader& header) const {
+    if (header.magic != NetworkFrameHeader::kMagic ||
+        header.version != NetworkFrameHeader::kVersion ||
+        header.num_dimensions != num_dimensions_ || header.num_samples == 0) {
+        return 0;
+    }
+    const uint64_t size = sizeof(header) +
+        (uint64_t) header.num_samples * header.num_dimensions * sizeof(double);
+    return size <= kMaxFrameBytes ? size : 0;
+}
+
+bool NetworkReceiver::decodeFrame(const unsigned char* data, uint32_t size) {
+    NetworkFrameHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (getFrameSize(header) != size) {
+        num_malformed_frames_++;
+        return false;
+    }
+    num_frames_++;
+
+    {
+        std::lock_guard<std::mutex> guard(senders_mutex_);
+        auto inserted = senders_.insert(std::make_pair(header.sender_id, Sender()));
+        Sender& sender = inserted.first->second;
+        if (inserted.second) {
+            sender.stats = SenderStats();
+            sender.stats.sender_id = header.sender_id;
+        } else if (header.first_sequence > sender.next_sequence) {
+            const uint64_t lost = header.first_sequence - sender.next_sequence;
+            sender.stats.num_lost_samples += lost;
+            num_lost_samples_ += lost;
+        } else if (header.first_sequence < sender.next_sequence &&
+                   header.first_sequence != 0) {
+            // Duplicate or reordered. A sender starting again from 0 (e.g.
+            // after a restart) is taken as it is.
+            sender.stats.num_out_of_order_frames++;
+            return true;
+        }
+        sender.stats.num_frames++;
+        sender.stats.num_samples += header.num_samples;
+        sender.next_sequence = header.first_sequence + header.num_samples;
+    }
+
+    // Frames are little-endian, as is every platform ESP runs on, so the
+    // values are copied as they are.
+    if (block_.getNumRows() != header.num_samples || block_.getNumCols() != num_dimensions_) {
+        block_.resize(header.num_samples, num_dimensions_);
+    }
+    const unsigned char* values = data + sizeof(header);
+    const size_t row_bytes = num_dimensions_ * sizeof(double);
+    for (uint32_t i = 0; i < header.num_samples; i++) {
+        memcpy(block_[i], values + i * row_bytes, row_bytes);
+    }
+
+    on_frame_(block_, header.device_time_us);
+    return true;
+}
@@ -0,0 +1,159 @@
+/** @file network-receiver.h
+ *  @brief NetworkReceiver, which listens for binary sample frames over UDP
+ *  or TCP and decodes them. NetworkStream passes what it decodes on as
+ *  input; it's kept apart from the stream (and openFrameworks) so that it
+ *  can be tested over loopback.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GRT/GRT.h>
+
+/**
+ @brief Header of a NetworkStream frame. All fields are little-endian.
+
+ The header is followed by num_samples * num_dimensions little-endian 64-bit
+ doubles, one sample after the other. Over UDP each datagram holds exactly
+ one frame; over TCP frames follow each other on the connection.
+ */
+struct NetworkFrameHeader {
+    static const uint32_t kMagic = 0x4E505345;  // "ESPN"
+    static const uint16_t kVersion = 1;
+
+    uint32_t magic;
+    uint16_t version;
+    uint16_t num_dimensions;
+    uint32_t sender_id;       // identifies the sender's sequence numbers
+    uint32_t num_samples;
+    uint64_t first_sequence;  // sender's sequence number of the first sample
+    int64_t device_time_us;   // sender's time of the first sample, or
+                              // SampleStamp::kNoDeviceTime
+};
+static_assert(sizeof(NetworkFrameHeader) == 32, "NetworkFrameHeader must be packed");
+
+/**
+ @brief Receives NetworkFrameHeader frames on a thread of its own.
+
+ Frames are decoded straight from the receive buffer into a preallocated
+ block: no text is parsed and, as long as a sender keeps the same number of
+ samples per frame, nothing is allocated. The block is passed to the frame
+ callback, on the receiving thread.
+
+ Each sender numbers its samples. Frames that skip ahead count the skipped
+ samples as lost; frames that repeat or go back (e.g. reordered UDP
+ datagrams) are dropped so that samples stay in order.
+
+ It listens on all interfaces. Only POSIX platforms are supported.
+ */
+class NetworkReceiver {
+  public:
+    enum Protocol { UDP, TCP };
+
+    /// @brief Called with each frame's samples, one per row, and its
+    /// device time. The block may be changed in place.
+    typedef std::function<void(GRT::MatrixDouble& block, int64_t device_time_us)>
+        FrameCallback;
+
+    /**
+     @param protocol: UDP (one frame per datagram) or TCP (any number of
+     connections, each carrying a sequence of frames).
+     @param port: the port to listen on. 0 picks a free port; see getPort().
+     @param num_dimensions: the number of values per sample. Frames with a
+     different number are dropped.
+     */
+    NetworkReceiver(Protocol protocol, uint16_t port, uint32_t num_dimensions,
+                    FrameCallback on_frame);
+    ~NetworkReceiver();
+
+    /// @brief Starts listening. Returns false, with getError() saying why,
+    /// if the socket can't be set up.
+    bool start();
+    void stop();
+    /// @brief Whether it's listening: false once stopped, or if polling
+    /// the socket fails.
+    bool isRunning() const { return is_running_; }
+
+    /// @brief Why start() failed.
+    const std::string& getError() const { return error_; }
+
+    /// @brief The port being listened on, once started.
+    uint16_t getPort() const { return port_; }
+    uint32_t getNumDimensions() const { return num_dimensions_; }
+
+    struct SenderStats {
+        uint32_t sender_id;
+        uint64_t num_frames;
+        uint64_t num_samples;
+        uint64_t num_lost_samples;
+        uint64_t num_out_of_order_frames;
+    };
+    std::vector<SenderStats> getSenderStats();
+
+    uint64_t getNumFrames() const { return num_frames_.load(); }
+    uint64_t getNumMalformedFrames() const { return num_malformed_frames_.load(); }
+    uint64_t getNumLostSamples() const { return num_lost_samples_.load(); }
+
+  private:
+    // Largest frame accepted: a UDP datagram's maximum payload.
+    static const uint32_t kMaxFrameBytes = 65507;
+
+    struct Sender {
+        SenderStats stats;
+        uint64_t next_sequence;
+    };
+
+    struct Connection {
+        int fd;
+        std::vector<unsigned char> buffer;  // kMaxFrameBytes
+        uint32_t size;                      // bytes of a partial frame
+    };
+
+    void run();
+    void wake();
+    void acceptConnection();
+    // Read from a TCP connection and decode its complete frames. Returns
+    // false once the connection should be closed.
+    bool readConnection(Connection& connection);
+
+    // Decode the frame in data[0, size) (the first `size` bytes are known to
+    // hold at least a header). Returns false if it's malformed.
+    bool decodeFrame(const unsigned char* data, uint32_t size);
+    // Number of bytes in the frame starting with `header`, or 0 if the
+    // header is invalid.
+    uint32_t getFrameSize(const NetworkFrameHeader& header) const;
+
+    const Protocol protocol_;
+    uint16_t port_;
+    const uint32_t num_dimensions_;
+    const FrameCallback on_frame_;
+    std::string error_;
+
+    int socket_ = -1;
+    int wake_pipe_[2] = { -1, -1 };
+    std::atomic<bool> is_running_;
+    std::unique_ptr<std::thread> thread_;
+
+    std::vector<unsigned char> datagram_;  // kMaxFrameBytes, for UDP
+    std::vector<Connection> connections_;  // for TCP
+    GRT::MatrixDouble block_;
+
+    std::mutex senders_mutex_;
+    std::map<uint32_t, Sender> senders_;
+
+    std::atomic<uint64_t> num_frames_;
+    std::atomic<uint64_t> num_malformed_frames_;
+    std::atomic<uint64_t> num_lost_samples_;
+
+    // Disallow copy and assign
+    NetworkReceiver(NetworkReceiver&) = delete;
+    void operator=(NetworkReceiver) = delete;
+};
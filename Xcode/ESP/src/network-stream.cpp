@@ -0,0 +1,32 @@
+#include "network-stream.h"
+
+NetworkStream::NetworkStream(Protocol protocol, uint16_t port, uint32_t num_dimensions)
+        : receiver_(protocol, port, num_dimensions,
+                    [this](GRT::MatrixDouble& block, int64_t device_time_us) {
+                        normalizeAndEmit(block, device_time_us);
+                    }) {
+}
+
+NetworkStream::~NetworkStream() {
+    stop();
+}
+
+int NetworkStream::getNumInputDimensions() {
+    return receiver_.getNumDimensions();
+}
+
+bool NetworkStream::start() {
+    if (has_started_) { return true; }
+    if (!receiver_.start()) {
+        ofLog(OF_LOG_ERROR) << "NetworkStream: " << receiver_.getError();
+        return false;
+    }
+    has_started_ = true;
+    return true;
+}
+
+void NetworkStream::stop() {
+    if (!has_started_) { return; }
+    receiver_.stop();
+    has_started_ = false;
+}
@@ -0,0 +1,60 @@
+/** @file network-stream.h
+ *  @brief NetworkStream, an input stream that receives binary sample frames
+ *  over UDP or TCP.
+ *
+ *  @verbatim
+ *  NetworkStream stream(NetworkStream::UDP, 5005, 6);
+ *
+ *  void setup() {
+ *      useInputStream(stream);
+ *  }
+ *  @endverbatim
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "istream.h"
+#include "network-receiver.h"
+
+/**
+ @brief Input stream for sensor gateways that send samples over the network.
+
+ The frames (see NetworkFrameHeader) are received and decoded by a
+ NetworkReceiver; all samples of a frame are passed on together.
+ */
+class NetworkStream : public IStream {
+  public:
+    typedef NetworkReceiver::Protocol Protocol;
+    static const Protocol UDP = NetworkReceiver::UDP;
+    static const Protocol TCP = NetworkReceiver::TCP;
+    typedef NetworkReceiver::SenderStats SenderStats;
+
+    /**
+     Create a NetworkStream instance. See NetworkReceiver's constructor for
+     the parameters.
+     */
+    NetworkStream(Protocol protocol, uint16_t port, uint32_t num_dimensions);
+    ~NetworkStream();
+
+    virtual bool start() final;
+    virtual void stop() final;
+    virtual int getNumInputDimensions() final;
+
+    /// @brief The port being listened on, once started.
+    uint16_t getPort() const { return receiver_.getPort(); }
+
+    std::vector<SenderStats> getSenderStats() { return receiver_.getSenderStats(); }
+
+    uint64_t getNumFrames() const { return receiver_.getNumFrames(); }
+    uint64_t getNumMalformedFrames() const { return receiver_.getNumMalformedFrames(); }
+    uint64_t getNumLostSamples() const { return receiver_.getNumLostSamples(); }
+
+  private:
+    NetworkReceiver receiver_;
+
+    // Disallow copy and assign
+    NetworkStream(NetworkStream&) = delete;
+    void operator=(NetworkStream) = delete;
+};
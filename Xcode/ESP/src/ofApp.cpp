@@ -1,7 +1,9 @@
 #include "ofApp.h"
 
 #include <algorithm>
+#include <cmath>
 #include <math.h>
+#include <sstream>
 
 #include "user.h"
 
@@ -9,8 +11,16 @@
 // single output will be more visual.
 const uint32_t kTooManyFeaturesThreshold = 32;
 
-// This delay is needed so that UI can update to reflect the training status.
-const uint32_t kDelayBeforeTraining = 50;  // milliseconds
+// The input queue is sized to hold roughly kInputQueueBudget doubles, bounded
+// by the number of samples below. At 1 kHz, 65536 samples is about a minute of
+// slack before the stream thread has to wait for the GUI thread.
+const uint32_t kInputQueueBudget = 1 << 21;
+const uint32_t kMinInputQueueSamples = 1 << 10;
+const uint32_t kMaxInputQueueSamples = 1 << 16;
+
+// How long the processing thread waits for input before checking whether it
+// should stop.
+const uint32_t kProcessingIdleTimeoutMicros = 10 * 1000;
 
 // Instructions for each tab.
 static const char* kCalibrateInstruction =
@@ -19,19 +29,24 @@ static const char* kCalibrateInstruction =
         "Press `l` to load calibration data, `s` to save.";
 
 static const char* kPipelineInstruction =
-        "Press capital C/P/T/A to change tabs, `p` to pause or resume.\n";
+        "Press capital C/P/T/A to change tabs, `p` to pause or resume, "
+        "`h` to show stage latencies, `s` to save them and `e` to export "
+        "the slowest samples' traces.\n";
 
 static const char* kTrainingInstruction =
         "Press capital C/P/T/A to change tabs. "
         "`p` to pause or resume, 1-9 to record samples \n"
         "`r` to record test data, `f` to show features, `s` to save data"
-        "`l` to load training data, and `t` to train a model.";
+        "`l` to load training data, `t` to train a model, `v` or `k` to score "
+        "samples by leave-one-out or 10-fold cross-validation, `x` to cancel.";
 
 static const char* kAnalysisInstruction =
         "Press capital C/P/T/A to change tabs. \n"
         "Press `p` to pause or resume; hold `r` to record test data; "
         "press `s` to save test data and `l` to load test data.";
 
+const uint32_t kNumCrossValidationFolds = 10;
+
 const double kPipelineHeightWeight = 0.3;
 const ofColor kSerialSelectionColor = ofColor::fromHex(0x00FF00);
 
@@ -103,16 +118,25 @@ void ofApp::useTrainingDataAdvice(string advice) {
     training_data_advice_ = advice;
 }
 
+void ofApp::useCaptureLog(const string& directory, uint64_t max_bytes,
+                          uint64_t max_age_seconds) {
+    if (!setup_finished_) {
+        capture_log_.reset(new CaptureLog(directory, max_bytes, max_age_seconds));
+    }
+}
+
 // TODO(benzh): initialize other members as well.
 ofApp::ofApp() : fragment_(TRAINING),
                  num_pipeline_stages_(0),
                  calibrator_(nullptr),
+                 is_processing_(false),
+                 is_input_sequence_known_(false),
+                 num_missing_input_samples_(0),
                  training_data_manager_(kNumMaxLabels_),
                  should_save_calibration_data_(false),
                  should_save_pipeline_(false),
                  should_save_training_data_(false),
-                 should_save_test_data_(false),
-                 is_training_scheduled_(false) {
+                 should_save_test_data_(false) {
 }
 
 //--------------------------------------------------------------
@@ -145,7 +169,17 @@ void ofApp::setup() {
     if (training_data_advice_ == "")
         training_data_advice_ = getTrainingDataAdvice();
 
+    uint32_t num_input_dimensions = istream_->getNumOutputDimensions();
+    uint32_t queue_capacity = std::max(kMinInputQueueSamples,
+        std::min(kMaxInputQueueSamples, kInputQueueBudget / num_input_dimensions));
+    input_queue_.setup(num_input_dimensions, queue_capacity);
+    input_queue_.setOverflowPolicy(istream_->getOverloadPolicy(),
+                                   istream_->getOverloadFactor());
+    if (capture_log_ != nullptr && !capture_log_->open(num_input_dimensions)) {
+        capture_log_.reset();
+    }
     istream_->onDataReadyEvent(this, &ofApp::onDataIn);
+    setupDisplayQueue(num_input_dimensions);
     
     predicted_label_buffer_.resize(kBufferSize_);
     predicted_class_labels_buffer_.resize(kBufferSize_);
@@ -328,6 +362,9 @@ void ofApp::setup() {
     gui_.setPosition(ofGetWidth() - 300, 0);
     gui_.setWidth(280, 140);
 
+    is_processing_ = true;
+    processing_thread_ = std::thread(&ofApp::processInput, this);
+
     bool should_expand_gui = false;
     // Start input streaming.
     // If failed, this could be due to serial stream's port configuration.
@@ -392,39 +429,49 @@ void ofApp::onPlotRangeSelected(Plotter::CallbackArgs arg) {
 }
 
 void ofApp::populateSampleFeatures(uint32_t sample_index) {
-    if (pipeline_->getNumFeatureExtractionModules() == 0) { return; }
-
-    // Clean up historical data/caches.
-    pipeline_->reset();
-
     vector<Plotter>& feature_plots = plot_sample_features_[sample_index];
     for (Plotter& plot : feature_plots) { plot.clearData(); }
-
-    // 1. get samples
-    MatrixDouble& sample = plot_samples_[sample_index].getData();
+    if (plot_sample_indices_[sample_index] < 0) { return; }
+
+    // 1. get the sample's features, from the cache if they're there
+    const uint32_t label = sample_index + 1;
+    const uint32_t index = plot_sample_indices_[sample_index];
+    updateFeatureCache();
+    FeatureCache::Entry entry = feature_cache_.get(label, index);
+    unique_ptr<GestureRecognitionPipeline> pipeline;
+    {
+        std::lock_guard<std::mutex> guard(pipeline_mutex_);
+        if (pipeline_->getNumFeatureExtractionModules() == 0) { return; }
+        // Run a copy, so that live prediction neither waits for this nor
+        // has its modules' state disturbed by it.
+        if (entry == nullptr) { pipeline.reset(new GestureRecognitionPipeline(*pipeline_)); }
+    }
+    if (entry == nullptr) {
+        entry = SampleFeatures::compute(
+            *pipeline, training_data_manager_.getSample(label, index));
+        feature_cache_.put(front_end_key_, training_data_manager_.getVersion(),
+                           label, index, entry);
+    }
+
+    // 2. the rows to show
     uint32_t start = 0;
-    uint32_t end = sample.getNumRows();
+    uint32_t end = entry->is_valid.size();
     if (is_final_features_too_many_) {
         pair<uint32_t, uint32_t> sel = plot_samples_[sample_index].getSelection();
         if (sel.second - sel.first > 10) {
-            start = sel.first;
-            end = sel.second;
+            start = std::min(sel.first, end);
+            end = std::min(sel.second, end);
         }
     }
 
-    // 2. get features by flowing samples through
     for (uint32_t i = start; i < end; i++) {
-        vector<double> data_point = sample.getRowVector(i);
-        if (!pipeline_->preProcessData(data_point)) {
+        if (!entry->is_valid[i]) {
             ofLog(OF_LOG_ERROR) << "ERROR: Failed to compute features!";
             continue;
         }
+        vector<double> feature = entry->outputs.getRowVector(i);
 
-        // Last stage of feature extraction.
-        uint32_t j = pipeline_->getNumFeatureExtractionModules();
-        vector<double> feature = pipeline_->getFeatureExtractionData(j - 1);
-
-        for (uint32_t k = 0; k < feature_plots.size(); k++) {
+        for (uint32_t k = 0; k < feature_plots.size() && k < feature.size(); k++) {
             vector<double> feature_point = { feature[k] };
             feature_plots[k].push_back(feature_point);
 
@@ -450,6 +497,15 @@ void ofApp::populateSampleFeatures(uint32_t sample_index) {
     }
 }
 
+void ofApp::updateFeatureCache() {
+    if (is_front_end_key_stale_) {
+        std::lock_guard<std::mutex> guard(pipeline_mutex_);
+        front_end_key_ = FeatureCache::computeKey(*pipeline_);
+        is_front_end_key_stale_ = false;
+    }
+    feature_cache_.update(training_data_manager_, front_end_key_);
+}
+
 void ofApp::onInputPlotRangeSelection(InteractiveTimeSeriesPlot::RangeCallbackArgs arg) {
     if (!enable_history_recording_) {
         plot_inputs_.clearSelection();
@@ -463,7 +519,8 @@ void ofApp::onInputPlotRangeSelection(InteractiveTimeSeriesPlot::RangeCallbackAr
 }
 
 void ofApp::onInputPlotValueSelection(InteractiveTimeSeriesPlot::ValueCallbackArgs arg) {
-    if (enable_history_recording_) {
+    // Predictions are only buffered for the live window.
+    if (enable_history_recording_ && !is_showing_captured_history_) {
         int i = plot_inputs_.getSelectedIndex();
         predicted_label_ = predicted_label_buffer_[i];
         predicted_class_distances_ = predicted_class_distances_buffer_[i];
@@ -472,6 +529,29 @@ void ofApp::onInputPlotValueSelection(InteractiveTimeSeriesPlot::ValueCallbackAr
     }
 }
 
+void ofApp::showCapturedHistory(uint64_t offset) {
+    // The capture log may only be read from the thread appending to it,
+    // which is the processing thread unless it's kept out.
+    std::lock_guard<std::mutex> guard(pipeline_mutex_);
+    GRT::MatrixDouble history;
+    if (capture_log_->readRecent(offset, kBufferSize_, history) == 0) { return; }
+
+    captured_history_offset_ = offset;
+    is_showing_captured_history_ = true;
+    plot_inputs_.reset();
+    plot_inputs_.clearSelection();
+    for (uint32_t i = 0; i < history.getNumRows(); i++) {
+        vector<double> data_point = history.getRowVector(i);
+        if (calibrator_ != nullptr && calibrator_->isCalibrated()) {
+            data_point = calibrator_->calibrate(data_point);
+        }
+        plot_inputs_.update(data_point);
+    }
+
+    status_text_ = "Showing recorded input from " +
+        std::to_string(offset) + " samples ago. Press [ and ] to scroll.";
+}
+
 void ofApp::onTestOverviewPlotSelection(Plotter::CallbackArgs arg) {
     updateTestWindowPlot();
 }
@@ -501,18 +581,15 @@ void ofApp::updateTestWindowPlot() {
 }
 
 void ofApp::runPredictionOnTestData() {
-    test_data_predicted_class_labels_.resize(test_data_.getNumRows());
-    for (int i = 0; i < test_data_.getNumRows(); i++) {
-        if (pipeline_->getTrained()) {
-            pipeline_->predict(test_data_.getRowVector(i));
-
-            int predicted_label = pipeline_->getPredictedClassLabel();
+    // Predict with a copy, so that live prediction goes on meanwhile and
+    // doesn't carry on from the end of the test data.
+    std::unique_lock<std::mutex> lock(pipeline_mutex_);
+    GestureRecognitionPipeline pipeline(*pipeline_);
+    lock.unlock();
 
-            test_data_predicted_class_labels_[i] = predicted_label;
-        } else {
-            test_data_predicted_class_labels_[i] = 0;
-        }
-    }
+    // Labels are all 0 if the pipeline isn't trained.
+    predictBlock(pipeline, test_data_, &prediction_);
+    test_data_predicted_class_labels_ = prediction_.labels;
 }
 
 bool ofApp::savePipelineWithPrompt() {
@@ -523,7 +600,11 @@ bool ofApp::savePipelineWithPrompt() {
 }
 
 bool ofApp::savePipeline(const string& filename) {
-    if (pipeline_->save(filename)) {
+    std::unique_lock<std::mutex> lock(pipeline_mutex_);
+    bool saved = pipeline_->save(filename);
+    lock.unlock();
+
+    if (saved) {
         setStatus("Pipeline is saved to " + filename);
         should_save_pipeline_ = false;
         return true;
@@ -541,7 +622,21 @@ bool ofApp::loadPipelineWithPrompt() {
 }
 
 bool ofApp::loadPipeline(const string& filename) {
-    if (pipeline_->load(filename)) {
+    // A model still training was copied from the pipeline being replaced.
+    trainer_.cancel();
+    trainer_.invalidate();
+    is_front_end_key_stale_ = true;
+
+    std::unique_lock<std::mutex> lock(pipeline_mutex_);
+    bool loaded = pipeline_->load(filename);
+    unique_ptr<GestureRecognitionPipeline> model;
+    if (loaded && pipeline_->getTrained()) {
+        model.reset(new GestureRecognitionPipeline(*pipeline_));
+    }
+    lock.unlock();
+    sample_scorer_.setModel(std::move(model));
+
+    if (loaded) {
         setStatus("Pipeline is loaded from " + filename);
         should_save_pipeline_ = false;
         return true;
@@ -589,44 +684,19 @@ bool ofApp::loadCalibrationDataWithPrompt() {
 }
 
 bool ofApp::loadCalibrationData(const string& filename) {
-    vector<CalibrateProcess>& calibrators = calibrator_->getCalibrateProcesses();
-    GRT::TimeSeriesClassificationData data;
-
-    if (data.load(filename)) {
-        setStatus("Calibration data is loaded from " + filename);
-    } else {
-        setStatus("Failed to load calibration data from " + filename);
-        return false;
-    }
+    std::unique_lock<std::mutex> lock(pipeline_mutex_);
+    CalibrateResult result =
+        calibrator_->load(filename, istream_->getNumOutputDimensions());
+    lock.unlock();
 
-    if (data.getNumSamples() != calibrators.size()) {
-        setStatus("Number of samples in file differs from the "
-                  "number of calibration samples.");
-        return false;
-    }
-
-    if (data.getNumDimensions() != istream_->getNumOutputDimensions()) {
-        setStatus("Number of dimensions of data in file differs "
-                  "from the number of dimensions expected.");
-        return false;
-    }
+    setStatus(result.getMessage());
+    if (result.getResult() == CalibrateResult::FAILURE) { return false; }
 
-    for (int i = 0; i < data.getNumSamples(); i++) {
-        if (data.getClassNameForCorrespondingClassLabel(i) != calibrators[i].getName()) {
-            ofLog(OF_LOG_WARNING) << "Name of saved calibration sample " << (i + 1) << " ('"
-                                  << data.getClassNameForCorrespondingClassLabel(i)
-                                  << "') differs from current calibration sample name ('"
-                                  << calibrators[i].getName() << "')";
-        }
-        calibrators[i].clear();
+    vector<CalibrateProcess>& calibrators = calibrator_->getCalibrateProcesses();
+    for (int i = 0; i < calibrators.size(); i++) {
         plot_calibrators_[i].reset();
-        if (calibrators[i].calibrate(data[i].getData()).getResult() ==
-            CalibrateResult::FAILURE) {
-            ofLog(OF_LOG_WARNING) << "Failed to calibrate saved "
-                                  << "calibration sample " << (i + 1) << ": "
-                                  << calibrators[i].getName();
-        } else {
-            plot_calibrators_[i].setData(data[i].getData());
+        if (calibrators[i].isCalibrated()) {
+            plot_calibrators_[i].setData(calibrators[i].getData());
         }
     }
 
@@ -979,15 +1049,48 @@ string ofApp::getTrainingDataAdvice() {
 
 //--------------------------------------------------------------
 void ofApp::update() {
-    std::lock_guard<std::mutex> guard(input_data_mutex_);
-    for (int i = 0; i < input_data_.getNumRows(); i++){
-        vector<double> raw_data = input_data_.getRowVector(i);
+    display_queue_.drain(display_data_);
+    // Rows the GUI fell behind on are only missing from the plots: samples
+    // are recorded by the processing thread.
+    if (display_queue_.getNumDropped() != last_reported_display_drops_) {
+        ofLog(OF_LOG_NOTICE) << display_queue_.getNumDropped() - last_reported_display_drops_
+                             << " samples not plotted; the display fell behind ("
+                             << display_queue_.getNumDropped() << " in total)";
+        last_reported_display_drops_ = display_queue_.getNumDropped();
+    }
+    if (input_queue_.getNumOverflows() != last_reported_overflows_) {
+        last_reported_overflows_ = input_queue_.getNumOverflows();
+        ofLog(OF_LOG_WARNING) << "Input queue full " << last_reported_overflows_
+                              << " times (" << input_queue_.getNumDropped()
+                              << " samples dropped, high water mark "
+                              << input_queue_.getHighWaterMark() << " of "
+                              << input_queue_.getCapacity() << ")";
+    }
+    static const char* const kPolicyNames[SampleQueue::kNumOverflowPolicies] = {
+        "blocked", "dropped (oldest)", "dropped (newest)", "decimated", "coalesced"
+    };
+    for (int p = 0; p < SampleQueue::kNumOverflowPolicies; p++) {
+        SampleQueue::OverflowPolicy policy = (SampleQueue::OverflowPolicy) p;
+        uint64_t discarded = input_queue_.getNumDiscarded(policy);
+        if (discarded != last_reported_discarded_[p]) {
+            ofLog(OF_LOG_NOTICE) << discarded - last_reported_discarded_[p]
+                                 << " input samples " << kPolicyNames[p]
+                                 << " (" << discarded << " in total)";
+            last_reported_discarded_[p] = discarded;
+        }
+    }
+
+    const DisplayLayout& layout = display_layout_;
+    const uint32_t num_dimensions = layout.input;
+    for (int i = 0; i < display_data_.getNumRows(); i++){
+        const double* row = display_data_[i];
+        const uint32_t flags = (uint32_t) row[layout.flags];
+
+        vector<double> raw_data(row, row + num_dimensions);
         vector<double> data_point;
         plot_raw_.update(raw_data);
-        if (calibrator_ == nullptr) {
-            data_point = raw_data;
-        } else if (calibrator_->isCalibrated()) {
-            data_point = calibrator_->calibrate(raw_data);
+        if (flags & kHasInput) {
+            data_point.assign(row + layout.input, row + layout.input + num_dimensions);
         } else {
             // Not calibrated! For now, force the tab to be CALIBRATION.
             fragment_ = CALIBRATION;
@@ -995,62 +1098,43 @@ void ofApp::update() {
 
         std::string title;
 
-        if (pipeline_->getTrained()) {
-            pipeline_->predict(data_point);
-            
-            predicted_label_ = pipeline_->getPredictedClassLabel();
+        if (flags & kHasPrediction) {
+            predicted_label_ = (int) row[layout.label];
             predicted_label_buffer_.push_back(predicted_label_);
-            
-            predicted_class_labels_ = pipeline_->getClassLabels();
-            predicted_class_labels_buffer_.push_back(predicted_class_labels_);
 
-            predicted_class_distances_ = pipeline_->getClassDistances();
-            // TODO(damellis): this shouldn't be classifier-specific but should
-            // instead be based on a virtual function in Classifier or similar.
-            DTW *dtw = dynamic_cast<DTW *>(pipeline_->getClassifier());
-            if (dtw != NULL) {
-                for (int k = 0; k < predicted_class_distances_.size() &&
-                                k < predicted_class_labels_.size(); k++) {
-                    predicted_class_distances_[k] =
-                        dtw->classDistanceToNullRejectionCoefficient(
-                            predicted_class_labels_[k],
-                            predicted_class_distances_[k]);
-                }
+            predicted_class_labels_.clear();
+            predicted_class_distances_.clear();
+            predicted_class_likelihoods_.clear();
+            for (uint32_t k = 0; k < kNumMaxLabels_; k++) {
+                if (std::isnan(row[layout.likelihoods + k])) { continue; }
+                predicted_class_labels_.push_back(k + 1);
+                predicted_class_distances_.push_back(row[layout.distances + k]);
+                predicted_class_likelihoods_.push_back(row[layout.likelihoods + k]);
             }
+            predicted_class_labels_buffer_.push_back(predicted_class_labels_);
             predicted_class_distances_buffer_.push_back(predicted_class_distances_);
-            
-            predicted_class_likelihoods_ = pipeline_->getClassLikelihoods();
             predicted_class_likelihoods_buffer_.push_back(predicted_class_likelihoods_);
-            
-            if (predicted_label_ != 0) {
-                for (OStream *ostream : ostreams_)
-                    ostream->onReceive(predicted_label_);
-                for (OStream *ostream : ostreamvectors_)
-                    ostream->onReceive(predicted_label_);
 
+            if (predicted_label_ != 0) {
                 title = training_data_manager_.getLabelName(predicted_label_);
             }
         }
 
         plot_inputs_.update(data_point, predicted_label_ != 0, title);
-        if (istream_->getNumOutputDimensions() >= kTooManyFeaturesThreshold)
+        if (num_dimensions >= kTooManyFeaturesThreshold)
             plot_inputs_snapshot_.setData(data_point);
 
-        if (istream_->hasStarted()) {
-            if (!pipeline_->preProcessData(data_point)) {
-                ofLog(OF_LOG_ERROR) << "ERROR: Failed to compute features!";
-            }
-
-            vector<double> data = data_point;
-
-            for (int j = 0; j < pipeline_->getNumPreProcessingModules(); j++) {
-                data = pipeline_->getPreProcessedData(j);
+        if (flags & kHasStages) {
+            for (int j = 0; j + 1 < layout.pre_processed.size(); j++) {
+                vector<double> data(row + layout.pre_processed[j],
+                                    row + layout.pre_processed[j + 1]);
                 plot_pre_processed_[j].update(data);
             }
 
-            for (int j = 0; j < pipeline_->getNumFeatureExtractionModules(); j++) {
+            for (int j = 0; j + 1 < layout.features.size(); j++) {
                 // Working on j-th stage.
-                data = pipeline_->getFeatureExtractionData(j);
+                vector<double> data(row + layout.features[j],
+                                    row + layout.features[j + 1]);
                 if (data.size() < kTooManyFeaturesThreshold) {
                     for (int k = 0; k < data.size(); k++) {
                         vector<double> v = { data[k] };
@@ -1061,32 +1145,248 @@ void ofApp::update() {
                     plot_features_[j][0].setData(data);
                 }
             }
+        }
+    }
+
+    // Gaps left by the overload policy are expected and reported above;
+    // only the rest were lost before reaching the queue.
+    const uint64_t discarded = input_queue_.getNumDropped();
+    const uint64_t missing = num_missing_input_samples_;
+    const uint64_t lost = missing > discarded ? missing - discarded : 0;
+    if (lost > last_reported_missing_) {
+        ofLog(OF_LOG_WARNING) << "Lost "
+                              << lost - last_reported_missing_
+                              << " input samples (" << lost
+                              << " in total)";
+        last_reported_missing_ = lost;
+    }
+
+    if (trainer_.isBusy()) { finishTraining(); }
+    if (cross_validator_.isBusy()) { finishCrossValidation(); }
+    updateSampleScores();
+
+    // After the training progress, so that GRT's errors aren't hidden by it.
+    std::lock_guard<std::mutex> guard(notify_mutex_);
+    if (!notify_text_.empty()) {
+        status_text_ = notify_text_;
+        notify_text_.clear();
+    }
+}
+
+void ofApp::setupDisplayQueue(uint32_t num_input_dimensions) {
+    DisplayLayout& layout = display_layout_;
+    uint32_t offset = 2 * num_input_dimensions;
+    layout.input = num_input_dimensions;
+
+    layout.pre_processed.assign(1, offset);
+    for (int i = 0; i < pipeline_->getNumPreProcessingModules(); i++) {
+        offset += pipeline_->getPreProcessingModule(i)->getNumOutputDimensions();
+        layout.pre_processed.push_back(offset);
+    }
+    layout.features.assign(1, offset);
+    for (int i = 0; i < pipeline_->getNumFeatureExtractionModules(); i++) {
+        offset += pipeline_->getFeatureExtractionModule(i)->getNumOutputDimensions();
+        layout.features.push_back(offset);
+    }
+    layout.flags = offset;
+    layout.label = offset + 1;
+    layout.distances = layout.label + 1;
+    layout.likelihoods = layout.distances + kNumMaxLabels_;
+    layout.width = layout.likelihoods + kNumMaxLabels_;
+
+    // The processing thread never waits for the GUI: if update() falls
+    // behind (e.g. while a file dialog is open), it skips the oldest rows.
+    uint32_t capacity = std::max(kMinInputQueueSamples,
+        std::min(kMaxInputQueueSamples, kInputQueueBudget / layout.width));
+    display_queue_.setup(layout.width, capacity);
+    display_queue_.setOverflowPolicy(SampleQueue::DROP_OLDEST);
+    display_row_.assign(layout.width, 0.0);
+}
+
+// Copy as much of `data` as fits into [begin, end), zero-filling the rest in
+// case a module's output is narrower than when the display layout was set up.
+static void copyStageOutput(const MatrixDouble& stage, uint32_t i,
+                            double* begin, double* end) {
+    const size_t n = std::min<size_t>(stage.getNumCols(), end - begin);
+    if (n > 0) { std::copy(stage[i], stage[i] + n, begin); }
+    std::fill(begin + n, end, 0.0);
+}
+
+void ofApp::processInput() {
+    while (is_processing_) {
+        if (!input_queue_.waitForData(kProcessingIdleTimeoutMicros)) { continue; }
+
+        std::lock_guard<std::mutex> guard(pipeline_mutex_);
+        input_queue_.drain(input_data_, input_stamps_);
+        input_dequeued_us_ = getMonotonicMicros();
+        if (capture_log_ != nullptr) {
+            capture_log_->append(input_data_, input_stamps_);
+        }
+        processSamples();
+    }
+}
+
+void ofApp::processSamples() {
+    const DisplayLayout& layout = display_layout_;
+    const uint32_t num_dimensions = input_data_.getNumCols();
+    double* row = display_row_.data();
+
+    // Calibrate everything that arrived at once, rather than sample by sample
+    // below.
+    const bool is_calibrated = calibrator_ == nullptr || calibrator_->isCalibrated();
+    if (calibrator_ != nullptr && is_calibrated) {
+        calibrated_data_ = input_data_;
+        LatencyTimer timer(calibrator_latency_, calibrated_data_.getNumRows());
+        calibrator_->calibrate(calibrated_data_);
+    }
+    const GRT::MatrixDouble& inputs =
+        (calibrator_ != nullptr) ? calibrated_data_ : input_data_;
+
+    // predictBlock() runs each sample through every stage, so the stages'
+    // outputs are there to show whether or not the pipeline is trained.
+    BlockPrediction& prediction = live_prediction_;
+    if (is_calibrated) {
+        predictBlock(*pipeline_, inputs, &prediction, kKeepStageOutputs);
+    }
+    const uint64_t predicted_us = getMonotonicMicros();
+    const vector<UINT>& class_labels = prediction.class_labels;
+
+    // TODO(damellis): this shouldn't be classifier-specific but should
+    // instead be based on a virtual function in Classifier or similar.
+    DTW *dtw = dynamic_cast<DTW *>(pipeline_->getClassifier());
+    if (dtw != NULL && is_calibrated) {
+        for (uint32_t i = 0; i < prediction.distances.getNumRows(); i++) {
+            for (int k = 0; k < class_labels.size(); k++) {
+                prediction.distances[i][k] = dtw->classDistanceToNullRejectionCoefficient(
+                    class_labels[k], prediction.distances[i][k]);
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < input_data_.getNumRows(); i++) {
+        const SampleStamp& stamp = input_stamps_[i];
+        if (is_input_sequence_known_ && stamp.sequence > next_input_sequence_) {
+            num_missing_input_samples_ += stamp.sequence - next_input_sequence_;
+        }
+        is_input_sequence_known_ = true;
+        next_input_sequence_ = stamp.sequence + 1;
+        latest_input_stamp_ = stamp;
+
+        if (is_recording_) {
+            const bool is_raw = is_recording_raw_ || !is_calibrated;
+            sample_data_.push_back((is_raw ? input_data_ : inputs).getRowVector(i));
+        }
+
+        std::copy(input_data_[i], input_data_[i] + num_dimensions, row);
+        uint32_t flags = 0;
+        if (!is_calibrated) {
+            row[layout.flags] = flags;
+            display_queue_.push(row, stamp);
+            continue;
+        }
+        flags |= kHasInput;
+        std::copy(inputs[i], inputs[i] + num_dimensions, row + layout.input);
+
+        const bool has_stages = prediction.is_valid[i];
+        if (!has_stages) {
+            ofLog(OF_LOG_ERROR) << "ERROR: Failed to compute features!";
+        } else if (prediction_latency_ != nullptr) {
+            prediction_latency_->record((predicted_us - stamp.getArrivalTime()) * 1000);
+        }
+
+        if (has_stages && pipeline_->getTrained()) {
+            flags |= kHasPrediction;
+            int label = prediction.labels[i];
+
+            row[layout.label] = label;
+            std::fill(row + layout.distances, row + layout.width, NAN);
+            for (int k = 0; k < class_labels.size(); k++) {
+                if (class_labels[k] < 1 || class_labels[k] > kNumMaxLabels_) { continue; }
+                const uint32_t slot = class_labels[k] - 1;
+                row[layout.distances + slot] = prediction.distances[i][k];
+                row[layout.likelihoods + slot] = prediction.likelihoods[i][k];
+            }
+
+            if (label != 0) {
+                for (int k = 0; k < ostreams_.size(); k++) {
+                    LatencyTimer timer(k < ostream_latencies_.size() ?
+                                       ostream_latencies_[k] : nullptr);
+                    ostreams_[k]->onReceiveStamped(label, stamp);
+                }
+                for (int k = 0; k < ostreamvectors_.size(); k++) {
+                    LatencyTimer timer(k < ostreamvector_latencies_.size() ?
+                                       ostreamvector_latencies_[k] : nullptr);
+                    ostreamvectors_[k]->onReceiveStamped(label, stamp);
+                }
+
+                if (output_latency_ != nullptr &&
+                    (!ostreams_.empty() || !ostreamvectors_.empty())) {
+                    SampleTrace trace;
+                    trace.sequence = stamp.sequence;
+                    trace.label = label;
+                    trace.arrival_us = stamp.getArrivalTime();
+                    trace.emitted_us = stamp.host_time_us;
+                    trace.dequeued_us = input_dequeued_us_;
+                    trace.predicted_us = predicted_us;
+                    trace.output_us = getMonotonicMicros();
+                    output_latency_->record(trace.getDuration() * 1000);
+                    sample_tracer_.add(trace);
+                }
+            }
+        }
+
+        if (has_stages) {
+            flags |= kHasStages;
+            // The output of the last stage, for OStreamVectors below.
+            const MatrixDouble* last_stage = nullptr;
+
+            for (int j = 0; j + 1 < layout.pre_processed.size() &&
+                            j < prediction.pre_processed.size(); j++) {
+                last_stage = &prediction.pre_processed[j];
+                copyStageOutput(*last_stage, i, row + layout.pre_processed[j],
+                                row + layout.pre_processed[j + 1]);
+            }
+
+            for (int j = 0; j + 1 < layout.features.size() &&
+                            j < prediction.features.size(); j++) {
+                last_stage = &prediction.features[j];
+                copyStageOutput(*last_stage, i, row + layout.features[j],
+                                row + layout.features[j + 1]);
+            }
 
             // If there's no classifier set, we've got a signal processing
             // pipeline and we should send the results of the pipeline to
             // any OStreamVector instances that are listening for it.
             // TODO(damellis): this logic will need updating when / if we
             // support regression and clustering pipelines.
-            if (!pipeline_->getIsClassifierSet()) {
-                for (OStreamVector *stream : ostreamvectors_) {
-                    stream->onReceive(data);
+            if (!pipeline_->getIsClassifierSet() && !ostreamvectors_.empty()) {
+                vector<double> output = inputs.getRowVector(i);
+                if (last_stage != nullptr && last_stage->getNumCols() > 0) {
+                    output = last_stage->getRowVector(i);
+                }
+                for (int k = 0; k < ostreamvectors_.size(); k++) {
+                    LatencyTimer timer(k < ostreamvector_latencies_.size() ?
+                                       ostreamvector_latencies_[k] : nullptr);
+                    ostreamvectors_[k]->onReceiveStamped(output, stamp);
                 }
             }
         }
 
-        if (is_recording_) {
-            if (fragment_ == CALIBRATION) {
-                sample_data_.push_back(raw_data);
-            } else {
-                sample_data_.push_back(data_point);
-            }
-        }
+        row[layout.flags] = flags;
+        display_queue_.push(row, stamp);
     }
+}
 
-    if (is_training_scheduled_ == true &&
-        (ofGetElapsedTimeMillis() - schedule_time_ > kDelayBeforeTraining)) {
-        trainModel();
-    }
+void ofApp::startRecording() {
+    std::lock_guard<std::mutex> guard(pipeline_mutex_);
+    sample_data_.clear();
+    is_recording_raw_ = fragment_ == CALIBRATION;
+    is_recording_ = true;
+}
+
+void ofApp::stopRecording() {
+    std::lock_guard<std::mutex> guard(pipeline_mutex_);
+    is_recording_ = false;
 }
 
 void ofDrawColoredBitmapString(ofColor color,
@@ -1250,6 +1550,84 @@ void ofApp::drawLivePipeline() {
         ofPopStyle();
         stage_top += margin;
     }
+
+    if (is_showing_latency_) { drawLatency(); }
+}
+
+void ofApp::toggleLatencyTiming() {
+    std::lock_guard<std::mutex> guard(pipeline_mutex_);
+    is_showing_latency_ = !is_showing_latency_;
+    ostream_latencies_.clear();
+    ostreamvector_latencies_.clear();
+    if (!is_showing_latency_) {
+        istream_->setNormalizerLatency(nullptr);
+        calibrator_latency_ = nullptr;
+        live_prediction_.latency = nullptr;
+        prediction_latency_ = nullptr;
+        output_latency_ = nullptr;
+        return;
+    }
+
+    // Start afresh, as the pipeline may have changed since last time.
+    latency_profile_.reset();
+    sample_tracer_.reset();
+    prediction_latency_ = latency_profile_.get("arrival to prediction");
+    output_latency_ = latency_profile_.get("arrival to output");
+    istream_->setNormalizerLatency(latency_profile_.get("normalizer"));
+    if (calibrator_ != nullptr) {
+        calibrator_latency_ = latency_profile_.get("calibrator");
+    }
+    live_prediction_.latency = &latency_profile_;
+    for (int k = 0; k < ostreams_.size(); k++) {
+        ostream_latencies_.push_back(
+            latency_profile_.get("OStream " + std::to_string(k + 1)));
+    }
+    for (int k = 0; k < ostreamvectors_.size(); k++) {
+        ostreamvector_latencies_.push_back(
+            latency_profile_.get("OStreamVector " + std::to_string(k + 1)));
+    }
+}
+
+void ofApp::drawLatency() {
+    const string table = latency_profile_.toString();
+
+    // The bitmap font is 8 pixels wide; right-align the table.
+    size_t width = 0;
+    std::istringstream lines(table);
+    for (string line; std::getline(lines, line); ) {
+        width = std::max(width, line.size());
+    }
+    const uint32_t margin = 20;
+    ofDrawBitmapStringHighlight(table, ofGetWidth() - 8 * width - margin, 70,
+                                ofColor(0, 0, 0, 200), ofColor(255));
+}
+
+bool ofApp::exportSampleTracesWithPrompt() {
+    ofFileDialogResult result = ofSystemSaveDialog(
+        "LatencyTrace.json", "Export the slowest samples' traces?");
+    if (!result.bSuccess) { return false; }
+
+    if (sample_tracer_.saveChromeTrace(result.getPath())) {
+        setStatus("Traces of the slowest samples are exported to " + result.getPath());
+        return true;
+    } else {
+        setStatus("Failed to export traces to " + result.getPath());
+        return false;
+    }
+}
+
+bool ofApp::saveLatencyWithPrompt() {
+    ofFileDialogResult result = ofSystemSaveDialog(
+        "Latency.txt", "Save stage latencies?");
+    if (!result.bSuccess) { return false; }
+
+    if (latency_profile_.save(result.getPath())) {
+        setStatus("Stage latencies are saved to " + result.getPath());
+        return true;
+    } else {
+        setStatus("Failed to save stage latencies to " + result.getPath());
+        return false;
+    }
 }
 
 void ofApp::drawTrainingInfo() {
@@ -1424,10 +1802,18 @@ void ofApp::drawAnalysis() {
 }
 
 void ofApp::exit() {
-    if (training_thread_.joinable()) {
-        training_thread_.join();
+    trainer_.cancel();
+    trainer_.wait();
+    cross_validator_.cancel();
+    cross_validator_.wait();
+    // A producer blocked on a full queue would otherwise never return.
+    input_queue_.close();
+    is_processing_ = false;
+    if (processing_thread_.joinable()) {
+        processing_thread_.join();
     }
     istream_->stop();
+    if (capture_log_ != nullptr) { capture_log_->close(); }
 
     // Save data here!
     if (should_save_calibration_data_) { saveCalibrationDataWithPrompt(); }
@@ -1435,9 +1821,8 @@ void ofApp::exit() {
     if (should_save_test_data_) { saveTestDataWithPrompt(); }
 }
 
-void ofApp::onDataIn(GRT::MatrixDouble input) {
-    std::lock_guard<std::mutex> guard(input_data_mutex_);
-    input_data_ = input;
+void ofApp::onDataIn(const GRT::MatrixDouble& input, const SampleStamp& stamp) {
+    input_queue_.push(input, stamp);
 }
 
 //--------------------------------------------------------------
@@ -1455,129 +1840,166 @@ void ofApp::toggleFeatureView() {
 }
 
 void ofApp::beginTrainModel() {
-    // Update UI to reflect training starts.
-    status_text_ = "Training the model . . .";
-    is_training_scheduled_ = true;
-    schedule_time_ = ofGetElapsedTimeMillis();
+    trainModel();
 }
 
 void ofApp::trainModel() {
-    is_training_scheduled_ = false;
+    if (trainer_.isBusy()) {
+        setStatus("Still training the previous model; press `x` to cancel it.");
+        return;
+    }
 
-   // If prior training has not finished, we wait.
-   if (training_thread_.joinable()) {
-       training_thread_.join();
-   }
+    // Train a copy, so that live prediction can go on with the current model
+    // until finishTraining() swaps the trained one in.
+    std::unique_lock<std::mutex> lock(pipeline_mutex_);
+    unique_ptr<GestureRecognitionPipeline> pipeline(
+        new GestureRecognitionPipeline(*pipeline_));
+    lock.unlock();
 
-   auto training_func = [this]() -> bool {
-       ofLog() << "Training started";
-       bool training_status = false;
+    ofLog() << "Training started";
 
-       // Enable logging. GRT error logs will call ofApp::notify().
-       GRT::ErrorLog::enableLogging(true);
+    // Enable logging. GRT error logs will call ofApp::notify().
+    GRT::ErrorLog::enableLogging(true);
 
-       if (pipeline_->train(training_data_manager_.getAllData())) {
-           ofLog() << "Training is successful";
+    updateFeatureCache();
+    if (!trainer_.start(std::move(pipeline), training_data_manager_, &feature_cache_)) {
+        GRT::ErrorLog::enableLogging(false);
+        setStatus("Failed to start training the model.");
+        return;
+    }
+    setStatus("Training the model . . .");
+}
 
-           for (Plotter& plot : plot_samples_) {
-               assert(true == plot.clearContentModifiedFlag());
-           }
+void ofApp::finishTraining() {
+    PipelineTrainer::Result result;
+    if (!trainer_.takeResult(&result)) {
+        setStatus("Training the model: " + trainer_.getProgress() +
+                  " (press `x` to cancel)");
+        return;
+    }
 
-           scoreTrainingData(false);
+    // Stop logging.
+    GRT::ErrorLog::enableLogging(false);
 
-           training_status = true;
-       } else {
-           ofLog(OF_LOG_ERROR) << "Failed to train the model";
-       }
+    if (result.is_cancelled) {
+        ofLog() << "Training cancelled";
+        setStatus("Training was cancelled");
+        return;
+    }
+    if (!result.is_trained) {
+        ofLog(OF_LOG_ERROR) << "Failed to train the model";
+        return;
+    }
+    ofLog() << "Training is successful (" << result.seconds << " s, "
+            << result.num_processed_samples << " samples processed"
+            << (result.is_updated ? ", classifier updated in place)" : ")");
 
-       // Stop logging.
-       GRT::ErrorLog::enableLogging(false);
-       return training_status;
-   };
+    // The swap: live processing waits only for the copy, not the training.
+    std::unique_lock<std::mutex> lock(pipeline_mutex_);
+    *pipeline_ = *result.pipeline;
+    pipeline_->reset();
+    lock.unlock();
+
+    // New samples are scored against the model as trained, not as live
+    // prediction leaves it.
+    sample_scorer_.setModel(std::move(result.pipeline));
+
+    // Samples edited during training keep their old scores (and stay marked
+    // as modified) until the next training.
+    if (result.data_version == training_data_manager_.getVersion()) {
+        for (uint32_t label = 1; label < result.likelihoods.size(); label++) {
+            const auto& likelihoods = result.likelihoods[label];
+            for (uint32_t i = 0; i < likelihoods.size(); i++) {
+                training_data_manager_.setSampleClassLikelihoods(label, i, likelihoods[i]);
+            }
+        }
+        for (Plotter& plot : plot_samples_) {
+            plot.clearContentModifiedFlag();
+        }
+    }
 
-   // TODO(benzh) Fix data race issue later.
-   if (training_func()) {
-       fragment_ = TRAINING;
-       runPredictionOnTestData();
-       updateTestWindowPlot();
-       pipeline_->reset();
+    fragment_ = TRAINING;
+    runPredictionOnTestData();
+    updateTestWindowPlot();
 
-       status_text_ = "Training was successful";
-   }
+    status_text_ = "Training was successful";
 }
 
-void ofApp::scoreTrainingData(bool leaveOneOut) {
-    for (int label = 1; label <= training_data_manager_.getNumLabels(); label++) {
-        for (int i = 0; i < training_data_manager_.getNumSampleForLabel(label); i++) {
-            GRT::MatrixDouble sample =
-                training_data_manager_.getSample(label, (leaveOneOut ? 0 : i));
+void ofApp::crossValidate(uint32_t num_folds) {
+    if (cross_validator_.isBusy()) {
+        setStatus("Still cross-validating; press `x` to cancel it.");
+        return;
+    }
 
-            if (leaveOneOut) {
-                training_data_manager_.deleteSample(label, 0);
-                pipeline_->train(training_data_manager_.getAllData());
-            }
+    std::unique_lock<std::mutex> lock(pipeline_mutex_);
+    GestureRecognitionPipeline pipeline(*pipeline_);
+    lock.unlock();
 
-            //ofLog(OF_LOG_NOTICE) << "sample " << i << " (class " << label << "):";
-            vector<double> likelihoods(training_data_manager_.getNumLabels() + 1, 0.0);
-            for (int j = 0; j < sample.getNumRows(); j++) {
-                pipeline_->predict(sample.getRowVector(j));
-                auto l = pipeline_->getClassLikelihoods();
-                for (int k = 0; k < l.size(); k++) {
-                    likelihoods[pipeline_->getClassLabels()[k]] += l[k];
-                }
-            }
-            double sum = 0.0;
-            for (int j = 0; j < likelihoods.size(); j++) {
-                //ofLog(OF_LOG_NOTICE) << "\t" << (j + 1) << ": " << likelihoods[j] << "%";
-                sum += likelihoods[j];
-            }
-            for (int j = 0; j < likelihoods.size(); j++) {
-                likelihoods[j] /= (sum == 0.0 ? 1e-9 : sum);
-                //ofLog(OF_LOG_NOTICE) << "\t" << (j + 1) << ": " << likelihoods[j] << "%";
-            }
+    updateFeatureCache();
+    if (!cross_validator_.start(pipeline, training_data_manager_.getAllData(),
+                                training_data_manager_.getNumLabels(), num_folds,
+                                training_data_manager_.getVersion(), &feature_cache_)) {
+        setStatus("Cross-validation needs at least two training samples");
+        return;
+    }
+    setStatus("Cross-validating . . .");
+}
 
-            if (leaveOneOut) training_data_manager_.addSample(label, sample);
+void ofApp::finishCrossValidation() {
+    CrossValidator::Result result;
+    if (!cross_validator_.takeResult(&result)) {
+        setStatus("Cross-validating: " + cross_validator_.getProgress() +
+                  " (press `x` to cancel)");
+        return;
+    }
 
-            training_data_manager_.setSampleClassLikelihoods(label,
-                (leaveOneOut ? training_data_manager_.getNumSampleForLabel(label) - 1 : i),
-                likelihoods);
+    if (result.is_cancelled) {
+        setStatus("Cross-validation was cancelled");
+        return;
+    }
+    ofLog() << "Cross-validated " << result.num_folds << " folds in "
+            << result.seconds << " s";
 
-            pipeline_->reset();
+    if (result.data_version != training_data_manager_.getVersion()) {
+        setStatus("Training data changed while cross-validating; scores discarded");
+        return;
+    }
+    for (uint32_t label = 1; label < result.likelihoods.size(); label++) {
+        const auto& likelihoods = result.likelihoods[label];
+        for (uint32_t i = 0; i < likelihoods.size(); i++) {
+            if (likelihoods[i].empty()) { continue; }
+            training_data_manager_.setSampleClassLikelihoods(label, i, likelihoods[i]);
         }
     }
 
-    if (leaveOneOut) pipeline_->train(training_data_manager_.getAllData());
+    if (result.num_failed_folds != 0) {
+        setStatus("Cross-validation done; " + std::to_string(result.num_failed_folds) +
+                  " of " + std::to_string(result.num_folds) + " folds failed to train");
+    } else {
+        setStatus("Cross-validation done");
+    }
 }
 
-void ofApp::scoreImpactOfTrainingSample(int label, const MatrixDouble &sample) {
-    if (!pipeline_->getTrained()) return; // can't calculate a score
+void ofApp::updateSampleScores() {
+    for (const SampleScorer::Score& score : sample_scorer_.takeScores()) {
+        status_text_ = "Information gain of sample: " +
+            std::to_string((int) (100 * score.information_gain)) + "%";
 
-    GestureRecognitionPipeline p(*pipeline_);
-
-    p.reset();
-    //std::cout << "Scoring sample impact: " << std::endl;
-    double score = 0.0;
-    int num_non_zero = 0;
-    for (int j = 0; j < sample.getNumRows(); j++) {
-        pipeline_->predict(sample.getRowVector(j));
-        auto l = pipeline_->getClassLikelihoods();
-        bool non_zero = false;
-        for (int k = 0; k < l.size(); k++) {
-            if (l[k] > 1e-9) non_zero = true;
-            if (pipeline_->getClassLabels()[k] == label) {
-                //std::cout << l[k] << " ";
-                score += l[k];
-            }
-        }
-        if (non_zero) num_non_zero++;
-        //std::cout << non_zero << std::endl;
+        // The id is the data's version just after the sample was added; if
+        // it has changed since, the sample may no longer be the label's last.
+        if (score.id != training_data_manager_.getVersion()) { continue; }
+        uint32_t index = training_data_manager_.getNumSampleForLabel(score.label) - 1;
+        training_data_manager_.setSampleScore(score.label, index, score.information_gain);
+        training_data_manager_.setSampleClassLikelihoods(score.label, index, score.likelihoods);
     }
-    //std::cout << std::to_string(score / num_non_zero);
-    status_text_ = "Information gain of sample: " +
-        std::to_string((int) (100 * -log(score / num_non_zero))) + "%";
 }
 
 void ofApp::reloadPipelineModules() {
+    trainer_.cancel();
+    trainer_.invalidate();
+    is_front_end_key_stale_ = true;
+    sample_scorer_.setModel(nullptr);
+    std::lock_guard<std::mutex> guard(pipeline_mutex_);
     pipeline_->clearAll();
     ::setup();
 }
@@ -1615,18 +2037,16 @@ void ofApp::keyPressed(int key){
 
     if (key >= '1' && key <= '9') {
         if (!is_recording_) {
-            is_recording_ = true;
             label_ = key - '0';
-            sample_data_.clear();
+            startRecording();
         }
     }
 
     switch (key) {
         case 'r':
             if (!is_recording_) {
-                is_recording_ = true;
                 label_ = 255;
-                sample_data_.clear();
+                startRecording();
                 test_data_.clear();
                 plot_testdata_window_.reset();
             }
@@ -1639,18 +2059,62 @@ void ofApp::keyPressed(int key){
             else if (fragment_ == ANALYSIS) loadTestDataWithPrompt();
             break;
         case 'p': {
+            // Stopping a stream waits for its serial callback to return, so a
+            // callback blocked on a full queue must be released first.
+            std::unique_lock<std::mutex> lock(pipeline_mutex_);
+            input_queue_.close();
             istream_->toggle();
+            input_queue_.clear();
+            input_queue_.reopen();
+            is_input_sequence_known_ = false;
+            lock.unlock();
             enable_history_recording_ = !enable_history_recording_;
-            input_data_.clear();
+            if (!enable_history_recording_ && is_showing_captured_history_) {
+                // Back to live data.
+                is_showing_captured_history_ = false;
+                captured_history_offset_ = 0;
+                plot_inputs_.reset();
+                status_text_ = "";
+            }
             break;
         }
+        case '[':
+            if (enable_history_recording_ && capture_log_ != nullptr) {
+                showCapturedHistory(captured_history_offset_ + kBufferSize_ / 2);
+            }
+            break;
+        case ']':
+            if (enable_history_recording_ && capture_log_ != nullptr) {
+                uint64_t step = std::min<uint64_t>(captured_history_offset_, kBufferSize_ / 2);
+                showCapturedHistory(captured_history_offset_ - step);
+            }
+            break;
         case 'S': saveAll(); break;
+        case 'h':
+            if (fragment_ == PIPELINE) toggleLatencyTiming();
+            break;
+        case 'e':
+            if (fragment_ == PIPELINE) exportSampleTracesWithPrompt();
+            break;
         case 's':
-            if (fragment_ == CALIBRATION) saveCalibrationDataWithPrompt();
+            if (fragment_ == PIPELINE) saveLatencyWithPrompt();
+            else if (fragment_ == CALIBRATION) saveCalibrationDataWithPrompt();
             else if (fragment_ == TRAINING) saveTrainingDataWithPrompt();
             else if (fragment_ == ANALYSIS) saveTestDataWithPrompt();
             break;
         case 't': beginTrainModel(); break;
+        case 'v': crossValidate(CrossValidator::kLeaveOneOut); break;
+        case 'k': crossValidate(kNumCrossValidationFolds); break;
+        case 'x':
+            if (trainer_.isBusy()) {
+                trainer_.cancel();
+                setStatus("Cancelling training . . .");
+            }
+            if (cross_validator_.isBusy()) {
+                cross_validator_.cancel();
+                setStatus("Cancelling cross-validation . . .");
+            }
+            break;
 
         // Tab related
         case 'C': fragment_ = CALIBRATION; break;
@@ -1692,15 +2156,17 @@ void ofApp::keyReleased(int key) {
         return;
     }
 
-    is_recording_ = false;
+    stopRecording();
     if (key >= '1' && key <= '9') {
         if (fragment_ == CALIBRATION) {
             if (calibrator_ == nullptr) { return; }
 
             vector<CalibrateProcess>& calibrators = calibrator_->getCalibrateProcesses();
             if (label_ - 1 < calibrators.size()) {
+                std::unique_lock<std::mutex> lock(pipeline_mutex_);
                 CalibrateResult result =
                     calibrators[label_ - 1].calibrate(sample_data_);
+                lock.unlock();
 
                 if (result.getResult() != CalibrateResult::FAILURE) {
                     plot_calibrators_[label_ - 1].setData(sample_data_);
@@ -1724,9 +2190,9 @@ void ofApp::keyReleased(int key) {
                     return;
             }
 
-            scoreImpactOfTrainingSample(label_, sample_data_);
-
             training_data_manager_.addSample(label_, sample_data_);
+            sample_scorer_.add(training_data_manager_.getVersion(), label_,
+                               sample_data_, training_data_manager_.getNumLabels());
             int num_samples = training_data_manager_.getNumSampleForLabel(label_);
 
             plot_samples_[label_ - 1].setData(sample_data_);
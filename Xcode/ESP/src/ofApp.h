@@ -4,6 +4,8 @@
 #include <stdint.h>
 
 // C++ System
+#include <atomic>
+#include <mutex>
 #include <thread>
 
 // of System
@@ -13,14 +15,24 @@
 #include "ofxGrt.h"
 
 // custom
+#include "block-prediction.h"
 #include "calibrator.h"
+#include "cross-validation.h"
+#include "capture-log.h"
+#include "feature-cache.h"
 #include "iostream.h"
+#include "pipeline-trainer.h"
 #include "plotter.h"
+#include "runtime.h"
+#include "sample-queue.h"
+#include "sample-scorer.h"
+#include "sample-trace.h"
 #include "training.h"
 #include "training-data-manager.h"
 #include "tuneable.h"
 
-class ofApp : public ofBaseApp, public GRT::Observer<GRT::ErrorLogMessage> {
+class ofApp : public ofBaseApp, public Runtime,
+              public GRT::Observer<GRT::ErrorLogMessage> {
   public:
     ofApp();
     void setup() final;
@@ -40,15 +52,28 @@ class ofApp : public ofBaseApp, public GRT::Observer<GRT::ErrorLogMessage> {
     void dragEvent(ofDragInfo dragInfo) final;
     void gotMessage(ofMessage msg) final;
 
-    void registerTuneable(Tuneable* t) {
+    // Runtime
+    void useCalibrator(Calibrator &calibrator) final;
+    void usePipeline(GRT::GestureRecognitionPipeline &pipeline) final;
+    void useIStream(IStream &stream) final;
+    void useOStream(OStream &stream) final;
+    void useOStream(OStreamVector &stream) final;
+    void useTrainingSampleChecker(TrainingSampleChecker checker) final;
+    void useTrainingDataAdvice(string advice) final;
+    void useCaptureLog(const string& directory, uint64_t max_bytes,
+                       uint64_t max_age_seconds) final;
+
+    void registerTuneable(Tuneable* t) final {
         tuneable_parameters_.push_back(t);
     }
 
-    void reloadPipelineModules();
+    void reloadPipelineModules() final;
 
     // GRT error log observer callback: we simply display it as status text.
+    // Training logs from the trainer's thread, so update() shows it.
     virtual void notify(const ErrorLogMessage& data) final {
-        status_text_ = data.getMessage();
+        std::lock_guard<std::mutex> guard(notify_mutex_);
+        notify_text_ = data.getMessage();
     }
 
   private:
@@ -61,24 +86,6 @@ class ofApp : public ofBaseApp, public GRT::Observer<GRT::ErrorLogMessage> {
     void drawTrainingInfo();
     void drawAnalysis();
 
-    void useCalibrator(Calibrator &calibrator);
-    void usePipeline(GRT::GestureRecognitionPipeline &pipeline);
-    void useIStream(IStream &stream);
-    void useOStream(OStream &stream);
-    void useOStream(OStreamVector &stream);
-    void useTrainingSampleChecker(TrainingSampleChecker checker);
-    void useTrainingDataAdvice(string advice);
-
-    friend void useCalibrator(Calibrator &calibrator);
-    friend void usePipeline(GRT::GestureRecognitionPipeline &pipeline);
-    friend void useInputStream(IStream &stream);
-    friend void useOutputStream(OStream &stream);
-    friend void useOutputStream(OStreamVector &stream);
-    friend void useStream(IOStream &stream);
-    friend void useStream(IOStreamVector &stream);
-    friend void useTrainingSampleChecker(TrainingSampleChecker checker);
-    friend void useTrainingDataAdvice(string advice);
-
     bool setup_finished_ = false;
 
     uint32_t num_pipeline_stages_;
@@ -99,20 +106,115 @@ class ofApp : public ofBaseApp, public GRT::Observer<GRT::ErrorLogMessage> {
     // Input stream, a callback should be registered upon data arrival
     IStream *istream_;
     // Callback used for input data stream (istream_)
-    void onDataIn(GRT::MatrixDouble in);
+    void onDataIn(const GRT::MatrixDouble& in, const SampleStamp& stamp);
 
     // Output streams to which to write the results of the pipeline
     vector<OStream *> ostreams_;
     vector<OStreamVector *> ostreamvectors_;
 
-    // When button 1-9 is pressed, is_recording_ will be set and data will be
-    // added to sample_data_.
+    // When button 1-9 is pressed, is_recording_ will be set and the
+    // processing thread will add every sample it gets to sample_data_: raw
+    // for calibration samples, calibrated otherwise. Both are changed with
+    // pipeline_mutex_ held; once is_recording_ is cleared, sample_data_ is
+    // the GUI thread's again.
     bool is_recording_;
+    bool is_recording_raw_ = false;
     GRT::MatrixDouble sample_data_;
-
-    // input_data_ is written by istream_ thread and read by GUI thread.
-    std::mutex input_data_mutex_;
+    void startRecording();
+    void stopRecording();
+
+    // Samples are pushed by the istream_ thread into input_queue_. The
+    // processing thread runs them through the calibrator and pipeline as soon
+    // as they arrive and sends predictions to the output streams, so output
+    // latency doesn't depend on the frame rate. It then publishes everything
+    // update() and draw() show in display_queue_, one row per sample.
+    SampleQueue input_queue_;
+    std::thread processing_thread_;
+    std::atomic<bool> is_processing_;
+    void processInput();
+    void processSamples();
+
+    // Held by the processing thread while it uses pipeline_, calibrator_,
+    // capture_log_ and input_queue_'s consumer side, and by the GUI thread
+    // whenever it uses or changes any of them.
+    std::mutex pipeline_mutex_;
+
+    // Processing thread only: the samples being processed, input_data_
+    // calibrated in place (when the calibrator is calibrated) and what the
+    // pipeline made of them.
     GRT::MatrixDouble input_data_;
+    vector<SampleStamp> input_stamps_;
+    GRT::MatrixDouble calibrated_data_;
+    BlockPrediction live_prediction_;
+
+    // Per-sample latency of each stage of live processing, shown over the
+    // Pipeline tab. Timing is on only while it's shown; the histograms below
+    // are nullptr otherwise. They're set with pipeline_mutex_ held.
+    LatencyProfile latency_profile_;
+    bool is_showing_latency_ = false;
+    LatencyHistogram* calibrator_latency_ = nullptr;
+    vector<LatencyHistogram*> ostream_latencies_;
+    vector<LatencyHistogram*> ostreamvector_latencies_;
+    void toggleLatencyTiming();
+    void drawLatency();
+    bool saveLatencyWithPrompt();
+
+    // End to end: from each sample's arrival (see SampleStamp::arrival_time_us)
+    // to its prediction and, for samples that make the output streams fire,
+    // to their return. The slowest of the latter are kept in sample_tracer_.
+    uint64_t input_dequeued_us_ = 0;
+    LatencyHistogram* prediction_latency_ = nullptr;
+    LatencyHistogram* output_latency_ = nullptr;
+    SampleTracer sample_tracer_;
+    bool exportSampleTracesWithPrompt();
+    vector<double> display_row_;
+
+    // Each row of display_queue_ holds, at these offsets: the raw sample
+    // (at 0), the calibrated sample, the output of each pre-processing and
+    // feature extraction stage, DisplayFlags, and the prediction: the label
+    // followed by the class distances and likelihoods, indexed by label
+    // (NaN for classes the classifier doesn't have).
+    enum DisplayFlags { kHasInput = 1, kHasStages = 2, kHasPrediction = 4 };
+    struct DisplayLayout {
+        uint32_t input;
+        // Where each stage's output starts, plus where the last one ends.
+        vector<uint32_t> pre_processed;
+        vector<uint32_t> features;
+        uint32_t flags;
+        uint32_t label;
+        uint32_t distances;
+        uint32_t likelihoods;
+        uint32_t width;
+    };
+    DisplayLayout display_layout_;
+    SampleQueue display_queue_;
+    void setupDisplayQueue(uint32_t num_input_dimensions);
+
+    // GUI thread only: the rows drained from display_queue_ in update().
+    GRT::MatrixDouble display_data_;
+    uint64_t last_reported_overflows_ = 0;
+    uint64_t last_reported_display_drops_ = 0;
+    uint64_t last_reported_discarded_[SampleQueue::kNumOverflowPolicies] = {};
+
+    // Gaps in the input sequence numbers, i.e. samples lost before they
+    // reached the processing thread. Tracking restarts whenever the input is
+    // cleared.
+    std::atomic<bool> is_input_sequence_known_;
+    uint64_t next_input_sequence_ = 0;
+    std::atomic<uint64_t> num_missing_input_samples_;
+    uint64_t last_reported_missing_ = 0;
+
+    // The stamp of the sample most recently run through the pipeline.
+    SampleStamp latest_input_stamp_;
+
+    // Optional recording of every raw input sample (see useCaptureLog()).
+    // While paused, plot_inputs_ can show older parts of it instead of the
+    // live buffer; captured_history_offset_ is how many samples back from
+    // the newest the plotted window ends.
+    unique_ptr<CaptureLog> capture_log_;
+    bool is_showing_captured_history_ = false;
+    uint64_t captured_history_offset_ = 0;
+    void showCapturedHistory(uint64_t offset);
 
     // Pipeline
     GRT::GestureRecognitionPipeline *pipeline_;
@@ -126,6 +228,8 @@ class ofApp : public ofBaseApp, public GRT::Observer<GRT::ErrorLogMessage> {
     vector<double> predicted_class_likelihoods_; CircularBuffer<vector<double>> predicted_class_likelihoods_buffer_;
     vector<UINT> predicted_class_labels_; CircularBuffer<vector<UINT>> predicted_class_labels_buffer_;
     vector<UINT> test_data_predicted_class_labels_;
+    // For predictBlock() on the GUI thread.
+    BlockPrediction prediction_;
 
     // Visuals
     ofxGrtTimeseriesPlot plot_raw_;
@@ -151,6 +255,8 @@ class ofApp : public ofBaseApp, public GRT::Observer<GRT::ErrorLogMessage> {
     void toggleFeatureView();
     bool is_in_feature_view_ = false;
     void populateSampleFeatures(uint32_t sample_index);
+    // Brings feature_cache_ up to date with the training data and pipeline_.
+    void updateFeatureCache();
     vector<pair<double, double>> sample_feature_ranges_;
 
     ofxGrtTimeseriesPlot plot_prediction_;
@@ -222,9 +328,16 @@ class ofApp : public ofBaseApp, public GRT::Observer<GRT::ErrorLogMessage> {
     void beginTrainModel();
     void drawEventReceived(ofEventArgs& arg);
     void trainModel();
+    // Called from update() while the trainer is busy: shows its progress,
+    // and swaps in the trained pipeline once it's done.
+    void finishTraining();
 
-    void scoreTrainingData(bool leaveOneOut);
-    void scoreImpactOfTrainingSample(int label, const MatrixDouble &sample);
+    // Scores the training samples with pipelines trained without them. See
+    // CrossValidator.
+    void crossValidate(uint32_t num_folds);
+    void finishCrossValidation();
+    // Shows (and keeps) the scores sample_scorer_ has finished.
+    void updateSampleScores();
 
     vector<ofxDatGui *> training_sample_guis_;
     void renameTrainingSample(int num);
@@ -245,8 +358,18 @@ class ofApp : public ofBaseApp, public GRT::Observer<GRT::ErrorLogMessage> {
     // Display title is rename_title_ plus a blinking underscore.
     string display_title_;
 
-    // Multithreading to avoid GUI blocked.
-    std::thread training_thread_;
+    // Trains a copy of pipeline_ so that the GUI and live prediction don't
+    // wait for it.
+    PipelineTrainer trainer_;
+    CrossValidator cross_validator_;
+    // The training samples' front-end output, for training, cross-validation
+    // and the feature view. front_end_key_ is pipeline_'s
+    // FeatureCache::computeKey(), worked out again when it's marked stale.
+    FeatureCache feature_cache_;
+    uint64_t front_end_key_ = 0;
+    bool is_front_end_key_stale_ = true;
+    // Scores samples as they're recorded against the last trained model.
+    SampleScorer sample_scorer_;
 
     friend class TrainingSampleGuiListener;
 
@@ -266,8 +389,8 @@ class ofApp : public ofBaseApp, public GRT::Observer<GRT::ErrorLogMessage> {
         status_text_ = msg;
     }
 
-    bool is_training_scheduled_;
-    uint64_t schedule_time_;
+    std::mutex notify_mutex_;
+    string notify_text_;
 };
 
 class TrainingSampleGuiListener {
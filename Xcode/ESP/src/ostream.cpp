@@ -1,4 +1,5 @@
-#include "ofApp.h"
+#include "ofMain.h"
+#include "runtime.h"
 #include "ostream.h"
 
 #if __APPLE__
@@ -6,11 +7,11 @@
 #endif
 
 void useOutputStream(OStream &stream) {
-    ((ofApp *) ofGetAppPtr())->useOStream(stream);
+    getRuntime()->useOStream(stream);
 }
 
 void useOutputStream(OStreamVector &stream) {
-    ((ofApp *) ofGetAppPtr())->useOStream(stream);
+    getRuntime()->useOStream(stream);
 }
 
 void MacOSKeyboardOStream::sendKey(char c) {
@@ -21,6 +21,7 @@
 
 #include "ofMain.h"
 #include "ofxTCPClient.h"
+#include "sample-stamp.h"
 #include "stream.h"
 
 const uint64_t kGracePeriod = 500; // 0.5 second
@@ -42,6 +43,16 @@ class ofApp;
 class OStream : public virtual Stream {
   public:
     virtual void onReceive(uint32_t label) = 0;
+
+    /**
+     Like onReceive(), but also given the stamp of the input sample that led
+     to this prediction. Override this to measure latency (e.g. against
+     getMonotonicMicros()) or to act on the sample's capture time; by default
+     it just calls onReceive().
+     */
+    virtual void onReceiveStamped(uint32_t label, const SampleStamp& stamp) {
+        onReceive(label);
+    }
 };
 
 /**
@@ -59,6 +70,11 @@ class OStream : public virtual Stream {
 class OStreamVector : public OStream {
   public:
     virtual void onReceive(vector<double>) = 0;
+
+    using OStream::onReceiveStamped;
+    virtual void onReceiveStamped(vector<double> data, const SampleStamp& stamp) {
+        onReceive(data);
+    }
 };
 
 /**
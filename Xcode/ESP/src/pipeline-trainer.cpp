@@ -0,0 +1,128 @@
+#include "pipeline-trainer.h"
+
+#include "block-prediction.h"
+#include "incremental-trainer.h"
+#include "latency-histogram.h"
+
+PipelineTrainer::PipelineTrainer()
+        : is_finished_(false), should_cancel_(false), should_invalidate_(false) {
+}
+
+PipelineTrainer::~PipelineTrainer() {
+    cancel();
+    wait();
+}
+
+bool PipelineTrainer::start(std::unique_ptr<GRT::GestureRecognitionPipeline> pipeline,
+                            TrainingDataManager& data, FeatureCache* cache) {
+    if (isBusy() || pipeline == nullptr || cache == nullptr) { return false; }
+
+    cache_ = cache;
+    features_ = cache->getSnapshot();
+
+    result_ = Result();
+    result_.pipeline = std::move(pipeline);
+    result_.data_version = data.getVersion();
+    result_.num_processed_samples = features_.getNumMissing();
+    is_finished_ = false;
+    should_cancel_ = false;
+    setProgress("training");
+
+    thread_.reset(new std::thread(&PipelineTrainer::run, this, data.getAllData(),
+                                  data.getNumLabels()));
+    return true;
+}
+
+void PipelineTrainer::cancel() {
+    should_cancel_ = true;
+}
+
+void PipelineTrainer::invalidate() {
+    // incremental_ belongs to the worker; it picks this up at its next run.
+    should_invalidate_ = true;
+}
+
+std::string PipelineTrainer::getProgress() const {
+    std::lock_guard<std::mutex> guard(progress_mutex_);
+    return progress_;
+}
+
+void PipelineTrainer::setProgress(const std::string& progress) {
+    std::lock_guard<std::mutex> guard(progress_mutex_);
+    progress_ = progress;
+}
+
+bool PipelineTrainer::takeResult(Result* result) {
+    if (!isBusy() || !is_finished_) { return false; }
+    wait();
+    thread_.reset();
+    *result = std::move(result_);
+    result_ = Result();
+    return true;
+}
+
+void PipelineTrainer::wait() {
+    if (thread_ != nullptr && thread_->joinable()) { thread_->join(); }
+}
+
+void PipelineTrainer::run(GRT::TimeSeriesClassificationData data, uint32_t num_labels) {
+    const uint64_t start_ns = getMonotonicNanos();
+    GRT::GestureRecognitionPipeline& pipeline = *result_.pipeline;
+    if (should_invalidate_.exchange(false)) { incremental_.invalidate(); }
+
+    std::vector<GRT::TimeSeriesClassificationData> class_data(num_labels + 1);
+    for (uint32_t label = 1; label <= num_labels; label++) {
+        class_data[label] = data.getClassData(label);
+    }
+    const uint32_t num_missing = result_.num_processed_samples;
+    auto fill = [&]() {
+        cache_->fill(&features_, pipeline, class_data, [&](uint32_t num_done) {
+            setProgress("processing " + std::to_string(num_done + 1) + " / " +
+                        std::to_string(num_missing));
+            return bool(should_cancel_);
+        });
+    };
+
+    // The classifier can only be trained on its own once the pipeline has
+    // been trained as a whole (which sets up the pipeline around it).
+    if (pipeline.getTrained() && canTrainClassifierAlone(pipeline)) {
+        fill();
+        result_.is_trained = !should_cancel_ &&
+            incremental_.train(*pipeline.getClassifier(), features_, &result_.is_updated);
+    } else {
+        setProgress("training");
+        result_.num_processed_samples = data.getNumSamples();
+        result_.is_trained = pipeline.train(data);
+        if (result_.is_trained) { fill(); }
+        incremental_.invalidate();
+    }
+
+    if (result_.is_trained && !should_cancel_) {
+        uint32_t num_scored = 0;
+        const uint32_t num_samples = data.getNumSamples();
+        result_.likelihoods.resize(num_labels + 1);
+        for (uint32_t label = 1; label <= num_labels && !should_cancel_; label++) {
+            for (uint32_t i = 0; i < features_.entries[label].size() && !should_cancel_; i++) {
+                setProgress("scoring " + std::to_string(++num_scored) + " / " +
+                            std::to_string(num_samples));
+                result_.likelihoods[label].push_back(predictClassifierLikelihoods(
+                    *pipeline.getClassifier(), features_.entries[label][i]->getClassifierInput(),
+                    num_labels));
+            }
+        }
+        pipeline.reset();
+    }
+
+    result_.is_cancelled = should_cancel_;
+    if (result_.is_cancelled) {
+        result_.is_trained = false;
+        result_.likelihoods.clear();
+    }
+    // A result that isn't trained isn't swapped in, so the next run's
+    // classifier won't be this one.
+    if (!result_.is_trained) { incremental_.invalidate(); }
+    features_ = FeatureCache::Snapshot();
+    result_.seconds = (getMonotonicNanos() - start_ns) / 1e9;
+    setProgress(result_.is_cancelled ? "cancelled" : "done");
+    is_finished_ = true;
+}
@@ -0,0 +1,125 @@
+/** @file pipeline-trainer.h
+ *  @brief PipelineTrainer, which trains a copy of a pipeline on a thread of
+ *  its own so that the pipeline it was copied from can go on predicting.
+ *
+ *  @verbatim
+ *  feature_cache.update(training_data_manager, FeatureCache::computeKey(copy));
+ *  trainer.start(std::move(copy), training_data_manager, &feature_cache);
+ *  ...
+ *  PipelineTrainer::Result result;
+ *  if (trainer.takeResult(&result) && result.is_trained) {
+ *      // swap result.pipeline in
+ *  }
+ *  @endverbatim
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GRT/GRT.h>
+
+#include "feature-cache.h"
+#include "incremental-trainer.h"
+#include "training-data-manager.h"
+
+class PipelineTrainer {
+  public:
+    /// @brief What a training run left behind.
+    struct Result {
+        bool is_trained = false;
+        bool is_cancelled = false;
+
+        /// @brief The pipeline that was passed to start(), trained or not.
+        std::unique_ptr<GRT::GestureRecognitionPipeline> pipeline;
+
+        /// @brief likelihoods[label][index]: the trained pipeline's class
+        /// likelihoods for each training sample (see
+        /// predictSampleLikelihoods()). Empty unless is_trained.
+        std::vector<std::vector<std::vector<double>>> likelihoods;
+
+        /// @brief The data's version when the run started, to tell whether
+        /// the likelihoods still belong to the samples they were computed for.
+        uint64_t data_version = 0;
+
+        /// @brief How many samples were run through the pre-processing and
+        /// feature extraction modules: those missing from the FeatureCache.
+        uint32_t num_processed_samples = 0;
+
+        /// @brief Whether the classifier was updated with the edits since
+        /// the last run rather than trained from scratch (see
+        /// IncrementalTrainer).
+        bool is_updated = false;
+
+        double seconds = 0;
+    };
+
+    PipelineTrainer();
+    ~PipelineTrainer();
+
+    /**
+     @brief Starts training pipeline on a copy of data's samples, then
+     scoring each of them with it. Samples whose front-end output is in
+     cache, which must be up to date with data and pipeline (see
+     FeatureCache::update()), aren't run through the front end again; those
+     that aren't are, and are added to it. Returns false, and does nothing,
+     if a run is still going or hasn't been taken yet.
+     */
+    bool start(std::unique_ptr<GRT::GestureRecognitionPipeline> pipeline,
+               TrainingDataManager& data, FeatureCache* cache);
+
+    /**
+     @brief Asks the run to stop. GRT can't interrupt train(), so a run
+     that's training finishes that first; its result is marked cancelled.
+     */
+    void cancel();
+
+    /**
+     @brief Makes the next run train from scratch. Call it when the pipeline
+     passed to the next start() isn't a copy of the last one trained, e.g.
+     once another one has been loaded.
+     */
+    void invalidate();
+
+    /// @brief Whether a run has been started and not yet taken.
+    bool isBusy() const { return thread_ != nullptr; }
+
+    /// @brief What the current run is doing, e.g. "scoring 3 / 40".
+    std::string getProgress() const;
+
+    /**
+     @brief If a run has finished, moves its result into result and returns
+     true, making the trainer ready for another start(). Doesn't block.
+     */
+    bool takeResult(Result* result);
+
+    /// @brief Blocks until the current run, if any, finishes.
+    void wait();
+
+  private:
+    void run(GRT::TimeSeriesClassificationData data, uint32_t num_labels);
+    void setProgress(const std::string& progress);
+
+    std::unique_ptr<std::thread> thread_;
+    std::atomic_bool is_finished_;
+    std::atomic_bool should_cancel_;
+    std::atomic_bool should_invalidate_;
+
+    mutable std::mutex progress_mutex_;
+    std::string progress_;
+
+    // Only touched by the worker until is_finished_ is set.
+    Result result_;
+    FeatureCache* cache_ = nullptr;
+    FeatureCache::Snapshot features_;
+    IncrementalTrainer incremental_;
+
+    // Disallow copy and assign
+    PipelineTrainer(PipelineTrainer&) = delete;
+    void operator=(PipelineTrainer) = delete;
+};
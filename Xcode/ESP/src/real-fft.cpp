@@ -0,0 +1,79 @@
+#include "real-fft.h"
+
+#include <cmath>
+
+RealFFT::RealFFT() : size_(0) {}
+
+bool RealFFT::setup(uint32_t size) {
+    if (size < 4 || (size & (size - 1)) != 0) { return false; }
+
+    size_ = size;
+    const uint32_t half = size / 2;
+
+    // Hann window, scaled so that a full-scale sine has magnitude ~1.
+    window_.resize(size);
+    double window_sum = 0;
+    for (uint32_t i = 0; i < size; i++) {
+        window_[i] = 0.5 - 0.5 * cos(2 * M_PI * i / size);
+        window_sum += window_[i];
+    }
+    for (double& w : window_) { w *= 2 / window_sum; }
+
+    uint32_t bits = 0;
+    while ((1u << bits) < half) { bits++; }
+    bit_reversed_.resize(half);
+    for (uint32_t i = 0; i < half; i++) {
+        uint32_t r = 0;
+        for (uint32_t b = 0; b < bits; b++) { r |= ((i >> b) & 1) << (bits - 1 - b); }
+        bit_reversed_[i] = r;
+    }
+
+    twiddles_.resize(half / 2);
+    for (uint32_t k = 0; k < half / 2; k++) {
+        twiddles_[k] = std::polar(1.0, -2 * M_PI * k / half);
+    }
+    split_.resize(half);
+    for (uint32_t k = 0; k < half; k++) {
+        split_[k] = std::polar(1.0, -2 * M_PI * k / size);
+    }
+    buffer_.resize(half);
+    return true;
+}
+
+void RealFFT::transform() {
+    const uint32_t n = buffer_.size();
+    for (uint32_t i = 0; i < n; i++) {
+        if (i < bit_reversed_[i]) { std::swap(buffer_[i], buffer_[bit_reversed_[i]]); }
+    }
+    for (uint32_t len = 2; len <= n; len <<= 1) {
+        const uint32_t step = n / len;
+        for (uint32_t start = 0; start < n; start += len) {
+            for (uint32_t k = 0; k < len / 2; k++) {
+                std::complex<double> t = twiddles_[k * step] * buffer_[start + k + len / 2];
+                buffer_[start + k + len / 2] = buffer_[start + k] - t;
+                buffer_[start + k] += t;
+            }
+        }
+    }
+}
+
+void RealFFT::computeMagnitudes(const float* frame, double* magnitudes) {
+    const uint32_t half = size_ / 2;
+
+    // Pack even samples into the real parts and odd ones into the imaginary
+    // parts.
+    for (uint32_t i = 0; i < half; i++) {
+        buffer_[i] = std::complex<double>(frame[2 * i] * window_[2 * i],
+                                          frame[2 * i + 1] * window_[2 * i + 1]);
+    }
+    transform();
+
+    // X[k] = (Z[k] + conj(Z[N/2-k])) / 2 - i/2 * W^k * (Z[k] - conj(Z[N/2-k]))
+    for (uint32_t k = 0; k < half; k++) {
+        const std::complex<double> z = buffer_[k];
+        const std::complex<double> zc = std::conj(buffer_[(half - k) % half]);
+        const std::complex<double> even = 0.5 * (z + zc);
+        const std::complex<double> odd = std::complex<double>(0, -0.5) * (z - zc);
+        magnitudes[k] = std::abs(even + split_[k] * odd);
+    }
+}
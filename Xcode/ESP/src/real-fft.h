@@ -0,0 +1,48 @@
+/** @file real-fft.h
+ *  @brief RealFFT, a fixed-size FFT of real-valued frames returning the
+ *  magnitude spectrum.
+ */
+
+#pragma once
+
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+/**
+ @brief Computes the windowed magnitude spectrum of real input frames.
+
+ The frame is packed into a complex FFT of half its size, which is then
+ split into the spectrum of the real input. The FFT is an iterative radix-2
+ transform with precomputed twiddle factors and a fixed order of operations,
+ so a given frame always yields a bit-identical spectrum.
+
+ setup() allocates; computeMagnitudes() doesn't.
+ */
+class RealFFT {
+  public:
+    RealFFT();
+
+    /// @brief Prepare for frames of `size` samples, a power of two >= 4.
+    /// Frames are multiplied by a Hann window.
+    bool setup(uint32_t size);
+
+    uint32_t getSize() const { return size_; }
+
+    /**
+     Compute the magnitudes of the first size / 2 frequency bins of `frame`
+     (DC up to just below Nyquist). A full-scale sine wave centered on a bin
+     has a magnitude of about 1 in that bin.
+     */
+    void computeMagnitudes(const float* frame, double* magnitudes);
+
+  private:
+    void transform();  // in-place complex FFT of buffer_
+
+    uint32_t size_;
+    std::vector<double> window_;
+    std::vector<uint32_t> bit_reversed_;
+    std::vector<std::complex<double>> twiddles_;   // for the half-size FFT
+    std::vector<std::complex<double>> split_;      // for splitting the result
+    std::vector<std::complex<double>> buffer_;
+};
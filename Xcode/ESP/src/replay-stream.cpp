@@ -0,0 +1,157 @@
+#include "replay-stream.h"
+#include "capture-log.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+
+// Samples per normalizeAndEmit() call in AS_FAST_AS_POSSIBLE mode.
+static const uint32_t kReplayBlockSize = 256;
+
+// Longest single sleep while pacing, so that stop() isn't held up by a long
+// gap in the recording.
+static const std::chrono::milliseconds kMaxReplaySleep(100);
+
+typedef std::chrono::steady_clock ReplayClock;
+
+ReplayStream::ReplayStream(const string& filename, ReplayMode mode)
+        : filename_(filename), mode_(mode), is_finished_(false), num_replayed_(0) {
+}
+
+ReplayStream::~ReplayStream() {
+    stop();
+}
+
+bool ReplayStream::load() {
+    if (is_loaded_) { return true; }
+
+    const string path = ofToDataPath(filename_);
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        vector<SampleStamp> stamps;
+        if (!CaptureLog::readAll(path, samples_, stamps)) {
+            ofLog(OF_LOG_ERROR) << "ReplayStream: no captured samples in " << filename_;
+            return false;
+        }
+        timestamps_.clear();
+        for (const SampleStamp& stamp : stamps) {
+            timestamps_.push_back(stamp.host_time_us);
+        }
+        is_loaded_ = true;
+        return true;
+    }
+
+    GRT::MatrixDouble data;
+    if (!data.load(path)) {
+        ofLog(OF_LOG_ERROR) << "ReplayStream: can't load " << filename_;
+        return false;
+    }
+
+    const uint32_t first_column = has_timestamp_column_ ? 1 : 0;
+    if (data.getNumRows() == 0 || data.getNumCols() <= first_column) {
+        ofLog(OF_LOG_ERROR) << "ReplayStream: no samples in " << filename_;
+        return false;
+    }
+
+    samples_.resize(data.getNumRows(), data.getNumCols() - first_column);
+    timestamps_.clear();
+    for (uint32_t i = 0; i < data.getNumRows(); i++) {
+        if (has_timestamp_column_) { timestamps_.push_back(data[i][0]); }
+        for (uint32_t j = first_column; j < data.getNumCols(); j++) {
+            samples_[i][j - first_column] = data[i][j];
+        }
+    }
+
+    is_loaded_ = true;
+    return true;
+}
+
+bool ReplayStream::start() {
+    if (!has_started_) {
+        if (!load()) return false;
+        is_finished_ = false;
+        num_replayed_ = 0;
+        has_started_ = true;
+        replay_thread_.reset(new std::thread(&ReplayStream::replay, this));
+    }
+
+    return true;
+}
+
+void ReplayStream::stop() {
+    has_started_ = false;
+    if (replay_thread_ != nullptr && replay_thread_->joinable()) {
+        replay_thread_->join();
+    }
+}
+
+int ReplayStream::getNumInputDimensions() {
+    // The app asks before starting the stream, so load the file early.
+    return load() ? samples_.getNumCols() : 0;
+}
+
+void ReplayStream::replay() {
+    auto start_time = ReplayClock::now();
+
+    do {
+        if (mode_ == AS_FAST_AS_POSSIBLE) {
+            replayUnpaced();
+        } else {
+            replayPaced();
+        }
+    } while (loop_ && has_started_);
+
+    if (!has_started_) { return; }
+    is_finished_ = true;
+
+    double seconds = std::chrono::duration<double>(ReplayClock::now() - start_time).count();
+    ofLog() << "ReplayStream: replayed " << num_replayed_ << " samples in "
+            << seconds << " s (" << num_replayed_ / std::max(seconds, 1e-9)
+            << " samples/s)";
+}
+
+void ReplayStream::replayPaced() {
+    const bool use_timestamps = mode_ == ORIGINAL_TIMING && !timestamps_.empty();
+    const auto period = std::chrono::duration<double>(1.0 / fixed_rate_);
+    const auto start_time = ReplayClock::now();
+
+    GRT::MatrixDouble sample(1, samples_.getNumCols());
+    for (uint32_t i = 0; i < samples_.getNumRows() && has_started_; i++) {
+        ReplayClock::time_point due;
+        if (use_timestamps) {
+            due = start_time + std::chrono::microseconds(timestamps_[i] - timestamps_[0]);
+        } else {
+            due = start_time + std::chrono::duration_cast<ReplayClock::duration>(i * period);
+        }
+
+        while (has_started_ && ReplayClock::now() < due) {
+            std::this_thread::sleep_for(
+                std::min<ReplayClock::duration>(due - ReplayClock::now(), kMaxReplaySleep));
+        }
+        if (!has_started_) { break; }
+
+        std::copy(samples_[i], samples_[i] + samples_.getNumCols(), sample[0]);
+        normalizeAndEmit(sample,
+                         timestamps_.empty() ? SampleStamp::kNoDeviceTime : timestamps_[i]);
+        num_replayed_++;
+    }
+}
+
+void ReplayStream::replayUnpaced() {
+    const uint32_t num_rows = samples_.getNumRows();
+    const uint32_t num_cols = samples_.getNumCols();
+    GRT::MatrixDouble block(std::min(kReplayBlockSize, num_rows), num_cols);
+
+    for (uint32_t i = 0; i < num_rows && has_started_; i += block.getNumRows()) {
+        const uint32_t n = std::min(kReplayBlockSize, num_rows - i);
+        if (n != block.getNumRows()) { block.resize(n, num_cols); }  // last block
+
+        for (uint32_t k = 0; k < n; k++) {
+            std::copy(samples_[i + k], samples_[i + k] + num_cols, block[k]);
+        }
+        normalizeAndEmit(block,
+                         timestamps_.empty() ? SampleStamp::kNoDeviceTime : timestamps_[i]);
+        num_replayed_ += n;
+    }
+}
@@ -0,0 +1,110 @@
+/** @file replay-stream.h
+ *  @brief ReplayStream, an input stream that plays back a recorded session
+ *  instead of reading from live hardware.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "istream.h"
+
+/**
+ @brief Input stream that replays samples recorded in a file.
+
+ The file holds one sample per row in the format written by
+ GRT::MatrixDouble::save(), e.g. the TestData.grt saved from the Analysis tab.
+ If the first column holds each sample's capture time in microseconds, call
+ useTimestampColumn(); the column is then used for ORIGINAL_TIMING and passed
+ on as the samples' device time rather than as data.
+
+ Alternatively, pass the directory of a CaptureLog (see useCaptureLog()) to
+ replay everything it recorded, with its original timing.
+
+ Replayed samples go through the normalizer set on this stream, if any, and
+ then through the app's calibrator, like live ones. A CaptureLog is recorded
+ before calibration, so it replays as it was captured. TestData.grt, however,
+ holds samples that were already calibrated (unless they were recorded raw):
+ replaying it calibrates them a second time, so replay it with a calibrator
+ that leaves its input alone, or record raw data instead.
+
+ Replays are deterministic: the same file always produces the same samples in
+ the same order, so a session recorded in the field can be reproduced, and
+ in AS_FAST_AS_POSSIBLE mode the pipeline's throughput can be measured.
+
+ To use a ReplayStream in your application, pass it to useInputStream() in
+ your setup() function.
+ */
+class ReplayStream : public IStream {
+  public:
+    enum ReplayMode {
+        // Reproduce the gaps between the recorded timestamps. Files without
+        // timestamps are replayed at the fixed rate instead.
+        ORIGINAL_TIMING,
+        // One sample every 1 / rate seconds (see setFixedRate()).
+        FIXED_RATE,
+        // No pacing at all: samples are emitted in blocks as quickly as the
+        // app accepts them.
+        AS_FAST_AS_POSSIBLE,
+    };
+
+    /**
+     Create a ReplayStream instance.
+
+     @param filename: the recorded session to replay. Relative paths are
+     resolved against the app's data directory.
+     @param mode: how to pace the replay.
+     */
+    ReplayStream(const string& filename, ReplayMode mode = ORIGINAL_TIMING);
+    ~ReplayStream();
+
+    virtual bool start() final;
+    virtual void stop() final;
+    virtual int getNumInputDimensions() final;
+
+    /// @brief Treat the first column of the file as capture timestamps in
+    /// microseconds. Call before the stream starts.
+    void useTimestampColumn() { has_timestamp_column_ = true; }
+
+    /// @brief The rate used by FIXED_RATE (and by ORIGINAL_TIMING for files
+    /// without timestamps). Defaults to 100 Hz.
+    void setFixedRate(double samples_per_second) { fixed_rate_ = samples_per_second; }
+
+    /// @brief Start over from the first sample after reaching the end.
+    void setLoop(bool loop) { loop_ = loop; }
+
+    /// @brief Whether every sample has been replayed (never, when looping).
+    bool isFinished() const { return is_finished_.load(); }
+
+    /// @brief Number of samples emitted since the stream was started.
+    uint64_t getNumReplayedSamples() const { return num_replayed_.load(); }
+
+  private:
+    bool load();
+    void replay();
+    void replayPaced();
+    void replayUnpaced();
+
+    string filename_;
+    ReplayMode mode_;
+    bool has_timestamp_column_ = false;
+    double fixed_rate_ = 100.0;
+    bool loop_ = false;
+
+    // The recorded samples, without the timestamp column, and their
+    // timestamps (empty if the file has none).
+    bool is_loaded_ = false;
+    GRT::MatrixDouble samples_;
+    vector<int64_t> timestamps_;
+
+    std::atomic<bool> is_finished_;
+    std::atomic<uint64_t> num_replayed_;
+    unique_ptr<std::thread> replay_thread_;
+
+    // Disallow copy and assign
+    ReplayStream(ReplayStream&) = delete;
+    void operator=(ReplayStream) = delete;
+};
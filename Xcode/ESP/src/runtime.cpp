@@ -0,0 +1,9 @@
+#include "runtime.h"
+
+#include "ofMain.h"
+
+Runtime* getRuntime() {
+    Runtime* runtime = dynamic_cast<Runtime*>(ofGetAppPtr());
+    assert(runtime != nullptr);
+    return runtime;
+}
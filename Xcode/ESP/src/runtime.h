@@ -0,0 +1,43 @@
+/** @file runtime.h
+ *  @brief Runtime, the interface behind the functions user code calls from
+ *  setup() (useInputStream(), usePipeline(), useCalibrator() and so on).
+ *
+ *  It's implemented by the GUI (ofApp) and by the headless runtime
+ *  (HeadlessApp), so the same user code runs under either.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <GRT/GRT.h>
+
+#include "training.h"
+
+class Calibrator;
+class IStream;
+class OStream;
+class OStreamVector;
+class Tuneable;
+
+class Runtime {
+  public:
+    virtual ~Runtime() {}
+
+    virtual void useCalibrator(Calibrator& calibrator) = 0;
+    virtual void usePipeline(GRT::GestureRecognitionPipeline& pipeline) = 0;
+    virtual void useIStream(IStream& stream) = 0;
+    virtual void useOStream(OStream& stream) = 0;
+    virtual void useOStream(OStreamVector& stream) = 0;
+    virtual void useTrainingSampleChecker(TrainingSampleChecker checker) = 0;
+    virtual void useTrainingDataAdvice(std::string advice) = 0;
+    virtual void useCaptureLog(const std::string& directory, uint64_t max_bytes,
+                               uint64_t max_age_seconds) = 0;
+
+    virtual void registerTuneable(Tuneable* t) = 0;
+    virtual void reloadPipelineModules() = 0;
+};
+
+/// @brief The running app, whichever kind it is.
+Runtime* getRuntime();
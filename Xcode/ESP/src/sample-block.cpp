@@ -0,0 +1,73 @@
+#include "sample-block.h"
+
+#include <algorithm>
+#include <cmath>
+
+void forEachBlock(GRT::MatrixDouble& matrix, const BlockTransformFunc& f) {
+    const uint32_t rows = matrix.getNumRows(), cols = matrix.getNumCols();
+    if (rows == 0 || cols == 0) { return; }
+
+    const ptrdiff_t stride = (rows > 1) ? matrix[1] - matrix[0] : cols;
+    bool is_evenly_spaced = stride >= (ptrdiff_t) cols;
+    for (uint32_t i = 2; i < rows && is_evenly_spaced; i++) {
+        is_evenly_spaced = (matrix[i] == matrix[0] + i * stride);
+    }
+
+    if (is_evenly_spaced) {
+        f(SampleBlock(matrix[0], rows, cols, stride));
+    } else {
+        for (uint32_t i = 0; i < rows; i++) { f(SampleBlock(matrix[i], 1, cols)); }
+    }
+}
+
+AffineTransform::AffineTransform(std::vector<double> scale, std::vector<double> offset)
+        : scale_(std::move(scale)), offset_(std::move(offset)) {
+    const size_t n = std::max(scale_.size(), offset_.size());
+    scale_.resize(n, 1.0);
+    offset_.resize(n, 0.0);
+}
+
+AffineTransform AffineTransform::fromRange(const std::vector<double>& min,
+                                           const std::vector<double>& max) {
+    const size_t n = std::min(min.size(), max.size());
+    std::vector<double> scale(n), offset(n);
+    for (size_t d = 0; d < n; d++) {
+        const double range = max[d] - min[d];
+        scale[d] = (range != 0) ? 1 / range : 0;
+        offset[d] = -min[d] * scale[d];
+    }
+    return AffineTransform(scale, offset);
+}
+
+void AffineTransform::operator()(const SampleBlock& block) const {
+    const uint32_t n = std::min<size_t>(block.num_dimensions, scale_.size());
+    const double* __restrict scale = scale_.data();
+    const double* __restrict offset = offset_.data();
+
+    // A simple loop over restrict pointers, which compilers vectorize.
+    for (uint32_t i = 0; i < block.num_samples; i++) {
+        double* __restrict x = block[i];
+        for (uint32_t d = 0; d < n; d++) { x[d] = x[d] * scale[d] + offset[d]; }
+    }
+}
+
+void VectorNormalization::operator()(const SampleBlock& block) const {
+    const uint32_t n = block.num_dimensions;
+    for (uint32_t i = 0; i < block.num_samples; i++) {
+        double* __restrict x = block[i];
+
+        // Four partial sums let the compiler vectorize the reduction without
+        // reassociating floating-point additions itself.
+        double sums[4] = { 0, 0, 0, 0 };
+        uint32_t d = 0;
+        for (; d + 4 <= n; d += 4) {
+            for (uint32_t k = 0; k < 4; k++) { sums[k] += x[d + k] * x[d + k]; }
+        }
+        for (; d < n; d++) { sums[0] += x[d] * x[d]; }
+
+        const double magnitude = sqrt((sums[0] + sums[1]) + (sums[2] + sums[3]));
+        if (magnitude == 0) { continue; }
+        const double inverse = 1 / magnitude;
+        for (d = 0; d < n; d++) { x[d] *= inverse; }
+    }
+}
@@ -0,0 +1,83 @@
+/** @file sample-block.h
+ *  @brief SampleBlock, a view of several samples stored one after the other,
+ *  and built-in normalizers and calibration functions that transform such
+ *  blocks in place.
+ *
+ *  @verbatim
+ *  // Divide each sample by its magnitude (as in user_color_sensor.cpp).
+ *  stream.useBlockNormalizer(VectorNormalization());
+ *
+ *  // Scale each dimension from its range onto [0, 1].
+ *  calibrator.setBlockCalibrateFunction(
+ *      AffineTransform::fromRange({0, 0, 0}, {1023, 1023, 1023}));
+ *  @endverbatim
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <GRT/GRT.h>
+
+/**
+ @brief A block of num_samples samples of num_dimensions values each. Sample
+ i starts `stride` values after sample i - 1.
+ */
+struct SampleBlock {
+    SampleBlock(double* data, uint32_t num_samples, uint32_t num_dimensions,
+                size_t stride)
+            : data(data), num_samples(num_samples), num_dimensions(num_dimensions),
+              stride(stride) {}
+
+    /// @brief A block of samples with nothing between them.
+    SampleBlock(double* data, uint32_t num_samples, uint32_t num_dimensions)
+            : SampleBlock(data, num_samples, num_dimensions, num_dimensions) {}
+
+    double* operator[](uint32_t i) const { return data + i * stride; }
+
+    double* data;
+    uint32_t num_samples;
+    uint32_t num_dimensions;
+    size_t stride;
+};
+
+/// @brief Transforms a block of samples in place.
+typedef std::function<void(const SampleBlock&)> BlockTransformFunc;
+
+/// @brief Apply `f` to every row of `matrix`: in one call if the rows are
+/// evenly spaced in memory, otherwise in one call per row.
+void forEachBlock(GRT::MatrixDouble& matrix, const BlockTransformFunc& f);
+
+/**
+ @brief Scales and offsets each dimension: x[d] = x[d] * scale[d] + offset[d].
+
+ Dimensions beyond the size of `scale` and `offset` are left unchanged.
+ */
+class AffineTransform {
+  public:
+    AffineTransform(std::vector<double> scale, std::vector<double> offset);
+
+    /// @brief The transform mapping [min[d], max[d]] onto [0, 1]. Dimensions
+    /// whose range is empty map to 0.
+    static AffineTransform fromRange(const std::vector<double>& min,
+                                     const std::vector<double>& max);
+
+    void operator()(const SampleBlock& block) const;
+
+  private:
+    std::vector<double> scale_;
+    std::vector<double> offset_;
+};
+
+/**
+ @brief Divides each sample by its magnitude (Euclidean norm), so that only
+ the direction of the sample vector remains. All-zero samples are left as
+ they are.
+ */
+class VectorNormalization {
+  public:
+    void operator()(const SampleBlock& block) const;
+};
@@ -0,0 +1,235 @@
+#include "sample-queue.h"
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <thread>
+
+static const uint32_t kSampleDim = 3;
+static const uint32_t kCapacity = 8;
+
+class SampleQueueTest : public ::testing::Test {
+  protected:
+    virtual void SetUp() {
+        queue.setup(kSampleDim, kCapacity);
+    }
+
+    // Push a single sample whose values are all `value`.
+    bool pushValue(double value) {
+        double sample[kSampleDim] = { value, value, value };
+        return queue.push(sample);
+    }
+
+    SampleQueue queue;
+};
+
+TEST_F(SampleQueueTest, PushAndDrainKeepsOrder) {
+    GRT::MatrixDouble data(3, kSampleDim);
+    for (uint32_t i = 0; i < 3; i++) { data[i][0] = i; }
+
+    ASSERT_EQ(3, queue.push(data));
+    ASSERT_EQ(3, queue.size());
+
+    GRT::MatrixDouble out;
+    ASSERT_EQ(3, queue.drain(out));
+    ASSERT_EQ(3, out.getNumRows());
+    ASSERT_EQ(0, out[0][0]);
+    ASSERT_EQ(1, out[1][0]);
+    ASSERT_EQ(2, out[2][0]);
+    ASSERT_EQ(0, queue.size());
+
+    // Nothing left; the output is emptied.
+    ASSERT_EQ(0, queue.drain(out));
+    ASSERT_EQ(0, out.getNumRows());
+}
+
+TEST_F(SampleQueueTest, WrapsAround) {
+    GRT::MatrixDouble out;
+    for (uint32_t round = 0; round < 5; round++) {
+        for (uint32_t i = 0; i < kCapacity - 1; i++) {
+            ASSERT_TRUE(pushValue(round * 100 + i));
+        }
+        ASSERT_EQ(kCapacity - 1, queue.drain(out));
+        for (uint32_t i = 0; i < kCapacity - 1; i++) {
+            ASSERT_EQ(round * 100 + i, out[i][2]);
+        }
+    }
+    ASSERT_EQ(0, queue.getNumOverflows());
+    ASSERT_EQ(kCapacity - 1, queue.getHighWaterMark());
+}
+
+TEST_F(SampleQueueTest, StampsFollowTheirSamples) {
+    SampleStamp first;
+    first.host_time_us = 1000;
+    first.sequence = 41;
+    GRT::MatrixDouble data(2, kSampleDim);
+    ASSERT_EQ(2, queue.push(data, first));
+
+    GRT::MatrixDouble out;
+    std::vector<SampleStamp> stamps;
+    ASSERT_EQ(2, queue.drain(out, stamps));
+    ASSERT_EQ(2, stamps.size());
+    ASSERT_EQ(41, stamps[0].sequence);
+    ASSERT_EQ(42, stamps[1].sequence);
+    ASSERT_EQ(1000, stamps[1].host_time_us);
+    ASSERT_FALSE(stamps[1].hasDeviceTime());
+
+    ASSERT_EQ(0, queue.drain(out, stamps));
+    ASSERT_EQ(0, stamps.size());
+}
+
+TEST_F(SampleQueueTest, DrainRespectsMaximum) {
+    for (uint32_t i = 0; i < 5; i++) { pushValue(i); }
+
+    GRT::MatrixDouble out;
+    ASSERT_EQ(2, queue.drain(out, 2));
+    ASSERT_EQ(1, out[1][0]);
+    ASSERT_EQ(3, queue.drain(out));
+    ASSERT_EQ(2, out[0][0]);
+}
+
+TEST_F(SampleQueueTest, DropNewestCountsOverflow) {
+    queue.setOverflowPolicy(SampleQueue::DROP_NEWEST);
+    for (uint32_t i = 0; i < kCapacity + 3; i++) { pushValue(i); }
+
+    ASSERT_EQ(kCapacity, queue.size());
+    ASSERT_EQ(3, queue.getNumOverflows());
+    ASSERT_EQ(3, queue.getNumDropped());
+    ASSERT_EQ(kCapacity, queue.getHighWaterMark());
+
+    // The oldest samples are kept.
+    GRT::MatrixDouble out;
+    queue.drain(out);
+    ASSERT_EQ(0, out[0][0]);
+    ASSERT_EQ(kCapacity - 1, out[kCapacity - 1][0]);
+}
+
+TEST_F(SampleQueueTest, RejectsMismatchedDimensions) {
+    GRT::MatrixDouble data(2, kSampleDim + 1);
+    ASSERT_EQ(0, queue.push(data));
+    ASSERT_EQ(2, queue.getNumRejected());
+    ASSERT_EQ(0, queue.size());
+}
+
+TEST_F(SampleQueueTest, ClearDiscardsQueuedSamples) {
+    pushValue(1);
+    pushValue(2);
+    queue.clear();
+    ASSERT_EQ(0, queue.size());
+
+    pushValue(3);
+    GRT::MatrixDouble out;
+    ASSERT_EQ(1, queue.drain(out));
+    ASSERT_EQ(3, out[0][0]);
+}
+
+TEST_F(SampleQueueTest, BlockingProducerLosesNothing) {
+    const uint32_t kNumSamples = 10000;
+    std::thread producer([this, kNumSamples]() {
+        for (uint32_t i = 0; i < kNumSamples; i++) { pushValue(i); }
+    });
+
+    uint32_t expected = 0;
+    GRT::MatrixDouble out;
+    while (expected < kNumSamples) {
+        uint32_t n = queue.drain(out);
+        for (uint32_t i = 0; i < n; i++) {
+            ASSERT_EQ(expected, out[i][0]);
+            expected++;
+        }
+    }
+    producer.join();
+
+    ASSERT_EQ(0, queue.getNumDropped());
+    ASSERT_LE(queue.getHighWaterMark(), kCapacity);
+}
+
+TEST_F(SampleQueueTest, WaitForDataWakesOnPush) {
+    ASSERT_FALSE(queue.waitForData(1000));
+
+    std::thread producer([this]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        pushValue(1);
+    });
+    ASSERT_TRUE(queue.waitForData(10 * 1000 * 1000));
+    ASSERT_EQ(1, queue.size());
+    producer.join();
+}
+
+TEST_F(SampleQueueTest, CloseReleasesBlockedProducer) {
+    for (uint32_t i = 0; i < kCapacity; i++) { pushValue(i); }
+
+    bool pushed = true;
+    std::thread producer([this, &pushed]() { pushed = pushValue(-1); });
+    queue.close();
+    producer.join();
+
+    ASSERT_FALSE(pushed);
+    ASSERT_EQ(1, queue.getNumDropped());
+}
+
+TEST_F(SampleQueueTest, DropOldestKeepsNewest) {
+    queue.setOverflowPolicy(SampleQueue::DROP_OLDEST);
+    for (uint32_t i = 0; i < kCapacity + 3; i++) { ASSERT_TRUE(pushValue(i)); }
+    ASSERT_EQ(3, queue.getNumDiscarded(SampleQueue::DROP_OLDEST));
+    ASSERT_EQ(3, queue.getNumDropped());
+
+    GRT::MatrixDouble out;
+    ASSERT_EQ(kCapacity, queue.drain(out));
+    for (uint32_t i = 0; i < kCapacity; i++) { ASSERT_EQ(i + 3, out[i][0]); }
+}
+
+TEST_F(SampleQueueTest, DropOldestWhileDraining) {
+    static const uint32_t kNumSamples = 100000;
+    queue.setOverflowPolicy(SampleQueue::DROP_OLDEST);
+    std::thread producer([this]() {
+        for (uint32_t i = 0; i < kNumSamples; i++) { pushValue(i); }
+    });
+
+    // Whatever is dropped, the rest arrives in order and intact.
+    double last = -1;
+    uint64_t received = 0;
+    GRT::MatrixDouble out;
+    while (last < kNumSamples - 1) {
+        uint32_t n = queue.drain(out);
+        for (uint32_t i = 0; i < n; i++) {
+            ASSERT_GT(out[i][0], last);
+            ASSERT_EQ(out[i][0], out[i][2]);
+            last = out[i][0];
+        }
+        received += n;
+    }
+    producer.join();
+    ASSERT_EQ(kNumSamples, received + queue.getNumDiscarded(SampleQueue::DROP_OLDEST));
+}
+
+TEST_F(SampleQueueTest, DecimatesOnlyWhenBackedUp) {
+    queue.setOverflowPolicy(SampleQueue::DECIMATE, 2);
+    // The first 6 (3/4 of the capacity) go in as they are; after that every
+    // other sample is kept.
+    for (uint32_t i = 0; i < 10; i++) { pushValue(i); }
+    ASSERT_EQ(8, queue.size());
+    ASSERT_EQ(2, queue.getNumDiscarded(SampleQueue::DECIMATE));
+
+    GRT::MatrixDouble out;
+    queue.drain(out);
+    ASSERT_EQ(6, out[6][0]);
+    ASSERT_EQ(8, out[7][0]);
+
+    // Drained: back to every sample.
+    pushValue(10);
+    pushValue(11);
+    ASSERT_EQ(2, queue.size());
+}
+
+TEST_F(SampleQueueTest, CoalesceAveragesGroups) {
+    queue.setOverflowPolicy(SampleQueue::COALESCE, 3);
+    for (uint32_t i = 0; i < 6; i++) { pushValue(0); }
+    for (uint32_t i = 0; i < 6; i++) { pushValue(i); }
+    ASSERT_EQ(8, queue.size());
+    ASSERT_EQ(4, queue.getNumDiscarded(SampleQueue::COALESCE));
+
+    GRT::MatrixDouble out;
+    queue.drain(out);
+    ASSERT_EQ(1, out[6][0]);  // average of 0, 1, 2
+    ASSERT_EQ(4, out[7][0]);  // average of 3, 4, 5
+}
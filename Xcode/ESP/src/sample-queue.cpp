@@ -0,0 +1,257 @@
+#include "sample-queue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+// How long a blocked producer sleeps between checks for free space.
+static const std::chrono::microseconds kBlockedProducerBackoff(200);
+
+// How long a waiting consumer sleeps between checks for new samples. This
+// bounds the latency waitForData() adds.
+static const std::chrono::microseconds kIdleConsumerBackoff(100);
+
+static uint32_t roundUpToPowerOfTwo(uint32_t n) {
+    uint32_t p = 1;
+    while (p < n) { p <<= 1; }
+    return p;
+}
+
+SampleQueue::SampleQueue()
+        : num_dimensions_(0), capacity_(0), mask_(0), policy_(BLOCK), factor_(2),
+          head_(0), released_(0), tail_(0), closed_(false),
+          is_reducing_(false), reduce_count_(0),
+          num_overflows_(0), num_rejected_(0), high_water_mark_(0) {
+    for (auto& n : num_discarded_) { n.store(0); }
+}
+
+bool SampleQueue::setup(uint32_t num_dimensions, uint32_t capacity) {
+    if (num_dimensions == 0 || capacity == 0) { return false; }
+
+    num_dimensions_ = num_dimensions;
+    capacity_ = roundUpToPowerOfTwo(capacity);
+    mask_ = capacity_ - 1;
+    storage_.assign(static_cast<size_t>(capacity_) * num_dimensions_, 0.0);
+    stamps_.assign(capacity_, SampleStamp());
+    coalesce_sum_.assign(num_dimensions_, 0.0);
+
+    head_.store(0);
+    released_.store(0);
+    tail_.store(0);
+    closed_.store(false);
+    is_reducing_ = false;
+    reduce_count_ = 0;
+    resetCounters();
+    return true;
+}
+
+void SampleQueue::setOverflowPolicy(OverflowPolicy policy, uint32_t factor) {
+    policy_ = policy;
+    factor_ = std::max(2u, factor);
+}
+
+bool SampleQueue::dropOldest() {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    if (head != released_.load(std::memory_order_acquire) ||
+        !head_.compare_exchange_strong(head, head + 1)) {
+        return false;
+    }
+    // A drain may already have claimed and released the following samples,
+    // in which case released_ is past this one and must stay there.
+    released_.compare_exchange_strong(head, head + 1);
+    num_discarded_[DROP_OLDEST]++;
+    return true;
+}
+
+bool SampleQueue::waitForSlot(uint64_t tail) {
+    if (tail - released_.load(std::memory_order_acquire) < capacity_) {
+        return true;
+    }
+
+    num_overflows_++;
+    if (policy_ == DROP_NEWEST) { return false; }
+
+    while (!closed_.load(std::memory_order_relaxed)) {
+        if (policy_ == DROP_OLDEST) {
+            // Only fails while a drain is copying, which is brief.
+            if (dropOldest()) { return true; }
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(kBlockedProducerBackoff);
+        }
+        if (tail - released_.load(std::memory_order_acquire) < capacity_) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SampleQueue::push(const double* sample, const SampleStamp& stamp) {
+    if (capacity_ == 0) { return false; }
+    if (policy_ == DECIMATE || policy_ == COALESCE) {
+        return pushReduced(sample, stamp);
+    }
+    return pushSlot(sample, stamp);
+}
+
+bool SampleQueue::pushReduced(const double* sample, const SampleStamp& stamp) {
+    const uint32_t queued = tail_.load(std::memory_order_relaxed) -
+        head_.load(std::memory_order_acquire);
+    if (!is_reducing_ && queued >= capacity_ / 4 * 3) {
+        is_reducing_ = true;
+        reduce_count_ = 0;
+    } else if (is_reducing_ && queued <= capacity_ / 4) {
+        flushCoalesced();
+        is_reducing_ = false;
+    }
+    if (!is_reducing_) { return pushSlot(sample, stamp); }
+
+    if (policy_ == DECIMATE) {
+        if (reduce_count_++ % factor_ != 0) {
+            num_discarded_[DECIMATE]++;
+            return false;
+        }
+        return pushSlot(sample, stamp);
+    }
+
+    if (reduce_count_ == 0) {
+        std::copy(sample, sample + num_dimensions_, coalesce_sum_.begin());
+        coalesce_stamp_ = stamp;
+    } else {
+        for (uint32_t i = 0; i < num_dimensions_; i++) { coalesce_sum_[i] += sample[i]; }
+    }
+    if (++reduce_count_ == factor_) { flushCoalesced(); }
+    return true;
+}
+
+void SampleQueue::flushCoalesced() {
+    if (reduce_count_ == 0 || policy_ != COALESCE) { return; }
+    for (double& v : coalesce_sum_) { v /= reduce_count_; }
+    num_discarded_[COALESCE] += reduce_count_ - 1;
+    reduce_count_ = 0;
+    pushSlot(coalesce_sum_.data(), coalesce_stamp_);
+}
+
+bool SampleQueue::pushSlot(const double* sample, const SampleStamp& stamp) {
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (!waitForSlot(tail)) {
+        num_discarded_[DROP_NEWEST]++;
+        return false;
+    }
+
+    double* slot = &storage_[(tail & mask_) * num_dimensions_];
+    std::memcpy(slot, sample, sizeof(double) * num_dimensions_);
+    stamps_[tail & mask_] = stamp;
+    tail_.store(tail + 1, std::memory_order_release);
+
+    uint32_t queued = tail + 1 - head_.load(std::memory_order_acquire);
+    if (queued > high_water_mark_.load(std::memory_order_relaxed)) {
+        high_water_mark_.store(queued, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+uint32_t SampleQueue::push(const GRT::MatrixDouble& data, const SampleStamp& first) {
+    if (data.getNumRows() == 0) { return 0; }
+    if (data.getNumCols() != num_dimensions_) {
+        num_rejected_ += data.getNumRows();
+        return 0;
+    }
+
+    uint32_t pushed = 0;
+    SampleStamp stamp = first;
+    for (uint32_t i = 0; i < data.getNumRows(); i++, stamp.sequence++) {
+        if (push(data[i], stamp)) { pushed++; }
+    }
+    return pushed;
+}
+
+uint32_t SampleQueue::drain(GRT::MatrixDouble& out, uint32_t max_samples) {
+    return drain(out, nullptr, max_samples);
+}
+
+uint32_t SampleQueue::drain(GRT::MatrixDouble& out,
+                            std::vector<SampleStamp>& stamps,
+                            uint32_t max_samples) {
+    return drain(out, &stamps, max_samples);
+}
+
+uint32_t SampleQueue::drain(GRT::MatrixDouble& out,
+                            std::vector<SampleStamp>* stamps,
+                            uint32_t max_samples) {
+    // Claim the samples to copy. This only fails if the producer dropped
+    // the oldest sample meanwhile.
+    uint64_t head, tail;
+    uint32_t n;
+    do {
+        head = head_.load(std::memory_order_acquire);
+        tail = tail_.load(std::memory_order_acquire);
+        n = std::min<uint64_t>(tail - head, max_samples);
+    } while (n > 0 && !head_.compare_exchange_weak(head, head + n));
+
+    if (stamps != nullptr) { stamps->resize(n); }
+    if (n == 0) {
+        out.clear();
+        return 0;
+    }
+
+    if (out.getNumRows() != n || out.getNumCols() != num_dimensions_) {
+        out.resize(n, num_dimensions_);
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        const double* slot = &storage_[((head + i) & mask_) * num_dimensions_];
+        std::memcpy(out[i], slot, sizeof(double) * num_dimensions_);
+        if (stamps != nullptr) { (*stamps)[i] = stamps_[(head + i) & mask_]; }
+    }
+
+    released_.store(head + n, std::memory_order_release);
+    return n;
+}
+
+void SampleQueue::clear() {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t tail;
+    do {
+        tail = tail_.load(std::memory_order_acquire);
+    } while (!head_.compare_exchange_weak(head, tail));
+    released_.store(tail, std::memory_order_release);
+}
+
+void SampleQueue::close() {
+    closed_.store(true);
+}
+
+void SampleQueue::reopen() {
+    closed_.store(false);
+}
+
+bool SampleQueue::waitForData(uint32_t timeout_us) {
+    const auto deadline = std::chrono::steady_clock::now() +
+        std::chrono::microseconds(timeout_us);
+    while (size() == 0) {
+        if (std::chrono::steady_clock::now() >= deadline) { return false; }
+        std::this_thread::sleep_for(kIdleConsumerBackoff);
+    }
+    return true;
+}
+
+uint32_t SampleQueue::size() const {
+    // Read head_ first so that a drain racing with this call can't make the
+    // result negative.
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    return tail_.load(std::memory_order_acquire) - head;
+}
+
+uint64_t SampleQueue::getNumDropped() const {
+    uint64_t n = 0;
+    for (const auto& discarded : num_discarded_) { n += discarded.load(); }
+    return n;
+}
+
+void SampleQueue::resetCounters() {
+    num_overflows_.store(0);
+    for (auto& n : num_discarded_) { n.store(0); }
+    num_rejected_.store(0);
+    high_water_mark_.store(0);
+}
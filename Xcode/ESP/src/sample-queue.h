@@ -0,0 +1,185 @@
+/** @file sample-queue.h
+ *  @brief SampleQueue, a bounded single-producer/single-consumer queue that
+ *  hands sensor samples from an input stream thread to the thread running the
+ *  pipeline.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <GRT/GRT.h>
+
+#include "sample-stamp.h"
+
+/**
+ *  @brief SampleQueue stores rows of sensor data (one row per sample) in a
+ *  fixed ring buffer allocated at setup time.
+ *
+ *  Exactly one thread may push (the producer, typically an IStream's reading
+ *  thread or callback) and exactly one thread may drain (the consumer,
+ *  typically the GUI thread). Neither side takes a lock.
+ *
+ *  The queue never drops data unless the overflow policy says so. With the
+ *  default policy (BLOCK), a producer that finds the queue full waits until
+ *  the consumer makes room or the queue is closed.
+ */
+class SampleQueue {
+  public:
+    /**
+     What to do when samples arrive faster than the consumer drains them.
+
+     DECIMATE and COALESCE kick in once the queue is 3/4 full and stay on
+     until it's back down to 1/4, so that the consumer sees a steady reduced
+     rate rather than bursts. If the queue fills up even so, the producer
+     waits as with BLOCK.
+     */
+    enum OverflowPolicy {
+        BLOCK,        // The producer waits until there is room.
+        DROP_OLDEST,  // The oldest queued sample makes room for the new one.
+        DROP_NEWEST,  // Samples that don't fit are discarded.
+        DECIMATE,     // Keep one sample in every `factor`.
+        COALESCE,     // Queue the average of every `factor` samples, stamped
+                      // like the first of them.
+    };
+    static const int kNumOverflowPolicies = 5;
+
+    SampleQueue();
+
+    /// @brief Allocate room for `capacity` samples of `num_dimensions` each.
+    /// The capacity is rounded up to a power of two. Not thread-safe: call
+    /// before the producer starts.
+    bool setup(uint32_t num_dimensions, uint32_t capacity);
+
+    /// @brief Set the overflow policy; `factor` (at least 2) is used by
+    /// DECIMATE and COALESCE. Not thread-safe: call before the producer starts.
+    void setOverflowPolicy(OverflowPolicy policy, uint32_t factor = 2);
+    OverflowPolicy getOverflowPolicy() const { return policy_; }
+    uint32_t getOverflowFactor() const { return factor_; }
+
+    // =================================================
+    //  Producer side
+    // =================================================
+
+    /// @brief Push every row of `data`. Returns the number of rows queued.
+    /// Rows whose width doesn't match the queue are rejected. Row i is
+    /// stamped like `first`, with its sequence number advanced by i.
+    uint32_t push(const GRT::MatrixDouble& data,
+                  const SampleStamp& first = SampleStamp());
+
+    /// @brief Push a single sample of getNumDimensions() values. Returns
+    /// false if it was discarded. With COALESCE, a sample may be held back
+    /// to be averaged with the next ones.
+    bool push(const double* sample, const SampleStamp& stamp = SampleStamp());
+
+    // =================================================
+    //  Consumer side
+    // =================================================
+
+    /// @brief Move up to `max_samples` queued samples into `out`, one per row.
+    /// Returns the number of samples moved.
+    uint32_t drain(GRT::MatrixDouble& out, uint32_t max_samples = UINT32_MAX);
+
+    /// @brief As above, and also move the samples' stamps into `stamps`.
+    uint32_t drain(GRT::MatrixDouble& out, std::vector<SampleStamp>& stamps,
+                   uint32_t max_samples = UINT32_MAX);
+
+    /// @brief Wait until at least one sample is queued, or `timeout_us`
+    /// microseconds have passed. Returns whether there's anything to drain.
+    /// The producer stays lock-free: the consumer polls with a short backoff.
+    bool waitForData(uint32_t timeout_us);
+
+    /// @brief Discard everything currently queued.
+    void clear();
+
+    /// @brief Release a producer blocked on a full queue; further pushes
+    /// behave as DROP_NEWEST. Used when shutting down.
+    void close();
+
+    /// @brief Undo close(), so that pushes wait for room again.
+    void reopen();
+
+    // =================================================
+    //  Status and counters (readable from any thread)
+    // =================================================
+
+    uint32_t size() const;
+    uint32_t getCapacity() const { return capacity_; }
+    uint32_t getNumDimensions() const { return num_dimensions_; }
+
+    /// @brief Number of times a push found the queue full.
+    uint64_t getNumOverflows() const { return num_overflows_.load(); }
+
+    /// @brief Number of samples discarded because of the overflow policy.
+    uint64_t getNumDropped() const;
+
+    /// @brief Number of samples discarded by the given policy. For COALESCE,
+    /// that's the samples merged into others. Samples pushed after close()
+    /// count as DROP_NEWEST.
+    uint64_t getNumDiscarded(OverflowPolicy policy) const {
+        return num_discarded_[policy].load();
+    }
+
+    /// @brief Number of rows rejected because of a dimension mismatch.
+    uint64_t getNumRejected() const { return num_rejected_.load(); }
+
+    /// @brief The largest number of samples queued at once.
+    uint32_t getHighWaterMark() const { return high_water_mark_.load(); }
+
+    void resetCounters();
+
+  private:
+    // Queue one sample, applying BLOCK, DROP_OLDEST or DROP_NEWEST.
+    bool pushSlot(const double* sample, const SampleStamp& stamp);
+
+    // Queue one sample under DECIMATE or COALESCE.
+    bool pushReduced(const double* sample, const SampleStamp& stamp);
+    void flushCoalesced();
+
+    // Wait (or not, depending on the policy) until one slot is free. Returns
+    // false if the sample should be dropped.
+    bool waitForSlot(uint64_t tail);
+
+    // Discard the oldest queued sample, unless the consumer is draining.
+    bool dropOldest();
+
+    uint32_t drain(GRT::MatrixDouble& out, std::vector<SampleStamp>* stamps,
+                   uint32_t max_samples);
+
+    uint32_t num_dimensions_;
+    uint32_t capacity_;
+    uint64_t mask_;
+    OverflowPolicy policy_;
+    uint32_t factor_;
+
+    // Flat storage: slot i occupies [i * num_dimensions_, (i + 1) * ...).
+    std::vector<double> storage_;
+    std::vector<SampleStamp> stamps_;
+
+    // Monotonically increasing indices. tail_ is written only by the
+    // producer. The consumer claims samples by moving head_ and frees their
+    // slots by moving released_ once they're copied. The producer may also
+    // move both past one sample to drop it (DROP_OLDEST), but only while
+    // they're equal, i.e. no drain is in progress.
+    std::atomic<uint64_t> head_;
+    std::atomic<uint64_t> released_;
+    std::atomic<uint64_t> tail_;
+    std::atomic<bool> closed_;
+
+    // Producer-only state of DECIMATE and COALESCE.
+    bool is_reducing_;
+    uint32_t reduce_count_;
+    std::vector<double> coalesce_sum_;
+    SampleStamp coalesce_stamp_;
+
+    std::atomic<uint64_t> num_overflows_;
+    std::atomic<uint64_t> num_discarded_[kNumOverflowPolicies];
+    std::atomic<uint64_t> num_rejected_;
+    std::atomic<uint32_t> high_water_mark_;
+
+    // Disallow copy and assign
+    SampleQueue(SampleQueue&) = delete;
+    void operator=(SampleQueue) = delete;
+};
@@ -0,0 +1,88 @@
+#include "sample-scorer.h"
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <thread>
+
+// A KNN model of two classes of 1-dimensional samples: label 1's values are
+// near 0 and label 2's near 1.
+static std::unique_ptr<GRT::GestureRecognitionPipeline> makeTrainedModel() {
+    GRT::TimeSeriesClassificationData data(1);
+    GRT::MatrixDouble sample(4, 1);
+    for (uint32_t label = 1; label <= 2; label++) {
+        for (uint32_t i = 0; i < 3; i++) {
+            for (uint32_t j = 0; j < 4; j++) { sample[j][0] = (label - 1) + 0.01 * (i + j); }
+            data.addSample(label, sample);
+        }
+    }
+
+    std::unique_ptr<GRT::GestureRecognitionPipeline> model(
+        new GRT::GestureRecognitionPipeline());
+    model->setClassifier(GRT::KNN(3));
+    if (!model->train(data)) { return nullptr; }
+    return model;
+}
+
+// A sample like those of label 1.
+static GRT::MatrixDouble makeSample() {
+    GRT::MatrixDouble sample(4, 1);
+    for (uint32_t j = 0; j < 4; j++) { sample[j][0] = 0.005 + 0.01 * j; }
+    return sample;
+}
+
+// Waits for num_scores scores.
+static std::vector<SampleScorer::Score> waitForScores(SampleScorer& scorer,
+                                                      size_t num_scores) {
+    std::vector<SampleScorer::Score> scores;
+    for (int i = 0; i < 1000 && scores.size() < num_scores; i++) {
+        std::vector<SampleScorer::Score> more = scorer.takeScores();
+        scores.insert(scores.end(), more.begin(), more.end());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return scores;
+}
+
+TEST(SampleScorerTest, NoModelNoScores) {
+    SampleScorer scorer;
+    GRT::MatrixDouble sample(4, 2);
+
+    EXPECT_FALSE(scorer.add(1, 1, sample, 3));
+    EXPECT_TRUE(scorer.takeScores().empty());
+}
+
+TEST(SampleScorerTest, ScoresComeBackInOrder) {
+    SampleScorer scorer;
+    std::unique_ptr<GRT::GestureRecognitionPipeline> model = makeTrainedModel();
+    ASSERT_NE(nullptr, model);
+    scorer.setModel(std::move(model));
+
+    const GRT::MatrixDouble sample = makeSample();
+    for (uint64_t id = 1; id <= 5; id++) {
+        ASSERT_TRUE(scorer.add(id, 1, sample, 2));
+    }
+
+    std::vector<SampleScorer::Score> scores = waitForScores(scorer, 5);
+    ASSERT_EQ(5, scores.size());
+    for (uint64_t i = 0; i < scores.size(); i++) {
+        EXPECT_EQ(i + 1, scores[i].id);
+        EXPECT_EQ(1, scores[i].label);
+        EXPECT_EQ(3, scores[i].likelihoods.size());
+    }
+}
+
+TEST(SampleScorerTest, MislabelledSamplesScoreHigher) {
+    SampleScorer scorer;
+    std::unique_ptr<GRT::GestureRecognitionPipeline> model = makeTrainedModel();
+    ASSERT_NE(nullptr, model);
+    scorer.setModel(std::move(model));
+
+    const GRT::MatrixDouble sample = makeSample();
+    ASSERT_TRUE(scorer.add(1, 1, sample, 2));  // its own class
+    ASSERT_TRUE(scorer.add(2, 2, sample, 2));  // mislabelled
+
+    std::vector<SampleScorer::Score> scores = waitForScores(scorer, 2);
+    ASSERT_EQ(2, scores.size());
+    EXPECT_NEAR(0, scores[0].information_gain, 1e-6);
+    EXPECT_LT(scores[0].information_gain, scores[1].information_gain);
+    EXPECT_GT(scores[0].likelihoods[1], scores[0].likelihoods[2]);
+}
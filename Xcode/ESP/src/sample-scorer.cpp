@@ -0,0 +1,89 @@
+#include "sample-scorer.h"
+
+#include <cmath>
+
+#include "block-prediction.h"
+
+SampleScorer::SampleScorer() : thread_(&SampleScorer::run, this) {
+}
+
+SampleScorer::~SampleScorer() {
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        should_stop_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+void SampleScorer::setModel(std::unique_ptr<GRT::GestureRecognitionPipeline> model) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    has_model_ = model != nullptr;
+    if (!has_model_) { pending_.clear(); }
+    next_model_ = std::move(model);
+}
+
+bool SampleScorer::add(uint64_t id, uint32_t label, const GRT::MatrixDouble& sample,
+                       uint32_t num_labels) {
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (!has_model_) { return false; }
+        pending_.push_back(Pending{ id, label, num_labels, sample });
+    }
+    wake_.notify_one();
+    return true;
+}
+
+std::vector<SampleScorer::Score> SampleScorer::takeScores() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    std::vector<Score> scores;
+    scores.swap(scores_);
+    return scores;
+}
+
+void SampleScorer::run() {
+    std::unique_ptr<GRT::GestureRecognitionPipeline> model;
+    std::vector<Pending> batch;
+    BlockPrediction prediction;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this]() { return should_stop_ || !pending_.empty(); });
+            if (should_stop_) { return; }
+            // Take everything recorded since the last batch, and the model
+            // to score it against if it has changed.
+            batch.swap(pending_);
+            if (next_model_ != nullptr) { model = std::move(next_model_); }
+        }
+
+        std::vector<Score> scores;
+        for (const Pending& pending : batch) {
+            Score score;
+            score.id = pending.id;
+            score.label = pending.label;
+            score.likelihoods = predictSampleLikelihoods(
+                *model, pending.sample, pending.num_labels, &prediction);
+
+            // Unlike score.likelihoods, the gain averages the likelihoods of
+            // label over the rows the model had an opinion about.
+            double sum = 0.0;
+            uint32_t num_non_zero = 0;
+            for (uint32_t i = 0; i < prediction.is_valid.size(); i++) {
+                bool non_zero = false;
+                for (uint32_t k = 0; k < prediction.class_labels.size(); k++) {
+                    const double likelihood = prediction.likelihoods[i][k];
+                    if (likelihood > 1e-9) { non_zero = true; }
+                    if (prediction.class_labels[k] == pending.label) { sum += likelihood; }
+                }
+                if (non_zero) { num_non_zero++; }
+            }
+            score.information_gain = num_non_zero == 0 ? 0 : -log(sum / num_non_zero);
+            scores.push_back(std::move(score));
+        }
+        batch.clear();
+
+        std::lock_guard<std::mutex> guard(mutex_);
+        scores_.insert(scores_.end(), scores.begin(), scores.end());
+    }
+}
@@ -0,0 +1,75 @@
+/** @file sample-scorer.h
+ *  @brief SampleScorer, which scores newly recorded training samples against
+ *  a snapshot of the trained model, on a thread of its own.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <GRT/GRT.h>
+
+class SampleScorer {
+  public:
+    struct Score {
+        uint64_t id = 0;  ///< as passed to add()
+        uint32_t label = 0;
+
+        /// @brief How poorly the model predicts label for the sample:
+        /// -log of its mean likelihood over the rows the model gave any
+        /// likelihood to. 0 means the model already knows the sample.
+        double information_gain = 0;
+
+        /// @brief As from predictSampleLikelihoods().
+        std::vector<double> likelihoods;
+    };
+
+    SampleScorer();
+    ~SampleScorer();
+
+    /**
+     @brief Sets the model to score against, which must be trained (or
+     nullptr, to stop scoring). Samples still waiting are scored against it.
+     */
+    void setModel(std::unique_ptr<GRT::GestureRecognitionPipeline> model);
+
+    /**
+     @brief Queues sample, labelled label, to be scored. Returns false if
+     there's no model to score it against.
+     */
+    bool add(uint64_t id, uint32_t label, const GRT::MatrixDouble& sample,
+             uint32_t num_labels);
+
+    /// @brief The scores finished since the last call, oldest first.
+    std::vector<Score> takeScores();
+
+  private:
+    struct Pending {
+        uint64_t id;
+        uint32_t label;
+        uint32_t num_labels;
+        GRT::MatrixDouble sample;
+    };
+
+    void run();
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool should_stop_ = false;
+    bool has_model_ = false;
+    // Handed to the worker with the next batch; it then owns it.
+    std::unique_ptr<GRT::GestureRecognitionPipeline> next_model_;
+    std::vector<Pending> pending_;
+    std::vector<Score> scores_;
+
+    std::thread thread_;
+
+    // Disallow copy and assign
+    SampleScorer(SampleScorer&) = delete;
+    void operator=(SampleScorer) = delete;
+};
@@ -0,0 +1,52 @@
+/** @file sample-stamp.h
+ *  @brief SampleStamp, the capture time and sequence number that travel with
+ *  every sample from its input stream to the output streams.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+/**
+ @brief When, and in what order, a sample was captured.
+
+ Each IStream numbers its samples consecutively, so a gap in the sequence
+ numbers seen downstream means samples were lost on the way. Host times come
+ from a monotonic clock (see getMonotonicMicros()) and are only comparable
+ with each other, not with wall-clock time.
+ */
+struct SampleStamp {
+    // Value of device_time_us for streams whose framing carries no device
+    // clock.
+    static const int64_t kNoDeviceTime = INT64_MIN;
+
+    // When the sample reached the host, in microseconds.
+    uint64_t host_time_us = 0;
+
+    // When the first byte of the sample was read, in microseconds, for
+    // streams that put samples together from bytes (0 for the others). It's
+    // earlier than host_time_us by however long the stream buffered them.
+    uint64_t arrival_time_us = 0;
+
+    // Position of the sample in its stream, starting at 0.
+    uint64_t sequence = 0;
+
+    // When the device says it took the sample, in the device's own
+    // microsecond clock, or kNoDeviceTime.
+    int64_t device_time_us = kNoDeviceTime;
+
+    bool hasDeviceTime() const { return device_time_us != kNoDeviceTime; }
+
+    uint64_t getArrivalTime() const {
+        return arrival_time_us != 0 ? arrival_time_us : host_time_us;
+    }
+};
+
+/// @brief Microseconds since an arbitrary fixed point, from a clock that
+/// never goes backwards.
+inline uint64_t getMonotonicMicros() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(
+        steady_clock::now().time_since_epoch()).count();
+}
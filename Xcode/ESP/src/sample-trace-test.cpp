@@ -0,0 +1,41 @@
+#include "sample-trace.h"
+#include "gtest/gtest.h"
+
+static SampleTrace makeTrace(uint64_t sequence, uint64_t duration_us) {
+    SampleTrace trace;
+    trace.sequence = sequence;
+    trace.arrival_us = 1000;
+    trace.emitted_us = 1000 + duration_us / 4;
+    trace.dequeued_us = 1000 + duration_us / 2;
+    trace.predicted_us = 1000 + 3 * duration_us / 4;
+    trace.output_us = 1000 + duration_us;
+    return trace;
+}
+
+TEST(SampleTracerTest, KeepsTheSlowestTraces) {
+    SampleTracer tracer(3);
+    const uint64_t durations[] = { 50, 10, 40, 30, 20, 60 };
+    for (uint64_t i = 0; i < 6; i++) { tracer.add(makeTrace(i, durations[i])); }
+
+    std::vector<SampleTrace> slowest = tracer.getSlowest();
+    ASSERT_EQ(3, slowest.size());
+    EXPECT_EQ(5, slowest[0].sequence);
+    EXPECT_EQ(0, slowest[1].sequence);
+    EXPECT_EQ(2, slowest[2].sequence);
+
+    tracer.reset();
+    EXPECT_TRUE(tracer.getSlowest().empty());
+}
+
+TEST(SampleTracerTest, ExportsASpanPerStep) {
+    SampleTracer tracer;
+    tracer.add(makeTrace(7, 400));
+
+    std::string json = tracer.toChromeTrace();
+    EXPECT_NE(std::string::npos, json.find("\"traceEvents\""));
+    EXPECT_NE(std::string::npos, json.find("sample 7"));
+    for (const char* step : { "read", "queue", "pipeline", "output" }) {
+        EXPECT_NE(std::string::npos, json.find("\"name\": \"" + std::string(step) + "\""));
+    }
+    EXPECT_NE(std::string::npos, json.find("\"ts\": 1100, \"dur\": 100"));
+}
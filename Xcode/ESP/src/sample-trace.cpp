@@ -0,0 +1,82 @@
+#include "sample-trace.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+static bool isFaster(const SampleTrace& a, const SampleTrace& b) {
+    return a.getDuration() > b.getDuration();
+}
+
+SampleTracer::SampleTracer(uint32_t max_traces) : max_traces_(max_traces) {
+}
+
+void SampleTracer::add(const SampleTrace& trace) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (traces_.size() < max_traces_) {
+        traces_.push_back(trace);
+        std::push_heap(traces_.begin(), traces_.end(), isFaster);
+    } else if (!traces_.empty() && trace.getDuration() > traces_.front().getDuration()) {
+        // Replace the fastest one kept.
+        std::pop_heap(traces_.begin(), traces_.end(), isFaster);
+        traces_.back() = trace;
+        std::push_heap(traces_.begin(), traces_.end(), isFaster);
+    }
+}
+
+std::vector<SampleTrace> SampleTracer::getSlowest() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<SampleTrace> traces = traces_;
+    lock.unlock();
+
+    std::sort(traces.begin(), traces.end(), isFaster);
+    return traces;
+}
+
+void SampleTracer::reset() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    traces_.clear();
+}
+
+// A complete ("X") event on row `tid`.
+static void writeSpan(std::ostringstream& json, const char* name, uint32_t tid,
+                      uint64_t begin_us, uint64_t end_us, bool* is_first) {
+    if (end_us < begin_us) { end_us = begin_us; }
+    json << (*is_first ? "\n" : ",\n")
+         << "  {\"name\": \"" << name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+         << tid << ", \"ts\": " << begin_us << ", \"dur\": " << end_us - begin_us << "}";
+    *is_first = false;
+}
+
+std::string SampleTracer::toChromeTrace() const {
+    const std::vector<SampleTrace> traces = getSlowest();
+
+    std::ostringstream json;
+    bool is_first = true;
+    json << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    for (uint32_t i = 0; i < traces.size(); i++) {
+        const SampleTrace& t = traces[i];
+        const uint32_t tid = i + 1;
+
+        // Name the row after the sample.
+        json << (is_first ? "\n" : ",\n")
+             << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << tid
+             << ", \"args\": {\"name\": \"sample " << t.sequence << " (label " << t.label
+             << ", " << t.getDuration() / 1000.0 << " ms)\"}}";
+        is_first = false;
+
+        writeSpan(json, "read", tid, t.arrival_us, t.emitted_us, &is_first);
+        writeSpan(json, "queue", tid, t.emitted_us, t.dequeued_us, &is_first);
+        writeSpan(json, "pipeline", tid, t.dequeued_us, t.predicted_us, &is_first);
+        writeSpan(json, "output", tid, t.predicted_us, t.output_us, &is_first);
+    }
+    json << "\n]}\n";
+    return json.str();
+}
+
+bool SampleTracer::saveChromeTrace(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file) { return false; }
+    file << toChromeTrace();
+    return file.good();
+}
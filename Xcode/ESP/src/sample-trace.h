@@ -0,0 +1,62 @@
+/** @file sample-trace.h
+ *  @brief SampleTrace, the times one sample passed each point on its way from
+ *  the input stream to the output streams, and SampleTracer, which keeps the
+ *  slowest ones for viewing in Chrome's trace viewer (chrome://tracing or
+ *  https://ui.perfetto.dev).
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ @brief When a sample passed each point of live processing, in microseconds
+ from getMonotonicMicros().
+ */
+struct SampleTrace {
+    uint64_t sequence = 0;
+    uint32_t label = 0;
+
+    uint64_t arrival_us = 0;    ///< its first byte was read (or it was captured)
+    uint64_t emitted_us = 0;    ///< the input stream queued it
+    uint64_t dequeued_us = 0;   ///< the processing thread took it off the queue
+    uint64_t predicted_us = 0;  ///< the pipeline was done with it (and its block)
+    uint64_t output_us = 0;     ///< every output stream's onReceive() returned
+
+    uint64_t getDuration() const { return output_us - arrival_us; }
+};
+
+/**
+ @brief Keeps the slowest traces added to it, up to a limit. add() can be
+ called on one thread while others read.
+ */
+class SampleTracer {
+  public:
+    static const uint32_t kDefaultMaxTraces = 64;
+
+    explicit SampleTracer(uint32_t max_traces = kDefaultMaxTraces);
+
+    void add(const SampleTrace& trace);
+
+    /// @brief The traces kept, slowest first.
+    std::vector<SampleTrace> getSlowest() const;
+
+    void reset();
+
+    /**
+     @brief The traces kept as Chrome trace-event JSON: one row per sample,
+     slowest first, with a span for each step (reading, queueing, pipeline,
+     output).
+     */
+    std::string toChromeTrace() const;
+    bool saveChromeTrace(const std::string& filename) const;
+
+  private:
+    const uint32_t max_traces_;
+
+    mutable std::mutex mutex_;
+    std::vector<SampleTrace> traces_;  // a min-heap by getDuration()
+};
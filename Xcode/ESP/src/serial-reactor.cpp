@@ -0,0 +1,135 @@
+#include "serial-reactor.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+
+// Bytes read from a port per wakeup. Anything beyond this is picked up by the
+// next poll(), which returns immediately.
+const size_t kReadBufferSize = 4096;
+
+SerialReactor& SerialReactor::instance() {
+    static SerialReactor reactor;
+    return reactor;
+}
+
+SerialReactor::SerialReactor() : dispatching_fd_(-1), is_stopping_(false) {
+    if (pipe(wake_pipe_) != 0) {
+        ofLog(OF_LOG_ERROR) << "SerialReactor: failed to create wakeup pipe";
+        wake_pipe_[0] = wake_pipe_[1] = -1;
+        return;
+    }
+    fcntl(wake_pipe_[0], F_SETFL, O_NONBLOCK);
+    fcntl(wake_pipe_[1], F_SETFL, O_NONBLOCK);
+    thread_ = std::thread(&SerialReactor::run, this);
+}
+
+SerialReactor::~SerialReactor() {
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        is_stopping_ = true;
+    }
+    wake();
+    if (thread_.joinable()) { thread_.join(); }
+    if (wake_pipe_[0] >= 0) {
+        close(wake_pipe_[0]);
+        close(wake_pipe_[1]);
+    }
+}
+
+bool SerialReactor::add(PollableSerial* serial, DataCallback callback) {
+    int fd = serial->getFileDescriptor();
+    if (fd < 0 || wake_pipe_[0] < 0) { return false; }
+
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        callbacks_[fd] = callback;
+    }
+    wake();
+    return true;
+}
+
+void SerialReactor::remove(PollableSerial* serial) {
+    int fd = serial->getFileDescriptor();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    callbacks_.erase(fd);
+
+    // A callback removing its own port must not wait for itself.
+    if (std::this_thread::get_id() != thread_.get_id()) {
+        dispatch_done_.wait(lock, [this, fd]() { return dispatching_fd_ != fd; });
+    }
+    lock.unlock();
+    wake();
+}
+
+void SerialReactor::wake() {
+    if (wake_pipe_[1] < 0) { return; }
+    unsigned char b = 0;
+    // A full pipe already guarantees a wakeup, so the result is ignored.
+    ssize_t ignored = write(wake_pipe_[1], &b, 1);
+    (void) ignored;
+}
+
+void SerialReactor::run() {
+    std::vector<struct pollfd> fds;
+    unsigned char buf[kReadBufferSize];
+
+    while (true) {
+        fds.clear();
+        fds.push_back({ wake_pipe_[0], POLLIN, 0 });
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            if (is_stopping_) { return; }
+            for (const auto& entry : callbacks_) {
+                fds.push_back({ entry.first, POLLIN, 0 });
+            }
+        }
+
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) { continue; }
+            ofLog(OF_LOG_ERROR) << "SerialReactor: poll failed: " << strerror(errno);
+            return;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            while (read(wake_pipe_[0], buf, kReadBufferSize) > 0) {}
+        }
+
+        for (size_t i = 1; i < fds.size(); i++) {
+            if (fds[i].revents == 0) { continue; }
+            const int fd = fds[i].fd;
+
+            DataCallback callback;
+            {
+                std::lock_guard<std::mutex> guard(mutex_);
+                auto it = callbacks_.find(fd);
+                if (it == callbacks_.end()) { continue; }  // removed meanwhile
+                callback = it->second;
+                dispatching_fd_ = fd;
+            }
+
+            ssize_t n = read(fd, buf, kReadBufferSize);
+            if (n > 0) {
+                callback(buf, n);
+            } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+                // The device went away (e.g. it was unplugged). Stop watching
+                // it rather than spinning on a descriptor that is always ready.
+                ofLog(OF_LOG_ERROR) << "SerialReactor: error reading from serial, "
+                                    << "no longer reading from this port";
+                std::lock_guard<std::mutex> guard(mutex_);
+                callbacks_.erase(fd);
+            }
+
+            {
+                std::lock_guard<std::mutex> guard(mutex_);
+                dispatching_fd_ = -1;
+            }
+            dispatch_done_.notify_all();
+        }
+    }
+}
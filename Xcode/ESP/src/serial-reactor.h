@@ -0,0 +1,79 @@
+/** @file serial-reactor.h
+ *  @brief SerialReactor, a single I/O thread that waits on every open serial
+ *  port and hands incoming bytes to the stream that owns the port.
+ *
+ *  Serial input streams used to each run a thread that slept and polled
+ *  ofSerial::available(), which burned CPU while idle and added up to one
+ *  sleep period of latency. SerialReactor instead blocks in poll() on the
+ *  ports' file descriptors and wakes as soon as bytes arrive.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "ofMain.h"
+
+/**
+ @brief ofSerial with access to its file descriptor, so that the port can be
+ waited on by SerialReactor. Only available on POSIX platforms.
+ */
+class PollableSerial : public ofSerial {
+  public:
+    int getFileDescriptor() const { return fd; }
+};
+
+/**
+ @brief Dispatches bytes from any number of serial ports, using one shared
+ thread.
+
+ Callbacks run on the reactor thread, one at a time, so a slow callback delays
+ every other port. They should do little more than parse the bytes and hand
+ the resulting samples off (see SampleQueue).
+ */
+class SerialReactor {
+  public:
+    // Called with the bytes that were read from the port.
+    typedef std::function<void(const unsigned char* data, size_t size)> DataCallback;
+
+    static SerialReactor& instance();
+
+    /// @brief Start dispatching bytes read from `serial` (which must already
+    /// be set up) to `callback`. Returns false if the port isn't open.
+    bool add(PollableSerial* serial, DataCallback callback);
+
+    /// @brief Stop dispatching bytes from `serial`. When this returns, the
+    /// port's callback is not running and won't be called again.
+    void remove(PollableSerial* serial);
+
+    ~SerialReactor();
+
+  private:
+    SerialReactor();
+
+    void run();
+    void wake();
+
+    std::mutex mutex_;
+    std::condition_variable dispatch_done_;
+
+    // Registered ports, keyed by file descriptor.
+    std::map<int, DataCallback> callbacks_;
+
+    // The file descriptor whose callback is running, or -1.
+    int dispatching_fd_;
+
+    // Writing a byte to wake_pipe_[1] interrupts poll() so that the set of
+    // ports can be refreshed.
+    int wake_pipe_[2];
+    bool is_stopping_;
+    std::thread thread_;
+
+    // Disallow copy and assign
+    SerialReactor(SerialReactor&) = delete;
+    void operator=(SerialReactor) = delete;
+};
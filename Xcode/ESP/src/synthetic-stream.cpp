@@ -0,0 +1,189 @@
+#include "synthetic-stream.h"
+
+#include <chrono>
+#include <cmath>
+
+SyntheticStream::SyntheticStream(double sample_rate, uint32_t num_dimensions,
+                                 Waveform waveform)
+        : sample_rate_(sample_rate), num_dimensions_(num_dimensions),
+          waveform_(waveform),
+          batch_size_(std::max(1u, (uint32_t) std::lround(sample_rate / 1000))),
+          is_running_(false), num_generated_(0), num_late_batches_(0) {
+    // Spread the dimensions' phases evenly over one period.
+    offset_sin_.resize(num_dimensions);
+    offset_cos_.resize(num_dimensions);
+    for (uint32_t d = 0; d < num_dimensions; d++) {
+        const double offset = 2 * M_PI * d / num_dimensions;
+        offset_sin_[d] = sin(offset);
+        offset_cos_[d] = cos(offset);
+    }
+}
+
+SyntheticStream::~SyntheticStream() {
+    stop();
+}
+
+int SyntheticStream::getNumInputDimensions() {
+    return num_dimensions_;
+}
+
+void SyntheticStream::setChirp(double from_hz, double to_hz, double seconds) {
+    chirp_from_hz_ = from_hz;
+    chirp_to_hz_ = to_hz;
+    chirp_seconds_ = seconds;
+}
+
+void SyntheticStream::addGesture(uint32_t label, const GRT::MatrixDouble& shape,
+                                 double interval_seconds) {
+    if (shape.getNumRows() == 0 || shape.getNumCols() == 0) {
+        ofLog(OF_LOG_ERROR) << "SyntheticStream: gesture " << label << " is empty";
+        return;
+    }
+    Gesture gesture;
+    gesture.label = label;
+    gesture.shape = shape;
+    gesture.interval_seconds = interval_seconds;
+    gestures_.push_back(gesture);
+}
+
+vector<SyntheticStream::InjectedGesture> SyntheticStream::getInjectedGestures() {
+    std::lock_guard<std::mutex> guard(injected_mutex_);
+    return vector<InjectedGesture>(injected_.begin(), injected_.end());
+}
+
+bool SyntheticStream::start() {
+    if (has_started_) { return true; }
+    if (sample_rate_ <= 0 || num_dimensions_ == 0) {
+        ofLog(OF_LOG_ERROR) << "SyntheticStream: needs a positive rate and dimensions";
+        return false;
+    }
+    if (waveform_ == TEMPLATE &&
+        (template_.getNumRows() == 0 || template_.getNumCols() == 0)) {
+        ofLog(OF_LOG_ERROR) << "SyntheticStream: no template to replay (see useTemplate())";
+        return false;
+    }
+
+    noise_state_ = seed_;
+    block_.resize(batch_size_, num_dimensions_);
+
+    has_started_ = true;
+    is_running_ = true;
+    thread_.reset(new std::thread(&SyntheticStream::run, this));
+    return true;
+}
+
+void SyntheticStream::stop() {
+    if (!has_started_) { return; }
+    is_running_ = false;
+    if (thread_ != nullptr && thread_->joinable()) { thread_->join(); }
+    has_started_ = false;
+}
+
+double SyntheticStream::nextNoise() {
+    // xorshift64*: cheap enough for every value of 512 dimensions at 100 kHz.
+    noise_state_ ^= noise_state_ >> 12;
+    noise_state_ ^= noise_state_ << 25;
+    noise_state_ ^= noise_state_ >> 27;
+    const uint64_t r = noise_state_ * 2685821657736338717ull;
+    return (r >> 11) * (2.0 / 9007199254740992.0) - 1.0;
+}
+
+void SyntheticStream::generate(uint64_t n) {
+    const double two_pi = 2 * M_PI;
+
+    for (uint32_t i = 0; i < batch_size_; i++) {
+        const uint64_t s = n + i;
+        const double t = s / sample_rate_;
+        double* row = block_[i];
+
+        switch (waveform_) {
+            case SINE:
+            case CHIRP: {
+                const double sp = sin(phase_), cp = cos(phase_);
+                for (uint32_t d = 0; d < num_dimensions_; d++) {
+                    row[d] = amplitude_ * (sp * offset_cos_[d] + cp * offset_sin_[d]);
+                }
+                double f = frequency_;
+                if (waveform_ == CHIRP) {
+                    const double progress = fmod(t, chirp_seconds_) / chirp_seconds_;
+                    f = chirp_from_hz_ + (chirp_to_hz_ - chirp_from_hz_) * progress;
+                }
+                phase_ = fmod(phase_ + two_pi * f / sample_rate_, two_pi);
+                break;
+            }
+            case NOISE:
+                for (uint32_t d = 0; d < num_dimensions_; d++) {
+                    row[d] = amplitude_ * nextNoise();
+                }
+                break;
+            case STEP: {
+                const double v = fmod(t * frequency_, 1.0) < 0.5 ? 0 : amplitude_;
+                for (uint32_t d = 0; d < num_dimensions_; d++) { row[d] = v; }
+                break;
+            }
+            case TEMPLATE: {
+                const double* values = template_[s % template_.getNumRows()];
+                const uint32_t cols = template_.getNumCols();
+                for (uint32_t d = 0; d < num_dimensions_; d++) { row[d] = values[d % cols]; }
+                break;
+            }
+        }
+
+        if (noise_level_ != 0) {
+            for (uint32_t d = 0; d < num_dimensions_; d++) {
+                row[d] += noise_level_ * nextNoise();
+            }
+        }
+
+        if (gestures_.empty()) { continue; }
+        if (current_gesture_ != nullptr &&
+            s - current_gesture_start_ >= current_gesture_->shape.getNumRows()) {
+            current_gesture_ = nullptr;
+        }
+        if (current_gesture_ == nullptr && s >= next_gesture_at_) {
+            current_gesture_ = &gestures_[next_gesture_];
+            current_gesture_start_ = s;
+            next_gesture_ = (next_gesture_ + 1) % gestures_.size();
+            next_gesture_at_ = s + (uint64_t) (current_gesture_->interval_seconds * sample_rate_);
+
+            InjectedGesture injected;
+            injected.label = current_gesture_->label;
+            injected.first_sequence = s;
+            injected.num_samples = current_gesture_->shape.getNumRows();
+            std::lock_guard<std::mutex> guard(injected_mutex_);
+            injected_.push_back(injected);
+            if (injected_.size() > kMaxInjectedGestures) { injected_.pop_front(); }
+        }
+        if (current_gesture_ != nullptr) {
+            const GRT::MatrixDouble& shape = current_gesture_->shape;
+            const double* values = shape[s - current_gesture_start_];
+            const uint32_t cols = shape.getNumCols();
+            for (uint32_t d = 0; d < num_dimensions_; d++) { row[d] += values[d % cols]; }
+        }
+    }
+}
+
+void SyntheticStream::run() {
+    typedef std::chrono::steady_clock Clock;
+    const std::chrono::duration<double> batch_period(batch_size_ / sample_rate_);
+    const auto start_time = Clock::now();
+
+    for (uint64_t k = 0; is_running_; k++) {
+        const auto due = start_time +
+            std::chrono::duration_cast<Clock::duration>(k * batch_period);
+        const auto now = Clock::now();
+        if (now < due) {
+            std::this_thread::sleep_until(due);
+        } else if (now - due > batch_period) {
+            num_late_batches_++;
+        }
+
+        // Samples are numbered like the sequence numbers emitData() gives
+        // them, since this stream emits nothing else.
+        const uint64_t n = num_generated_;
+        generate(n);
+
+        normalizeAndEmit(block_);
+        num_generated_ += batch_size_;
+    }
+}
@@ -0,0 +1,165 @@
+/** @file synthetic-stream.h
+ *  @brief SyntheticStream, an input stream that generates test signals, for
+ *  measuring how the system copes with a given rate and number of
+ *  dimensions without any hardware.
+ *
+ *  @verbatim
+ *  SyntheticStream stream(10000, 64, SyntheticStream::CHIRP);  // 10 kHz, 64 dims
+ *
+ *  void setup() {
+ *      stream.setChirp(1, 200, 5);
+ *      stream.addGesture(1, gesture_template, 2.0);
+ *      useInputStream(stream);
+ *  }
+ *  @endverbatim
+ */
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "istream.h"
+
+/**
+ @brief Input stream producing sine, chirp, noise, step or template signals
+ at a fixed rate.
+
+ Every dimension carries the same waveform, each with its own phase, plus
+ optional noise. Gestures with known labels can be added on top at regular
+ intervals; getInjectedGestures() tells which samples hold them, to check
+ the pipeline's predictions against.
+
+ Samples are emitted in batches (see setBatchSize()) on a schedule kept
+ against the clock. When the app can't keep up, batches go out late rather
+ than being skipped, and getNumLateBatches() counts them.
+ */
+class SyntheticStream : public IStream {
+  public:
+    enum Waveform {
+        SINE,      // at the frequency set with setFrequency()
+        CHIRP,     // a sine sweeping between the frequencies of setChirp()
+        NOISE,     // uniform white noise of the amplitude
+        STEP,      // alternating between 0 and the amplitude, at the frequency
+        TEMPLATE,  // the samples passed to useTemplate(), over and over
+    };
+
+    /**
+     Create a SyntheticStream instance.
+
+     @param sample_rate: samples per second.
+     @param num_dimensions: values per sample.
+     @param waveform: the signal to generate.
+     */
+    SyntheticStream(double sample_rate, uint32_t num_dimensions,
+                    Waveform waveform = SINE);
+    ~SyntheticStream();
+
+    virtual bool start() final;
+    virtual void stop() final;
+    virtual int getNumInputDimensions() final;
+
+    // The following configure the signal; call them before the stream starts.
+
+    /// @brief Samples per emitted batch. Defaults to about 1 ms of samples.
+    void setBatchSize(uint32_t samples) { batch_size_ = std::max(1u, samples); }
+
+    /// @brief Peak value of the waveform. Defaults to 1.
+    void setAmplitude(double amplitude) { amplitude_ = amplitude; }
+
+    /// @brief Frequency of SINE and STEP in Hz. Defaults to 1 Hz.
+    void setFrequency(double hz) { frequency_ = hz; }
+
+    /// @brief Sweep CHIRP from `from_hz` to `to_hz` over `seconds`, then
+    /// start over.
+    void setChirp(double from_hz, double to_hz, double seconds);
+
+    /// @brief Add uniform noise of the given amplitude to every waveform.
+    void setNoiseLevel(double amplitude) { noise_level_ = amplitude; }
+
+    /// @brief Seed of the noise, so that runs can be repeated exactly.
+    void setSeed(uint64_t seed) { seed_ = seed ? seed : 1; }
+
+    /// @brief Samples that TEMPLATE replays in a loop. If the template has
+    /// fewer columns than the stream has dimensions, its columns repeat.
+    void useTemplate(const GRT::MatrixDouble& samples) { template_ = samples; }
+
+    /**
+     Add `shape` onto the signal every `interval_seconds`, as a gesture with
+     the given label. Gestures added by several calls take turns. As with
+     useTemplate(), columns repeat to fill the dimensions.
+     */
+    void addGesture(uint32_t label, const GRT::MatrixDouble& shape,
+                    double interval_seconds);
+
+    struct InjectedGesture {
+        uint32_t label;
+        uint64_t first_sequence;  // of the samples, see SampleStamp
+        uint32_t num_samples;
+    };
+
+    /// @brief The most recent gestures injected (up to 1024).
+    vector<InjectedGesture> getInjectedGestures();
+
+    uint64_t getNumGeneratedSamples() const { return num_generated_.load(); }
+
+    /// @brief Number of batches emitted after their scheduled time, i.e.
+    /// while the receiver was still busy with earlier ones.
+    uint64_t getNumLateBatches() const { return num_late_batches_.load(); }
+
+  private:
+    static const size_t kMaxInjectedGestures = 1024;
+
+    struct Gesture {
+        uint32_t label;
+        GRT::MatrixDouble shape;
+        double interval_seconds;  // until the next gesture
+    };
+
+    void run();
+    // Fill block_ with the samples starting at sample number `n`.
+    void generate(uint64_t n);
+    double nextNoise();  // uniform in [-1, 1)
+
+    const double sample_rate_;
+    const uint32_t num_dimensions_;
+    const Waveform waveform_;
+
+    uint32_t batch_size_;
+    double amplitude_ = 1.0;
+    double frequency_ = 1.0;
+    double chirp_from_hz_ = 1.0, chirp_to_hz_ = 10.0, chirp_seconds_ = 10.0;
+    double noise_level_ = 0;
+    uint64_t seed_ = 1;
+    GRT::MatrixDouble template_;
+
+    vector<Gesture> gestures_;
+
+    // Generator state. Each dimension d is sin(phase_ + offset_d), computed
+    // from sin/cos(phase_) and the offsets' sin/cos.
+    double phase_ = 0;
+    vector<double> offset_sin_, offset_cos_;
+    uint64_t noise_state_ = 1;
+    uint64_t next_gesture_at_ = 0;     // sample number
+    size_t next_gesture_ = 0;
+    const Gesture* current_gesture_ = nullptr;
+    uint64_t current_gesture_start_ = 0;
+
+    GRT::MatrixDouble block_;
+
+    std::mutex injected_mutex_;
+    std::deque<InjectedGesture> injected_;
+
+    std::atomic<bool> is_running_;
+    std::atomic<uint64_t> num_generated_;
+    std::atomic<uint64_t> num_late_batches_;
+    unique_ptr<std::thread> thread_;
+
+    // Disallow copy and assign
+    SyntheticStream(SyntheticStream&) = delete;
+    void operator=(SyntheticStream) = delete;
+};
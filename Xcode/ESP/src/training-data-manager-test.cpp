@@ -178,3 +178,50 @@ TEST_F(TrainingDataManagerTest, TestSaveLoad) {
     ASSERT_STREQ("Label 1 [1]", manager->getSampleName(1, 1).c_str());
     ASSERT_STREQ("Special 2 [0]", manager->getSampleName(2, 0).c_str());
 }
+
+TEST_F(TrainingDataManagerTest, TestVersionTracksEdits) {
+    uint64_t version = manager->getVersion();
+
+    manager->setSampleScore(1, 0, 1.0);
+    manager->setSampleName(1, 0, "renamed");
+    ASSERT_EQ(version, manager->getVersion());
+
+    manager->relabelSample(1, 0, 2);
+    ASSERT_LT(version, manager->getVersion());
+    version = manager->getVersion();
+
+    manager->trimSample(2, 0, 0, 0);
+    ASSERT_LT(version, manager->getVersion());
+}
+
+TEST_F(TrainingDataManagerTest, TestChangesSince) {
+    typedef TrainingDataManager::Change Change;
+    const uint64_t version = manager->getVersion();
+    std::vector<Change> changes;
+
+    ASSERT_TRUE(manager->getChangesSince(version, &changes));
+    ASSERT_TRUE(changes.empty());
+
+    manager->relabelSample(1, 0, 2);
+    manager->deleteSample(1, 1);
+    manager->addSample(3, manager->getSample(2, 0));
+
+    ASSERT_TRUE(manager->getChangesSince(version, &changes));
+    ASSERT_EQ(3, changes.size());
+    ASSERT_EQ(Change::RELABEL, changes[0].type);
+    ASSERT_EQ(1, changes[0].label);
+    ASSERT_EQ(0, changes[0].index);
+    ASSERT_EQ(2, changes[0].new_label);
+    ASSERT_EQ(Change::REMOVE, changes[1].type);
+    ASSERT_EQ(Change::ADD, changes[2].type);
+    ASSERT_EQ(3, changes[2].label);
+    ASSERT_EQ(0, changes[2].index);
+
+    // Only the last ones are kept.
+    for (uint32_t i = 0; i < TrainingDataManager::kMaxChanges; i++) {
+        manager->trimSample(2, 0, 0, 0);
+    }
+    ASSERT_FALSE(manager->getChangesSince(version, &changes));
+    ASSERT_TRUE(manager->getChangesSince(
+        manager->getVersion() - TrainingDataManager::kMaxChanges, &changes));
+}
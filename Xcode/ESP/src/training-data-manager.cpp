@@ -68,7 +68,13 @@ bool TrainingDataManager::setSampleName(
 bool TrainingDataManager::addSample(
     uint32_t label, const GRT::MatrixDouble& sample) {
     CHECK_LABEL(label);
+    appendSample(label, sample);
+    recordChange(Change::ADD, label, num_samples_per_label_[label] - 1);
+    return true;
+}
 
+void TrainingDataManager::appendSample(
+    uint32_t label, const GRT::MatrixDouble& sample) {
     // By default, set the name be <false, ""> so we will use the default name.
     training_sample_names_[label].push_back(
         std::make_pair(false, std::string()));
@@ -76,8 +82,6 @@ bool TrainingDataManager::addSample(
     training_sample_class_likelihoods_[label].push_back(std::make_pair(false, std::vector<double>()));
     data_.addSample(label, sample);
     num_samples_per_label_[label]++;
-
-    return true;
 }
 
 std::string TrainingDataManager::getLabelName(uint32_t label) {
@@ -107,7 +111,12 @@ uint32_t TrainingDataManager::getNumSampleForLabel(uint32_t label) {
 bool TrainingDataManager::deleteSample(uint32_t label, uint32_t index) {
     CHECK_LABEL(label);
     CHECK_INDEX(label, index);
+    eraseSample(label, index);
+    recordChange(Change::REMOVE, label, index);
+    return true;
+}
 
+void TrainingDataManager::eraseSample(uint32_t label, uint32_t index) {
     // The implementation first remove all data and then add them back. This is
     // a temporary solution because GRT::TimeSeriesClassificationData doesn't
     // allow per-sample operation.
@@ -130,8 +139,6 @@ bool TrainingDataManager::deleteSample(uint32_t label, uint32_t index) {
     likelihoods.erase(likelihoods.begin() + index);
 
     num_samples_per_label_[label]--;
-
-    return true;
 }
 
 bool TrainingDataManager::deleteAllSamples() {
@@ -143,6 +150,7 @@ bool TrainingDataManager::deleteAllSamples() {
         auto& likelihoods = training_sample_class_likelihoods_[i + 1];
         likelihoods.erase(likelihoods.begin(), likelihoods.end());
     }
+    recordChange(Change::RESET, 0);
     return true;
 }
 
@@ -154,6 +162,7 @@ bool TrainingDataManager::deleteAllSamplesWithLabel(uint32_t label) {
     scores.erase(scores.begin(), scores.end());
     auto& likelihoods = training_sample_class_likelihoods_[label];
     likelihoods.erase(likelihoods.begin(), likelihoods.end());
+    recordChange(Change::RESET, label);
     return true;
 }
 
@@ -164,8 +173,9 @@ bool TrainingDataManager::relabelSample(
     CHECK_INDEX(label, index);
 
     GRT::MatrixDouble data = getSample(label, index);
-    deleteSample(label, index);
-    addSample(new_label, data);
+    eraseSample(label, index);
+    appendSample(new_label, data);
+    recordChange(Change::RELABEL, label, index, new_label);
 
     return true;
 }
@@ -191,6 +201,7 @@ bool TrainingDataManager::trimSample(
             data_.addSample(label, data[i].getData());
         }
     }
+    recordChange(Change::MODIFY, label, index);
     return true;
 }
 
@@ -254,6 +265,22 @@ bool TrainingDataManager::setSampleClassLikelihoods(
     return true;
 }
 
+void TrainingDataManager::recordChange(
+    Change::Type type, uint32_t label, uint32_t index, uint32_t new_label) {
+    version_++;
+    changes_.push_back(Change{ type, label, index, new_label });
+    if (changes_.size() > kMaxChanges) { changes_.pop_front(); }
+}
+
+bool TrainingDataManager::getChangesSince(
+    uint64_t version, std::vector<Change>* changes) {
+    if (version > version_ || version_ - version > changes_.size()) {
+        return false;
+    }
+    changes->assign(changes_.end() - (version_ - version), changes_.end());
+    return true;
+}
+
 bool TrainingDataManager::load(const std::string& filename) {
     if (!data_.load(filename)) {
         return false;
@@ -271,6 +298,7 @@ bool TrainingDataManager::load(const std::string& filename) {
     num_samples_per_label_.resize(num_classes_ + 1);
     training_sample_scores_.resize(num_classes_ + 1);
     training_sample_class_likelihoods_.resize(num_classes_ + 1);
+    recordChange(Change::RESET, 0);
 
     for (uint32_t i = 1; i <= num_classes_; i++) {
         const string class_name = data_.getClassNameForCorrespondingClassLabel(i);
@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <deque>
 #include <tuple>
 
 #include <GRT/GRT.h>
@@ -52,6 +53,32 @@ class TrainingDataManager {
 
     uint32_t getNumLabels() { return num_classes_; }
 
+    /// @brief Goes up every time a sample is added, removed or changed (not
+    /// renamed or scored), so that work done on a copy of the data can tell
+    /// whether it is still current.
+    uint64_t getVersion() const { return version_; }
+
+    /// @brief One edit of the training data, as getChangesSince() gives it.
+    struct Change {
+        enum Type {
+            ADD,      ///< a sample was added to label, at index
+            REMOVE,   ///< (label, index) was deleted; the later ones moved down
+            RELABEL,  ///< (label, index) was moved to the end of new_label
+            MODIFY,   ///< (label, index)'s data changed (e.g. it was trimmed)
+            RESET,    ///< anything else: start over from getAllData()
+        };
+        Type type;
+        uint32_t label;
+        uint32_t index;
+        uint32_t new_label;
+    };
+
+    /// @brief The changes that took the data from version to getVersion(),
+    /// oldest first. Only the last kMaxChanges are kept; returns false if
+    /// some of them are gone.
+    bool getChangesSince(uint64_t version, std::vector<Change>* changes);
+    static const uint32_t kMaxChanges = 1024;
+
     // =================================================
     //  Functions that enables per-sample naming
     // =================================================
@@ -120,6 +147,16 @@ class TrainingDataManager {
   private:
     uint32_t num_classes_;
 
+    // The edits that brought the data to version_, oldest first.
+    uint64_t version_ = 0;
+    std::deque<Change> changes_;
+    void recordChange(Change::Type type, uint32_t label, uint32_t index = 0,
+                      uint32_t new_label = 0);
+
+    // addSample() and deleteSample() without recording a change.
+    void appendSample(uint32_t label, const GRT::MatrixDouble& sample);
+    void eraseSample(uint32_t label, uint32_t index);
+
     // Name simulates Option<std::string> type. If `Name.first` is true, then
     // the name is valid; else use the default name.
     using Name = std::pair<bool, std::string>;
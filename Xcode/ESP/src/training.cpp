@@ -1,5 +1,5 @@
 #include "training.h"
-#include "ofApp.h"
+#include "runtime.h"
 
 const string TrainingSampleCheckerResult::kDefaultSuccessMessage = "Success";
 const string TrainingSampleCheckerResult::kDefaultWarningMessage = "Warning";
@@ -24,9 +24,9 @@ TrainingSampleCheckerResult::TrainingSampleCheckerResult(Result result, string m
 }
 
 void useTrainingSampleChecker(TrainingSampleChecker checker) {
-    ((ofApp *) ofGetAppPtr())->useTrainingSampleChecker(checker);
+    getRuntime()->useTrainingSampleChecker(checker);
 }
 
 void useTrainingDataAdvice(string advice) {
-    ((ofApp *) ofGetAppPtr())->useTrainingDataAdvice(advice);
+    getRuntime()->useTrainingDataAdvice(advice);
 }
\ No newline at end of file
@@ -2,7 +2,7 @@
 
 #include <cmath>
 
-#include "ofApp.h"
+#include "runtime.h"
 
 static std::map<void*, Tuneable*> allTuneables;
 
@@ -24,7 +24,7 @@ void Tuneable::onSliderEvent(ofxDatGuiSliderEvent e) {
                 *value = e.value;
             }
 
-            ((ofApp *) ofGetAppPtr())->reloadPipelineModules();
+            getRuntime()->reloadPipelineModules();
         }
     }
 }
@@ -36,7 +36,7 @@ void Tuneable::onToggleEvent(ofxDatGuiButtonEvent e) {
         if (e.target == ui_ptr) {
             bool* value = static_cast<bool*>(data_ptr);
             *value = e.enabled;
-            ((ofApp *) ofGetAppPtr())->reloadPipelineModules();
+            getRuntime()->reloadPipelineModules();
         }
     }
 }
@@ -51,7 +51,7 @@ void registerTuneable(int& value, int min, int max,
 
     Tuneable* t = new Tuneable(&value, min, max, title, description);
     allTuneables[address] = t;
-    ((ofApp *) ofGetAppPtr())->registerTuneable(t);
+    getRuntime()->registerTuneable(t);
 }
 
 void registerTuneable(double& value, double min, double max,
@@ -64,7 +64,7 @@ void registerTuneable(double& value, double min, double max,
 
     Tuneable* t = new Tuneable(&value, min, max, title, description);
     allTuneables[address] = t;
-    ((ofApp *) ofGetAppPtr())->registerTuneable(t);
+    getRuntime()->registerTuneable(t);
 }
 
 void registerTuneable(bool& value,
@@ -77,5 +77,5 @@ void registerTuneable(bool& value,
 
     Tuneable* t = new Tuneable(&value, title, description);
     allTuneables[address] = t;
-    ((ofApp *) ofGetAppPtr())->registerTuneable(t);
+    getRuntime()->registerTuneable(t);
 }
@@ -0,0 +1,131 @@
+#include "wav-reader.h"
+
+#include "ofMain.h"
+
+#include <cstring>
+
+static const uint16_t kWaveFormatPcm = 1;
+static const uint16_t kWaveFormatFloat = 3;
+static const uint16_t kWaveFormatExtensible = 0xFFFE;
+
+// Fields in WAV files are little-endian.
+static uint32_t readLE(const uint8_t* p, int num_bytes) {
+    uint32_t v = 0;
+    for (int i = num_bytes - 1; i >= 0; i--) { v = (v << 8) | p[i]; }
+    return v;
+}
+
+WavReader::WavReader()
+        : file_(nullptr), format_(0), num_channels_(0), sample_rate_(0),
+          bytes_per_sample_(0), data_offset_(0), num_frames_(0), frames_read_(0) {
+}
+
+WavReader::~WavReader() {
+    close();
+}
+
+void WavReader::close() {
+    if (file_ != nullptr) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+bool WavReader::open(const std::string& path) {
+    close();
+    file_ = fopen(path.c_str(), "rb");
+    if (file_ == nullptr) {
+        ofLog(OF_LOG_ERROR) << "WavReader: can't open " << path;
+        return false;
+    }
+
+    uint8_t riff[12];
+    if (fread(riff, 1, 12, file_) != 12 || memcmp(riff, "RIFF", 4) != 0 ||
+        memcmp(riff + 8, "WAVE", 4) != 0) {
+        ofLog(OF_LOG_ERROR) << "WavReader: " << path << " is not a WAV file";
+        close();
+        return false;
+    }
+
+    // Walk the chunks until the sample data, picking up the format on the
+    // way.
+    bool has_format = false;
+    uint8_t chunk[8];
+    while (fread(chunk, 1, 8, file_) == 8) {
+        const uint32_t size = readLE(chunk + 4, 4);
+        if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+            std::vector<uint8_t> fmt(size);
+            if (fread(fmt.data(), 1, size, file_) != size) { break; }
+            format_ = readLE(&fmt[0], 2);
+            num_channels_ = readLE(&fmt[2], 2);
+            sample_rate_ = readLE(&fmt[4], 4);
+            bytes_per_sample_ = readLE(&fmt[14], 2) / 8;
+            if (format_ == kWaveFormatExtensible && size >= 26) {
+                format_ = readLE(&fmt[24], 2);  // first field of the subformat GUID
+            }
+            has_format = true;
+        } else if (memcmp(chunk, "data", 4) == 0 && has_format) {
+            data_offset_ = ftell(file_);
+            const bool supported =
+                num_channels_ > 0 && sample_rate_ > 0 &&
+                ((format_ == kWaveFormatPcm && bytes_per_sample_ >= 1 &&
+                  bytes_per_sample_ <= 4) ||
+                 (format_ == kWaveFormatFloat && bytes_per_sample_ == 4));
+            if (!supported) {
+                ofLog(OF_LOG_ERROR) << "WavReader: unsupported sample format in " << path;
+                close();
+                return false;
+            }
+            num_frames_ = size / (bytes_per_sample_ * num_channels_);
+            frames_read_ = 0;
+            return true;
+        } else {
+            // Chunks are padded to an even size.
+            if (fseek(file_, size + (size & 1), SEEK_CUR) != 0) { break; }
+        }
+    }
+
+    ofLog(OF_LOG_ERROR) << "WavReader: no sample data in " << path;
+    close();
+    return false;
+}
+
+bool WavReader::rewind() {
+    if (file_ == nullptr || fseek(file_, data_offset_, SEEK_SET) != 0) { return false; }
+    frames_read_ = 0;
+    return true;
+}
+
+uint32_t WavReader::read(float* out, uint32_t max_frames) {
+    if (file_ == nullptr) { return 0; }
+
+    uint64_t remaining = num_frames_ - frames_read_;
+    uint32_t n = remaining < max_frames ? remaining : max_frames;
+    const size_t frame_bytes = bytes_per_sample_ * num_channels_;
+    raw_.resize(n * frame_bytes);
+    n = fread(raw_.data(), frame_bytes, n, file_);
+    frames_read_ += n;
+
+    const float scale = 1.0f / num_channels_;
+    const uint8_t* p = raw_.data();
+    for (uint32_t i = 0; i < n; i++) {
+        float sum = 0;
+        for (uint16_t c = 0; c < num_channels_; c++, p += bytes_per_sample_) {
+            if (format_ == kWaveFormatFloat) {
+                uint32_t bits = readLE(p, 4);
+                float f;
+                memcpy(&f, &bits, sizeof(f));
+                sum += f;
+            } else if (bytes_per_sample_ == 1) {
+                sum += (p[0] - 128) / 128.0f;  // 8-bit samples are unsigned
+            } else {
+                // Sign-extend from the sample's width, then scale to [-1, 1).
+                const int bits = 8 * bytes_per_sample_;
+                int32_t v = (int32_t) (readLE(p, bytes_per_sample_) << (32 - bits)) >> (32 - bits);
+                sum += v / (float) (1u << (bits - 1));
+            }
+        }
+        out[i] = sum * scale;
+    }
+    return n;
+}
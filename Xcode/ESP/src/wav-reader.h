@@ -0,0 +1,54 @@
+/** @file wav-reader.h
+ *  @brief WavReader, a minimal streaming decoder for uncompressed WAV files.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ @brief Reads PCM (8, 16, 24 or 32-bit integer) or 32-bit float WAV files a
+ block at a time, mixed down to mono floats in [-1, 1].
+
+ Decoding is plain integer and float arithmetic, so the same file always
+ yields bit-identical samples.
+ */
+class WavReader {
+  public:
+    WavReader();
+    ~WavReader();
+
+    /// @brief Open `path` and parse its header. Returns false (and logs why)
+    /// if the file isn't a WAV file this class can decode.
+    bool open(const std::string& path);
+    void close();
+
+    uint32_t getSampleRate() const { return sample_rate_; }
+    uint32_t getNumChannels() const { return num_channels_; }
+    uint64_t getNumFrames() const { return num_frames_; }
+
+    /// @brief Decode up to `max_frames` frames into `out`, one mono sample
+    /// per frame. Returns the number of frames decoded; 0 at the end.
+    uint32_t read(float* out, uint32_t max_frames);
+
+    /// @brief Go back to the first frame.
+    bool rewind();
+
+  private:
+    FILE* file_;
+    uint16_t format_;           // 1: integer PCM, 3: IEEE float
+    uint16_t num_channels_;
+    uint32_t sample_rate_;
+    uint16_t bytes_per_sample_;
+    long data_offset_;          // start of the sample data in the file
+    uint64_t num_frames_;
+    uint64_t frames_read_;
+    std::vector<uint8_t> raw_;  // undecoded bytes of the current block
+
+    // Disallow copy and assign
+    WavReader(WavReader&) = delete;
+    void operator=(WavReader) = delete;
+};